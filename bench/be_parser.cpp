@@ -0,0 +1,10 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions parser - instantiation
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+
+#include "be_decl.hpp"
+#include "be_def.hpp"
@@ -0,0 +1,478 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions engine - throughput benchmarks
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "batch.hpp"
+#include "be.hpp"
+#include "compact_ast.hpp"
+#include "parallel.hpp"
+#include "record.hpp"
+#include "rule_index.hpp"
+#include "rule_set.hpp"
+#include "schema.hpp"
+
+/*
+ * Synthetic workload: a schema of the configured number of variables of
+ * each type, random expressions of the configured depth over it, and
+ * random records. Each leaf predicate is true with probability close to
+ * the configured selectivity. Results go to stdout, one metric per line:
+ * name, value and unit separated by tabs, so runs of different versions
+ * can be diffed.
+ *
+ *   lexen_bench [--name=value ...]
+ *
+ * Counts are positive, except that variable type counts, depth and
+ * threads may be 0; selectivity is in [0, 1].
+ */
+
+namespace {
+
+using lexen::var_type;
+using lexen::ast::VarIdx;
+
+struct Config {
+    int bools = 4;
+    int ints = 8;
+    int reals = 4;
+    int strs = 4;
+    int int_lists = 2;
+    int str_lists = 2;
+    int depth = 3;          // levels of and/or above the leaves
+    int fanout = 3;         // items of and/or
+    int list_size = 8;      // elements of list values and literal sets
+    int values = 1000;      // integer values are in [0, values)
+    int words = 100;        // distinct string values
+    double selectivity = 0.5;
+    int exprs = 10000;      // parse and compile
+    int rules = 1000;       // multi-rule matching
+    int records = 10000;
+    int rows = 4096;        // batch size
+    int par_rows = 1 << 18; // batch size of multi-core evaluation
+    int threads = 0;        // pool workers of it, all cores if 0
+    unsigned seed = 1;
+};
+
+// option of the command line, an int of at least min or a double in [0, 1]
+struct Option {
+    const char* name;
+    int Config::*i;
+    double Config::*d;
+    int min;
+};
+
+const Option options[] = {
+    {"bools", &Config::bools, nullptr, 0},
+    {"ints", &Config::ints, nullptr, 0},
+    {"reals", &Config::reals, nullptr, 0},
+    {"strs", &Config::strs, nullptr, 0},
+    {"int_lists", &Config::int_lists, nullptr, 0},
+    {"str_lists", &Config::str_lists, nullptr, 0},
+    {"depth", &Config::depth, nullptr, 0},
+    {"fanout", &Config::fanout, nullptr, 1},
+    {"list_size", &Config::list_size, nullptr, 1},
+    {"values", &Config::values, nullptr, 1},
+    {"words", &Config::words, nullptr, 1},
+    {"selectivity", nullptr, &Config::selectivity, 0},
+    {"exprs", &Config::exprs, nullptr, 1},
+    {"rules", &Config::rules, nullptr, 1},
+    {"records", &Config::records, nullptr, 1},
+    {"rows", &Config::rows, nullptr, 1},
+    {"par_rows", &Config::par_rows, nullptr, 1},
+    {"threads", &Config::threads, nullptr, 0},
+};
+
+bool parse_value(const Option& o, const char* s, Config& c) {
+    char* end;
+    errno = 0;
+    if (o.i) {
+        auto x = std::strtol(s, &end, 10);
+        if (end == s || *end || errno || x < o.min || x > INT_MAX) return false;
+        c.*o.i = int(x);
+    } else {
+        auto x = std::strtod(s, &end);
+        if (end == s || *end || errno || !(x >= 0 && x <= 1)) return false;
+        c.*o.d = x;
+    }
+    return true;
+}
+
+bool parse_args(int argc, char** argv, Config& c) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* eq = std::strchr(arg, '=');
+        if (std::strncmp(arg, "--", 2) || !eq) return false;
+        std::string name(arg + 2, eq);
+        bool found = false;
+        for (auto& o : options) {
+            if (name != o.name) continue;
+            if (!parse_value(o, eq + 1, c)) return false;
+            found = true;
+        }
+        if (name == "seed") {
+            char* end;
+            errno = 0;
+            auto x = std::strtoul(eq + 1, &end, 10);
+            if (end == eq + 1 || *end || errno || x > UINT_MAX) return false;
+            c.seed = unsigned(x);
+            found = true;
+        }
+        if (!found) return false;
+    }
+    // leaves need a variable of some type
+    return c.bools + c.ints + c.reals + c.strs + c.int_lists + c.str_lists > 0;
+}
+
+class Workload {
+public:
+    explicit Workload(const Config& c) : c_(c), rng_(c.seed) {
+        auto add = [this] (const char* prefix, int n, var_type type, std::vector<VarIdx>& vars) {
+            for (int i = 0; i < n; ++i) vars.push_back(schema.add(prefix + std::to_string(i), type));
+        };
+        add("b", c.bools, var_type::boolean, bools_);
+        add("i", c.ints, var_type::integer, ints_);
+        add("r", c.reals, var_type::realnum, reals_);
+        add("s", c.strs, var_type::string, strs_);
+        add("l", c.int_lists, var_type::integers, int_lists_);
+        add("t", c.str_lists, var_type::strings, str_lists_);
+        for (int i = 0; i < c.words; ++i) words_.push_back("w" + std::to_string(i));
+    }
+
+    lexen::Schema schema;
+
+    std::string expression() { return node(c_.depth); }
+
+    // Random values of every variable passed to the sink, which has the
+    // setters of Record, lists are passed by value.
+    template<typename Sink>
+    void record(Sink& sink) {
+        std::uniform_real_distribution<double> u;
+        for (auto v : bools_) sink.set_bool(v, u(rng_) < c_.selectivity);
+        for (auto v : ints_) sink.set_int(v, int(u(rng_) * c_.values));
+        for (auto v : reals_) sink.set_real(v, u(rng_));
+        for (auto v : strs_) sink.set_str(v, std::string_view(words_[pick(words_.size())]));
+        for (auto v : int_lists_) {
+            std::vector<int> x;
+            for (int j = 0; j < c_.list_size; ++j) x.push_back(int(u(rng_) * c_.values));
+            sink.set_ints(v, std::move(x));
+        }
+        for (auto v : str_lists_) {
+            std::vector<std::string_view> x;
+            for (int j = 0; j < c_.list_size; ++j) x.push_back(words_[pick(words_.size())]);
+            sink.set_strs(v, std::move(x));
+        }
+    }
+
+private:
+    double uniform() { return std::uniform_real_distribution<double>()(rng_); }
+    std::size_t pick(std::size_t n) { return std::size_t(uniform() * double(n)); }
+
+    std::string node(int depth) {
+        if (depth == 0) return leaf();
+        std::string op = uniform() < 0.5 ? " and " : " or ";
+        std::string r = "(";
+        for (int i = 0; i < c_.fanout; ++i) {
+            if (i) r += op;
+            r += node(depth - 1);
+        }
+        r += ")";
+        return uniform() < 0.1 ? "not " + r : r;
+    }
+
+    // string literal set of n distinct words
+    std::string words(std::size_t n) {
+        std::string r = "(";
+        auto first = pick(words_.size());
+        for (std::size_t i = 0; i < n; ++i)
+            r += (i ? ", '" : "'") + words_[(first + i) % words_.size()] + "'";
+        return r + ")";
+    }
+
+    std::string leaf() {
+        auto s = c_.selectivity;
+        for (;;) {
+            switch (pick(6)) {
+            case 0:
+                if (bools_.empty()) break;
+                return "b" + std::to_string(pick(bools_.size()));
+            case 1:
+                if (ints_.empty()) break;
+                if (uniform() < 0.5) {
+                    return "i" + std::to_string(pick(ints_.size())) + " < " + std::to_string(int(s * c_.values));
+                } else {
+                    // list_size values spread over [0, s * values), true
+                    // with probability 1 / step of s
+                    auto n = std::max(1, int(s * c_.values));
+                    auto step = std::max(1, n / c_.list_size);
+                    std::string r = "i" + std::to_string(pick(ints_.size())) + " in (";
+                    for (int v = 0, k = 0; v < n; v += step, ++k) r += (k ? ", " : "") + std::to_string(v);
+                    return r + ")";
+                }
+            case 2:
+                if (reals_.empty()) break;
+                return "r" + std::to_string(pick(reals_.size())) + " >= " + std::to_string(1 - s);
+            case 3:
+                if (strs_.empty()) break;
+                return "s" + std::to_string(pick(strs_.size())) + " in "
+                    + words(std::max<std::size_t>(1, std::size_t(s * c_.words)));
+            case 4:
+                if (int_lists_.empty()) break;
+                return "l" + std::to_string(pick(int_lists_.size())) + " one of (" + std::to_string(pick(c_.values))
+                    + ", " + std::to_string(pick(c_.values)) + ")";
+            case 5:
+                if (str_lists_.empty()) break;
+                return "'" + words_[pick(words_.size())] + "' in t" + std::to_string(pick(str_lists_.size()));
+            }
+        }
+    }
+
+    Config c_;
+    std::mt19937 rng_;
+    std::vector<VarIdx> bools_, ints_, reals_, strs_, int_lists_, str_lists_;
+    std::vector<std::string> words_;
+};
+
+using Clock = std::chrono::steady_clock;
+
+double seconds(Clock::time_point t) {
+    return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+void report(const char* name, double value, const char* unit) {
+    std::printf("%s\t%.6g\t%s\n", name, value, unit);
+}
+
+// keeps results alive
+volatile std::size_t sink;
+
+// list values of records
+struct Lists {
+    std::deque<std::vector<int>> ints;
+    std::deque<std::vector<std::string_view>> strs;
+};
+
+// Workload sink filling a record
+struct RecordSink {
+    lexen::Record& r;
+    Lists& lists;
+    void set_bool(VarIdx v, bool x) { r.set_bool(v, x); }
+    void set_int(VarIdx v, int x) { r.set_int(v, x); }
+    void set_real(VarIdx v, double x) { r.set_real(v, x); }
+    void set_str(VarIdx v, std::string_view x) { r.set_str(v, x); }
+    void set_ints(VarIdx v, std::vector<int> x) {
+        lists.ints.push_back(std::move(x));
+        r.set_ints(v, lists.ints.back());
+    }
+    void set_strs(VarIdx v, std::vector<std::string_view> x) {
+        lists.strs.push_back(std::move(x));
+        r.set_strs(v, lists.strs.back());
+    }
+};
+
+// Workload sink filling batch columns, row by row
+struct Columns {
+    explicit Columns(std::size_t n) : rows(n) {}
+
+    std::size_t rows, row = 0;
+    std::unordered_map<int, std::unique_ptr<bool[]>> bools;  // vector<bool> is packed
+    std::unordered_map<int, std::vector<int>> ints;
+    std::unordered_map<int, std::vector<double>> reals;
+    std::unordered_map<int, std::vector<std::string_view>> strs;
+    std::unordered_map<int, std::vector<std::uint32_t>> offsets;
+    std::unordered_map<int, std::vector<int>> int_values;
+    std::unordered_map<int, std::vector<std::string_view>> str_values;
+
+    void set_bool(VarIdx v, bool x) {
+        auto& col = bools[v.index];
+        if (!col) col = std::make_unique<bool[]>(rows);
+        col[row] = x;
+    }
+    void set_int(VarIdx v, int x) { at(ints[v.index]) = x; }
+    void set_real(VarIdx v, double x) { at(reals[v.index]) = x; }
+    void set_str(VarIdx v, std::string_view x) { at(strs[v.index]) = x; }
+    void set_ints(VarIdx v, std::vector<int> x) { list(v, int_values[v.index], x); }
+    void set_strs(VarIdx v, std::vector<std::string_view> x) { list(v, str_values[v.index], x); }
+
+    template<typename T>
+    T& at(std::vector<T>& col) {
+        col.resize(rows);
+        return col[row];
+    }
+
+    template<typename T>
+    void list(VarIdx v, std::vector<T>& values, const std::vector<T>& x) {
+        auto& off = offsets[v.index];
+        if (off.empty()) off.push_back(0);
+        values.insert(values.end(), x.begin(), x.end());
+        off.push_back(std::uint32_t(values.size()));
+    }
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Config c;
+    if (!parse_args(argc, argv, c)) {
+        std::fprintf(stderr, "usage: lexen_bench [--name=value ...], names:");
+        for (auto& o : options) std::fprintf(stderr, " %s", o.name);
+        std::fprintf(stderr, " seed\n");
+        return 2;
+    }
+    for (auto& o : options) {
+        if (o.i) std::printf("# %s\t%d\n", o.name, c.*o.i);
+        else std::printf("# %s\t%g\n", o.name, c.*o.d);
+    }
+    std::printf("# seed\t%u\n", c.seed);
+
+    Workload w(c);
+    std::vector<std::string> srcs;
+    std::size_t bytes = 0;
+    for (int i = 0; i < c.exprs; ++i) {
+        srcs.push_back(w.expression());
+        bytes += srcs.back().size();
+    }
+
+    // parse
+    std::vector<lexen::ast::Expression> exprs(srcs.size());
+    auto t = Clock::now();
+    for (std::size_t i = 0; i < srcs.size(); ++i) {
+        if (!lexen::parse_str(srcs[i], exprs[i], w.schema)) {
+            std::fprintf(stderr, "can't parse: %s\n", srcs[i].c_str());
+            return 1;
+        }
+    }
+    auto dt = seconds(t);
+    report("parse", double(srcs.size()) / dt, "expr/s");
+    report("parse_bytes", double(bytes) / dt / 1e6, "MB/s");
+
+    // parse into a reused arena
+    lexen::CompactAst arena;
+    t = Clock::now();
+    for (auto& src : srcs) {
+        arena.clear();
+        if (!lexen::parse_compact(src, arena, w.schema)) {
+            std::fprintf(stderr, "can't parse: %s\n", src.c_str());
+            return 1;
+        }
+    }
+    report("parse_compact", double(srcs.size()) / seconds(t), "expr/s");
+
+    // compile
+    std::vector<lexen::Program> progs(exprs.size());
+    t = Clock::now();
+    for (std::size_t i = 0; i < exprs.size(); ++i) progs[i] = lexen::compile(exprs[i]);
+    dt = seconds(t);
+    report("compile", dt / double(exprs.size()) * 1e6, "us/expr");
+
+    // records
+    Lists lists;
+    std::vector<lexen::Record> records;
+    for (int i = 0; i < c.records; ++i) {
+        records.emplace_back(w.schema);
+        RecordSink sink{records.back(), lists};
+        w.record(sink);
+    }
+
+    // single record latency, every expression against a few records
+    std::size_t hits = 0, evals = 0;
+    t = Clock::now();
+    for (std::size_t i = 0; i < progs.size(); ++i) {
+        for (std::size_t j = 0; j < 16; ++j) {
+            hits += lexen::eval(progs[i], records[(i * 16 + j) % records.size()]);
+            ++evals;
+        }
+    }
+    dt = seconds(t);
+    report("eval", dt / double(evals) * 1e9, "ns/eval");
+    report("eval_selectivity", double(hits) / double(evals), "ratio");
+
+    // batch, columns of the same kind of values
+    auto rows = std::size_t(c.rows);
+    auto set_columns = [&w] (lexen::Batch& batch, Columns& cols) {
+        for (; cols.row < cols.rows; ++cols.row) w.record(cols);
+        for (auto& x : cols.bools) batch.set_bools(VarIdx(x.first), x.second.get());
+        for (auto& x : cols.ints) batch.set_ints(VarIdx(x.first), x.second.data());
+        for (auto& x : cols.reals) batch.set_reals(VarIdx(x.first), x.second.data());
+        for (auto& x : cols.strs) batch.set_strs(VarIdx(x.first), x.second.data());
+        for (auto& x : cols.int_values) batch.set_int_lists(VarIdx(x.first), cols.offsets[x.first].data(), x.second.data());
+        for (auto& x : cols.str_values) batch.set_str_lists(VarIdx(x.first), cols.offsets[x.first].data(), x.second.data());
+    };
+    lexen::Batch batch(w.schema, rows);
+    Columns cols(rows);
+    set_columns(batch, cols);
+
+    lexen::BatchContext ctx;
+    auto batch_exprs = std::min<std::size_t>(progs.size(), 1000);
+    t = Clock::now();
+    for (std::size_t i = 0; i < batch_exprs; ++i) {
+        auto r = lexen::eval(progs[i], batch, ctx);
+        sink = sink + r[0];
+    }
+    dt = seconds(t);
+    report("batch_eval", double(batch_exprs * rows) / dt, "rows/s");
+
+    // large batch on all workers of a pool and the calling thread
+    auto par_rows = std::size_t(c.par_rows);
+    lexen::Batch par_batch(w.schema, par_rows);
+    Columns par_cols(par_rows);
+    set_columns(par_batch, par_cols);
+    lexen::ThreadPool pool(c.threads > 0 ? unsigned(c.threads) : std::thread::hardware_concurrency());
+    lexen::ParallelEval par(pool);
+    auto par_exprs = std::min<std::size_t>(progs.size(), 20);
+    t = Clock::now();
+    for (std::size_t i = 0; i < par_exprs; ++i) {
+        auto r = par.eval(progs[i], par_batch);
+        sink = sink + r[0];
+    }
+    dt = seconds(t);
+    report("batch_parallel", double(par_exprs * par_rows) / dt, "rows/s");
+    report("batch_parallel_workers", pool.size() + 1, "threads");
+
+    // many rules against a record
+    auto n_rules = std::min<std::size_t>(exprs.size(), std::size_t(c.rules));
+    lexen::RuleSet set;
+    lexen::RuleIndex index;
+    t = Clock::now();
+    for (std::size_t i = 0; i < n_rules; ++i) set.add(exprs[i]);
+    set.build();
+    report("rule_set_build", seconds(t) * 1e3, "ms");
+    t = Clock::now();
+    for (std::size_t i = 0; i < n_rules; ++i) index.add(exprs[i]);
+    index.build();
+    report("rule_index_build", seconds(t) * 1e3, "ms");
+
+    std::vector<std::uint32_t> out;
+    auto match_records = std::min<std::size_t>(records.size(), 1000);
+    lexen::RuleSetContext set_ctx;
+    t = Clock::now();
+    for (std::size_t i = 0; i < match_records; ++i) {
+        set.eval(records[i], set_ctx, out);
+        sink = sink + out.size();
+    }
+    report("rule_set_match", double(match_records) / seconds(t), "records/s");
+    lexen::MatchContext index_ctx;
+    t = Clock::now();
+    for (std::size_t i = 0; i < match_records; ++i) {
+        index.match(records[i], index_ctx, out);
+        sink = sink + out.size();
+    }
+    report("rule_index_match", double(match_records) / seconds(t), "records/s");
+    sink = sink + hits;
+    return 0;
+}
@@ -0,0 +1,248 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions engine - adaptive predicate ordering
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+#pragma once
+
+#include <cmath>
+#include <limits>
+
+#include "eval.hpp"
+#include "optimize.hpp"
+
+namespace lexen {
+
+namespace detail {
+
+// static cost estimate of a predicate, in units of a numeric comparison
+inline double op_cost(const Program& p, const Instr& in) {
+    auto log = [] (std::uint32_t n) { return std::log2(double(n) + 1); };
+    switch (in.op) {
+    case OpCode::BoolVar:
+    case OpCode::IsNull:
+    case OpCode::IsNotNull:
+    case OpCode::IsEmpty:
+    case OpCode::NumCmp:
+    case OpCode::NumRange:
+    case OpCode::Pred:
+        return 1;
+    case OpCode::StrEq:   return 2;
+    case OpCode::IntIn:   return 2;
+    case OpCode::StrIn:   return 3;
+    case OpCode::HasInt:  return 4;
+    case OpCode::HasStr:  return 8;
+    case OpCode::IntsVs:  return 4 + 2 * log(in.arg.slice.size);
+    case OpCode::StrsVs:  return 8 + 4 * log(in.arg.slice.size);
+    case OpCode::Ext:
+#ifdef PREDICATE_EXTENSION_AST_TYPE
+        return ext_cost(p.ext[in.arg.slice.offset]);
+#else
+        (void)p;
+        return 16;
+#endif
+    }
+    return 1;
+}
+
+} // detail
+
+/*
+ * Expression compiled with the items of its and/or nodes ordered by
+ * observed selectivity. Every sample-th evaluation counts how often each
+ * predicate is reached and passed; after every period samples items are
+ * reordered, cheapest and most decisive first: ascending cost / (1 - p)
+ * for and, cost / p for or, where p is the estimated probability of the
+ * item to be true, and the program is recompiled. Counters are halved on
+ * reorder, so the order follows drifting traffic. Items of and/or commute,
+ * so any order gives the same result.
+ *
+ * Counters are not synchronized, use an instance per thread.
+ */
+class AdaptiveProgram {
+public:
+    // the schema is the one the expression was parsed with
+    explicit AdaptiveProgram(const ast::Expression& e, const Schema& schema,
+        std::uint32_t sample = 64, std::uint32_t period = 1024)
+        : sample_(sample), period_(period)
+    {
+        BOOST_ASSERT_MSG(sample > 0 && period > 0, "zero sampling rate");
+        // negation only above leaves, so true target of a leaf is true of the item
+        root_ = build(optimize(e, schema));
+        stats_.resize(leaves_.size());
+        recompile();
+    }
+
+    template<typename Record>
+    bool eval(const Record& rec) {
+        if (++calls_ < sample_) return lexen::eval(prog_, rec, keys_, ext_cache_);
+        calls_ = 0;
+        const Instr* code = prog_.code.data();
+        std::uint32_t pc = prog_.entry;
+        keys_.reset();
+        while (pc < Program::reject) {
+            const Instr& in = code[pc];
+            bool null;
+            bool r = detail::test(prog_, in, rec, null, &keys_, ext_cache_);
+            bool pass = !null && r != in.neg;
+            auto& s = stats_[leaf_at_[pc]];
+            s.reached += 1;
+            s.passed += pass;
+            pc = pass ? in.on_true : in.on_false;
+        }
+        if (++samples_ == period_) reorder();
+        return pc == Program::accept;
+    }
+
+    // reorder with the statistics collected so far
+    void reorder() {
+        samples_ = 0;
+        estimate(root_);
+        recompile();
+        for (auto& s : stats_) {
+            s.reached /= 2;
+            s.passed /= 2;
+        }
+    }
+
+    const Program& program() const { return prog_; }
+
+    // results of extensions, see extension.hpp; not owned
+    void set_ext_cache(ResultCache* cache) { ext_cache_ = cache; }
+
+    // expression in the current order
+    ast::Expression expression() const { return expr(root_); }
+
+private:
+    struct Node {
+        bool all = false;                   // and, otherwise or
+        std::vector<std::uint32_t> items;   // empty for leaves
+        std::int32_t leaf = -1;             // index of leaf
+        double p = 0.5;                     // estimated probability to be true
+        double cost = 0;                    // estimated cost of evaluation
+    };
+
+    struct Stats {
+        double reached = 0;
+        double passed = 0;
+    };
+
+    // Bounds of a variable in either order, as a range with the lower one
+    // first. Such a conjunction is a single leaf, reordering its bounds
+    // would change the number of instructions, see detail::is_range().
+    static bool range(const ast::Conjunction& x, ast::Expression& out) {
+        if (x.items.size() != 2) return false;
+        for (std::size_t lo : {0, 1}) {
+            ast::Conjunction r{{x.items[lo], x.items[1 - lo]}};
+            if (!detail::is_range(r)) continue;
+            out = ast::Expression(r);
+            return true;
+        }
+        return false;
+    }
+
+    std::uint32_t build(const ast::Expression& e) {
+        Node n;
+        const std::vector<ast::Expression>* items = nullptr;
+        ast::Expression leaf = e;
+        if (auto c = boost::get<x3::forward_ast<ast::Conjunction>>(&e.get())) {
+            if (!range(c->get(), leaf)) items = &c->get().items;
+            n.all = true;
+        } else if (auto d = boost::get<x3::forward_ast<ast::Disjunction>>(&e.get())) {
+            items = &d->get().items;
+            n.all = false;
+        }
+        if (!items) {
+            n.leaf = std::int32_t(leaves_.size());
+            leaves_.push_back(leaf);
+        }
+        auto id = std::uint32_t(nodes_.size());
+        nodes_.push_back(n);
+        if (items) {
+            for (auto& x : *items) {
+                auto item = build(x);
+                nodes_[id].items.push_back(item);
+            }
+        }
+        return id;
+    }
+
+    ast::Expression expr(std::uint32_t id) const {
+        auto& n = nodes_[id];
+        if (n.leaf >= 0) return leaves_[n.leaf];
+        std::vector<ast::Expression> items;
+        for (auto i : n.items) items.push_back(expr(i));
+        if (n.all) return ast::Expression(ast::Conjunction{items});
+        return ast::Expression(ast::Disjunction{items});
+    }
+
+    // instruction of every leaf in order of emission
+    void layout(std::uint32_t id) {
+        auto& n = nodes_[id];
+        if (n.leaf >= 0) {
+            if (detail::leaves(leaves_[n.leaf])) leaf_at_.push_back(std::uint32_t(n.leaf));
+            return;
+        }
+        for (auto i : n.items) layout(i);
+    }
+
+    void recompile() {
+        prog_ = compile(expr(root_));
+        leaf_at_.clear();
+        layout(root_);
+        BOOST_ASSERT(leaf_at_.size() == prog_.code.size());
+        costs_.assign(leaves_.size(), 0);
+        for (std::size_t pc = 0; pc < leaf_at_.size(); ++pc)
+            costs_[leaf_at_[pc]] = detail::op_cost(prog_, prog_.code[pc]);
+    }
+
+    // Estimates probability and cost of the node, sorts items of and/or.
+    // Items are assumed independent.
+    void estimate(std::uint32_t id) {
+        auto& n = nodes_[id];
+        if (n.leaf >= 0) {
+            auto& s = stats_[n.leaf];
+            // a leaf never reached keeps the neutral estimate
+            n.p = s.reached > 0 ? s.passed / s.reached : 0.5;
+            n.cost = costs_[n.leaf];
+            return;
+        }
+        for (auto i : n.items) estimate(i);
+        auto rank = [this, all = n.all] (std::uint32_t i) {
+            auto& x = nodes_[i];
+            auto decisive = all ? 1 - x.p : x.p;
+            return decisive > 0 ? x.cost / decisive : std::numeric_limits<double>::infinity();
+        };
+        std::stable_sort(n.items.begin(), n.items.end(),
+            [&rank] (std::uint32_t a, std::uint32_t b) { return rank(a) < rank(b); });
+        // probability to get to the next item
+        double go_on = 1;
+        n.cost = 0;
+        for (auto i : n.items) {
+            auto& x = nodes_[i];
+            n.cost += go_on * x.cost;
+            go_on *= n.all ? x.p : 1 - x.p;
+        }
+        n.p = n.all ? go_on : 1 - go_on;
+    }
+
+    std::uint32_t sample_;
+    std::uint32_t period_;
+    std::uint32_t calls_ = 0;
+    std::uint32_t samples_ = 0;
+
+    std::vector<Node> nodes_;
+    std::vector<ast::Expression> leaves_;
+    std::uint32_t root_;
+
+    Program prog_;
+    std::vector<std::uint32_t> leaf_at_;    // per instruction
+    std::vector<double> costs_;             // per leaf
+    std::vector<Stats> stats_;              // per leaf
+    StrKeyCache keys_;                      // scratch reused by eval()
+    ResultCache* ext_cache_ = nullptr;
+};
+
+} // lexen
@@ -0,0 +1,124 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions parser - AST hashing
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+#pragma once
+
+#include <boost/container_hash/hash.hpp>
+
+#include "ast.hpp"
+
+// hash_value() overloads to be found by boost::hash, consistent with
+// operator== of the AST nodes
+
+namespace lexen { namespace ast {
+
+inline std::size_t hash_value(const VarIdx& v) {
+    return boost::hash<int>()(v.index);
+}
+
+inline std::size_t hash_value(const BoolVal& v) {
+    return boost::hash<bool>()(v.value);
+}
+
+inline std::size_t hash_value(const NumVal& v) {
+    std::size_t seed = v.get().which();
+    boost::apply_visitor([&seed] (auto x) { boost::hash_combine(seed, x); }, v);
+    return seed;
+}
+
+inline std::size_t hash_value(const UnaryExpr& x) {
+    std::size_t seed = 0;
+    boost::hash_combine(seed, x.var);
+    boost::hash_combine(seed, int(x.op));
+    return seed;
+}
+
+inline std::size_t hash_value(const NumComp& x) {
+    std::size_t seed = 0;
+    boost::hash_combine(seed, x.var);
+    boost::hash_combine(seed, x.val);
+    boost::hash_combine(seed, int(x.cmp));
+    return seed;
+}
+
+inline std::size_t hash_value(const StrComp& x) {
+    std::size_t seed = 0;
+    boost::hash_combine(seed, x.var);
+    boost::hash_combine(seed, x.val);
+    boost::hash_combine(seed, int(x.cmp));
+    return seed;
+}
+
+template<typename T>
+inline std::size_t hash_value(const ValInSet<T>& x) {
+    std::size_t seed = 0;
+    boost::hash_combine(seed, x.val);
+    boost::hash_combine(seed, int(x.op));
+    boost::hash_combine(seed, x.set);
+    return seed;
+}
+
+template<typename T>
+inline std::size_t hash_value(const VarInSet<T>& x) {
+    std::size_t seed = 0;
+    boost::hash_combine(seed, x.var);
+    boost::hash_combine(seed, int(x.op));
+    boost::hash_range(seed, x.set.begin(), x.set.end());
+    return seed;
+}
+
+inline std::size_t hash_value(const SetExpr& v) {
+    std::size_t seed = v.get().which();
+    boost::apply_visitor([&seed] (const auto& x) { boost::hash_combine(seed, x); }, v);
+    return seed;
+}
+
+template<typename T>
+inline std::size_t hash_value(const VarVsSet<T>& x) {
+    std::size_t seed = 0;
+    boost::hash_combine(seed, x.var);
+    boost::hash_combine(seed, int(x.op));
+    boost::hash_range(seed, x.set.begin(), x.set.end());
+    return seed;
+}
+
+inline std::size_t hash_value(const ListExpr& v) {
+    std::size_t seed = v.get().which();
+    boost::apply_visitor([&seed] (const auto& x) { boost::hash_combine(seed, x); }, v);
+    return seed;
+}
+
+inline std::size_t hash_value(const Expression& e);
+
+inline std::size_t hash_value(const Conjunction& x) {
+    return boost::hash_range(x.items.begin(), x.items.end());
+}
+
+inline std::size_t hash_value(const Disjunction& x) {
+    return boost::hash_range(x.items.begin(), x.items.end());
+}
+
+inline std::size_t hash_value(const Negation& x) {
+    return hash_value(x.expr);
+}
+
+struct expr_hash_visitor : boost::static_visitor<std::size_t> {
+    template<typename T>
+    std::size_t operator()(const T& x) const { return boost::hash<T>()(x); }
+    template<typename T>
+    std::size_t operator()(const x3::forward_ast<T>& x) const { return hash_value(x.get()); }
+};
+
+// Structural hash, stable across runs: combines alternative index with
+// the hash of the node, compound nodes combine hashes of their items.
+inline std::size_t hash_value(const Expression& e) {
+    std::size_t seed = e.get().which();
+    boost::hash_combine(seed, boost::apply_visitor(expr_hash_visitor(), e));
+    return seed;
+}
+
+} } // lexen::ast
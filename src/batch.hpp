@@ -0,0 +1,518 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions engine - columnar batch evaluation
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+#pragma once
+
+#include "eval.hpp"
+#include "schema.hpp"
+#include "simd.hpp"
+
+namespace lexen {
+
+// one bit per row
+using Bitmap = std::vector<std::uint64_t>;
+
+inline bool test_bit(const std::uint64_t* b, std::size_t i) {
+    return b[i / 64] >> (i % 64) & 1;
+}
+
+// Column of values of one variable, data is owned by the caller. Missing
+// validity bitmap means all values are valid. List columns are in Arrow
+// layout: elements of row i are data[offsets[i] .. offsets[i + 1]).
+// Dictionary-encoded string columns hold 32-bit codes of dict.
+struct Column {
+    const void* data = nullptr;
+    const std::uint64_t* valid = nullptr;
+    const std::uint32_t* offsets = nullptr;
+    const Dictionary* dict = nullptr;
+};
+
+// N records stored column-wise, one column per variable. Variables without
+// column, including ones added to the schema after the batch was made and
+// not set, are null in all rows.
+class Batch {
+public:
+    Batch(const Schema& schema, std::size_t rows)
+        : schema_(&schema), rows_(rows), columns_(schema.vars()) {}
+
+    const Schema& schema() const { return *schema_; }
+    std::size_t rows() const { return rows_; }
+
+    void set_bools(ast::VarIdx var, const bool* data, const std::uint64_t* valid = nullptr) {
+        put(var, var_type::boolean, data, valid);
+    }
+    void set_ints(ast::VarIdx var, const int* data, const std::uint64_t* valid = nullptr) {
+        put(var, var_type::integer, data, valid);
+    }
+    void set_reals(ast::VarIdx var, const double* data, const std::uint64_t* valid = nullptr) {
+        put(var, var_type::realnum, data, valid);
+    }
+    void set_strs(ast::VarIdx var, const std::string_view* data, const std::uint64_t* valid = nullptr) {
+        put(var, var_type::string, data, valid);
+    }
+    // dictionary-encoded strings, the dictionary is owned by the caller
+    void set_str_codes(ast::VarIdx var, const std::uint32_t* codes, const Dictionary& dict,
+        const std::uint64_t* valid = nullptr)
+    {
+        put(var, var_type::string, codes, valid);
+        columns_[var.index].dict = &dict;
+    }
+    // offsets has rows + 1 elements
+    void set_int_lists(ast::VarIdx var, const std::uint32_t* offsets, const int* values,
+        const std::uint64_t* valid = nullptr)
+    {
+        put(var, var_type::integers, values, valid, offsets);
+    }
+    void set_str_lists(ast::VarIdx var, const std::uint32_t* offsets, const std::string_view* values,
+        const std::uint64_t* valid = nullptr)
+    {
+        put(var, var_type::strings, values, valid, offsets);
+    }
+
+    const Column& column(ast::VarIdx var) const {
+        static const Column none;
+        return std::size_t(var.index) < columns_.size() ? columns_[var.index] : none;
+    }
+
+    template<typename T>
+    const T* data(ast::VarIdx var) const { return static_cast<const T*>(column(var).data); }
+
+    bool is_null(ast::VarIdx var, std::size_t row) const {
+        auto& c = column(var);
+        return !c.data || (c.valid && !test_bit(c.valid, row));
+    }
+
+    // elements of a list column row
+    template<typename T>
+    ListView<T> list(ast::VarIdx var, std::size_t row) const {
+        auto& c = column(var);
+        return ListView<T>(static_cast<const T*>(c.data) + c.offsets[row], c.offsets[row + 1] - c.offsets[row]);
+    }
+
+    // Rows [first, first + rows) as a batch over the same data. First must
+    // be a multiple of 64, so validity bitmaps stay word aligned; list
+    // columns keep their values and start at offsets[first].
+    Batch slice(std::size_t first, std::size_t rows) const {
+        BOOST_ASSERT_MSG(first % 64 == 0 && first + rows <= rows_, "bad batch slice");
+        Batch r(*schema_, rows);
+        for (std::size_t i = 0; i < columns_.size(); ++i) {
+            auto c = columns_[i];
+            if (!c.data) continue;
+            if (c.valid) c.valid += first / 64;
+            if (c.offsets) c.offsets += first;
+            else c.data = static_cast<const char*>(c.data) + first * width(schema_->type(ast::VarIdx(int(i))), c.dict);
+            r.columns_[i] = c;
+        }
+        return r;
+    }
+
+private:
+    // bytes per row of a scalar column
+    static std::size_t width(var_type type, const Dictionary* dict) {
+        switch (type) {
+        case var_type::boolean: return sizeof(bool);
+        case var_type::integer: return sizeof(int);
+        case var_type::realnum: return sizeof(double);
+        default: return dict ? sizeof(std::uint32_t) : sizeof(std::string_view);
+        }
+    }
+
+    void put(ast::VarIdx var, var_type type, const void* data, const std::uint64_t* valid,
+        const std::uint32_t* offsets = nullptr)
+    {
+        BOOST_ASSERT_MSG(schema_->has(var) && schema_->type(var) == type, "variable type mismatch");
+        (void)type;
+        if (std::size_t(var.index) >= columns_.size()) columns_.resize(schema_->vars());
+        columns_[var.index] = Column{data, valid, offsets};
+    }
+
+    const Schema* schema_;
+    std::size_t rows_;
+    std::vector<Column> columns_;
+};
+
+// single row of a batch as a record
+class BatchRow {
+public:
+    BatchRow(const Batch& b, std::size_t row) : b_(b), row_(row) {}
+
+    bool is_null(ast::VarIdx var) const { return b_.is_null(var, row_); }
+    bool is_empty(ast::VarIdx var) const {
+        auto offsets = b_.column(var).offsets;
+        return offsets[row_ + 1] == offsets[row_];
+    }
+    bool get_bool(ast::VarIdx var) const { return b_.data<bool>(var)[row_]; }
+    double get_num(ast::VarIdx var) const {
+        return b_.schema().type(var) == var_type::integer
+            ? b_.data<int>(var)[row_] : b_.data<double>(var)[row_];
+    }
+    std::string_view get_str(ast::VarIdx var) const {
+        auto& c = b_.column(var);
+        if (c.dict) return c.dict->str(static_cast<const std::uint32_t*>(c.data)[row_]);
+        return b_.data<std::string_view>(var)[row_];
+    }
+    ListView<int> get_ints(ast::VarIdx var) const { return b_.list<int>(var, row_); }
+    ListView<std::string_view> get_strs(ast::VarIdx var) const { return b_.list<std::string_view>(var, row_); }
+
+private:
+    const Batch& b_;
+    std::size_t row_;
+};
+
+// Reusable scratch space of batch evaluation. Each step of evaluation runs
+// either dense, over whole words of the reached rows with vectorized
+// kernels, or sparse, over the selection vector of reached row ids; sparse
+// is chosen when reached rows make less than sparse_fraction of the range.
+struct BatchContext {
+    double sparse_fraction = 1.0 / 16;
+    // results of extensions over dictionary-encoded columns, see
+    // extension.hpp; not owned
+    ResultCache* ext_cache = nullptr;
+
+    std::vector<std::uint64_t> reach;
+    Bitmap truth;
+    Bitmap known;
+    Bitmap elems;   // per element of list column
+    std::vector<std::uint32_t> sel;
+    StrKeyCache keys;   // per row of the sparse fallback
+};
+
+namespace detail {
+
+// Code of the StrEq literal in the dictionary of the column, or npos if
+// the dictionary does not have it.
+template<typename P>
+inline std::uint32_t lit_code(const P& p, const Instr& in, const Column& c) {
+    if (p.dict == c.dict) return p.lit_codes[&in - p.code.data()];
+    return c.dict->find(p.str(in.arg.slice));
+}
+
+// Predicate of a dictionary-encoded string column: integer compare of the
+// codes for StrEq, lookup of the codes in the interned set for StrIn.
+// Returns false for sets interned into another dictionary. Masks are at
+// lo already.
+template<typename P>
+inline bool codes(const P& p, const Instr& in, const Column& c, std::size_t lo, std::size_t hi,
+    std::size_t n, std::uint64_t* truth, std::uint64_t* known)
+{
+    auto x = static_cast<const std::uint32_t*>(c.data) + lo * 64;
+    if (in.op == OpCode::StrEq) {
+        auto code = lit_code(p, in, c);
+        if (code == Dictionary::npos) simd::fill(truth, n, false);
+        else simd::cmp_i32(reinterpret_cast<const int*>(x), n, ast::CompOp::Eq, int(code), truth);
+    } else {
+        if (p.dict != c.dict) return false;
+        auto& s = p.code_sets[in.arg.slice.offset];
+        simd::fill(truth, n, false);
+        for (std::size_t i = 0; i < n; ++i)
+            truth[i / 64] |= std::uint64_t(p.int_pool.has(s, int(x[i]))) << (i % 64);
+    }
+    if (c.valid) std::copy(c.valid + lo, c.valid + hi, known);
+    else simd::fill(known, n, true);
+    return true;
+}
+
+// List predicate over rows of words [lo, hi) of a list column: an element
+// predicate is computed for all elements of the rows at once into elems,
+// then a row is true if any of its elements is. There is no such kernel
+// for "all of". Masks are at lo already.
+template<typename P>
+inline bool lists(const P& p, const Instr& in, const Column& c, std::size_t lo, std::size_t hi,
+    std::size_t n, std::uint64_t* truth, std::uint64_t* known, Bitmap& elems)
+{
+    if ((in.op == OpCode::IntsVs || in.op == OpCode::StrsVs) && ast::ListOp(in.sub) == ast::ListOp::AllOf)
+        return false;
+    if (!c.data) {
+        simd::fill(truth, n, false);
+        simd::fill(known, n, false);
+        return true;
+    }
+    auto first = lo * 64;
+    auto base = c.offsets[first];
+    std::size_t m = c.offsets[first + n] - base;
+    elems.assign(simd::words(m), 0);
+    auto out = elems.data();
+    auto set = [out] (std::size_t i, bool x) { out[i / 64] |= std::uint64_t(x) << (i % 64); };
+    switch (in.op) {
+    case OpCode::HasInt:
+        if (m) simd::cmp_i32(static_cast<const int*>(c.data) + base, m, ast::CompOp::Eq, in.arg.ival, out);
+        break;
+    case OpCode::IntsVs: {
+        auto x = static_cast<const int*>(c.data) + base;
+        auto& s = p.int_sets[in.arg.slice.offset];
+        for (std::size_t i = 0; i < m; ++i) set(i, p.int_pool.has(s, x[i]));
+        break;
+    }
+    case OpCode::HasStr: {
+        auto x = static_cast<const std::string_view*>(c.data) + base;
+        auto lit = p.str(in.arg.slice);
+        for (std::size_t i = 0; i < m; ++i) set(i, x[i] == lit);
+        break;
+    }
+    default: {
+        auto x = static_cast<const std::string_view*>(c.data) + base;
+        auto& s = p.str_sets[in.arg.slice.offset];
+        for (std::size_t i = 0; i < m; ++i) set(i, has_str(p, s, x[i], str_key(x[i])));
+        break;
+    }
+    }
+    simd::fill(truth, n, false);
+    for (std::size_t i = 0; i < n; ++i) {
+        auto row = first + i;
+        truth[i / 64] |= std::uint64_t(simd::any(out, c.offsets[row] - base, c.offsets[row + 1] - base)) << (i % 64);
+    }
+    if (c.valid) std::copy(c.valid + lo, c.valid + hi, known);
+    else simd::fill(known, n, true);
+    return true;
+}
+
+// Predicate of the instruction over rows of words [lo, hi) of the batch,
+// into truth and known (not null) masks. Returns false if there is no
+// vectorized kernel.
+template<typename P>
+inline bool dense(const P& p, const Instr& in, const Batch& b, std::size_t lo, std::size_t hi,
+    std::uint64_t* truth, std::uint64_t* known, Bitmap& elems)
+{
+    ast::VarIdx var(in.var);
+    auto first = lo * 64;
+    auto n = std::min(b.rows(), hi * 64) - first;
+    auto& c = b.column(var);
+    truth += lo;
+    known += lo;
+    switch (in.op) {
+    case OpCode::IsNull:
+    case OpCode::IsNotNull:
+        simd::fill(known, n, true);
+        if (!c.data) simd::fill(truth, n, false);
+        else if (!c.valid) simd::fill(truth, n, true);
+        else std::copy(c.valid + lo, c.valid + hi, truth);
+        if (in.op == OpCode::IsNull) {
+            for (std::size_t i = 0; i < hi - lo; ++i) truth[i] = ~truth[i];
+            simd::trim(truth, n);
+        }
+        return true;
+    case OpCode::IsEmpty:
+        simd::fill(known, n, true);
+        simd::fill(truth, n, false);
+        for (std::size_t i = 0; i < n; ++i) {
+            auto row = first + i;
+            bool empty = !c.data || (c.valid && !test_bit(c.valid, row)) || c.offsets[row + 1] == c.offsets[row];
+            truth[i / 64] |= std::uint64_t(empty) << (i % 64);
+        }
+        return true;
+    case OpCode::HasInt:
+    case OpCode::HasStr:
+    case OpCode::IntsVs:
+    case OpCode::StrsVs:
+        return lists(p, in, c, lo, hi, n, truth, known, elems);
+    case OpCode::StrEq:
+    case OpCode::StrIn:
+        if (!c.data || !c.dict) return false;
+        return codes(p, in, c, lo, hi, n, truth, known);
+    case OpCode::BoolVar:
+    case OpCode::NumCmp:
+    case OpCode::NumRange:
+        break;
+    default:
+        return false;
+    }
+    if (!c.data) {
+        simd::fill(truth, n, false);
+        simd::fill(known, n, false);
+        return true;
+    }
+    auto cmp = [&] (ast::CompOp op, double lit, std::uint64_t* out) {
+        if (b.schema().type(var) == var_type::integer)
+            simd::cmp_i32(static_cast<const int*>(c.data) + first, n, op, lit, out);
+        else
+            simd::cmp_f64(static_cast<const double*>(c.data) + first, n, op, lit, out);
+    };
+    if (in.op == OpCode::BoolVar) {
+        simd::bools(static_cast<const bool*>(c.data) + first, n, truth);
+    } else if (in.op == OpCode::NumRange) {
+        // lower bound into truth, upper one into known which is set below
+        auto bounds = &p.nums[in.arg.slice.offset];
+        cmp(in.sub & 1 ? ast::CompOp::Gt : ast::CompOp::Ge, bounds[0], truth);
+        cmp(in.sub & 2 ? ast::CompOp::Lt : ast::CompOp::Le, bounds[1], known);
+        for (std::size_t i = 0; i < hi - lo; ++i) truth[i] &= known[i];
+    } else {
+        cmp(ast::CompOp(in.sub), in.arg.num, truth);
+    }
+    if (c.valid) std::copy(c.valid + lo, c.valid + hi, known);
+    else simd::fill(known, n, true);
+    return true;
+}
+
+// Predicate of the instruction over selected rows only. Bits of the rows
+// not selected are left cleared.
+template<typename P>
+inline void sparse(const P& p, const Instr& in, const Batch& b,
+    const std::vector<std::uint32_t>& sel, std::uint64_t* truth, std::uint64_t* known,
+    StrKeyCache& keys, ResultCache* cache = nullptr)
+{
+    ast::VarIdx var(in.var);
+    auto& c = b.column(var);
+    auto set = [truth, known] (std::uint32_t row, bool x, bool null) {
+        truth[row / 64] |= std::uint64_t(x) << (row % 64);
+        known[row / 64] |= std::uint64_t(!null) << (row % 64);
+    };
+    auto valid = [&c] (std::uint32_t row) { return !c.valid || test_bit(c.valid, row); };
+    switch (in.op) {
+    case OpCode::IsNull:
+    case OpCode::IsNotNull:
+        for (auto row : sel) set(row, (c.data && valid(row)) == (in.op == OpCode::IsNotNull), false);
+        return;
+    case OpCode::BoolVar:
+        if (!c.data) return;
+        for (auto row : sel) if (valid(row)) set(row, static_cast<const bool*>(c.data)[row], false);
+        return;
+    case OpCode::NumCmp:
+        if (!c.data) return;
+        if (b.schema().type(var) == var_type::integer) {
+            auto x = static_cast<const int*>(c.data);
+            for (auto row : sel)
+                if (valid(row)) set(row, simd::cmp(ast::CompOp(in.sub), x[row], in.arg.num), false);
+        } else {
+            auto x = static_cast<const double*>(c.data);
+            for (auto row : sel)
+                if (valid(row)) set(row, simd::cmp(ast::CompOp(in.sub), x[row], in.arg.num), false);
+        }
+        return;
+    case OpCode::NumRange:
+        if (!c.data) return;
+        if (b.schema().type(var) == var_type::integer) {
+            auto x = static_cast<const int*>(c.data);
+            for (auto row : sel) if (valid(row)) set(row, in_range(p, in, x[row]), false);
+        } else {
+            auto x = static_cast<const double*>(c.data);
+            for (auto row : sel) if (valid(row)) set(row, in_range(p, in, x[row]), false);
+        }
+        return;
+    case OpCode::StrEq:
+        if (!c.data || !c.dict) break;
+        {
+            auto x = static_cast<const std::uint32_t*>(c.data);
+            auto code = lit_code(p, in, c);
+            for (auto row : sel) if (valid(row)) set(row, x[row] == code, false);
+        }
+        return;
+    case OpCode::StrIn:
+        if (!c.data || !c.dict || p.dict != c.dict) break;
+        {
+            auto x = static_cast<const std::uint32_t*>(c.data);
+            auto& s = p.code_sets[in.arg.slice.offset];
+            for (auto row : sel) if (valid(row)) set(row, p.int_pool.has(s, int(x[row])), false);
+        }
+        return;
+#ifdef PREDICATE_EXTENSION_AST_TYPE
+    case OpCode::Ext: {
+        using X = std::decay_t<decltype(p.ext[0])>;
+        auto& x = p.ext[in.arg.slice.offset];
+        if constexpr (has_ext_var<X>::value) {
+            auto& ec = b.column(extension_var(x));
+            if (cache && ec.dict) {
+                auto id = p.ext_ids[in.arg.slice.offset];
+                auto codes = static_cast<const std::uint32_t*>(ec.data);
+                for (auto row : sel) {
+                    BatchRow r(b, row);
+                    if (ec.valid && !test_bit(ec.valid, row)) set(row, eval_extension(x, r), false);
+                    else set(row, cache->get(id, ResultCache::key(*ec.dict, codes[row]),
+                        [&] { return bool(eval_extension(x, r)); }), false);
+                }
+                return;
+            }
+        }
+        if constexpr (has_ext_batch<X>::value) {
+            eval_extension(x, b, sel, truth);
+            for (auto row : sel) set(row, false, false);
+            return;
+        }
+        break;
+    }
+#endif
+    default:
+        break;
+    }
+    for (auto row : sel) {
+        bool null;
+        keys.reset();
+        bool x = test(p, in, BatchRow(b, row), null, &keys, cache);
+        set(row, x, null);
+    }
+}
+
+} // detail
+
+// Evaluate program over all rows of the batch, returns bitmap of rows where
+// the expression is true. Every instruction is reached by the set of rows
+// still undecided before it: survivors of a conjunction, the complement of
+// a disjunction. The set is split into ones jumping on true
+// (reach & known & pred) and on false (reach & ~true), so later
+// predicates only touch rows they can decide.
+template<typename P>
+inline Bitmap eval(const P& p, const Batch& b, BatchContext& ctx) {
+    auto n = b.rows();
+    auto w = simd::words(n);
+    Bitmap result(w, 0);
+    if (p.entry >= Program::reject) {
+        if (p.entry == Program::accept) simd::fill(result.data(), n, true);
+        return result;
+    }
+
+    auto size = p.code.size();
+    ctx.reach.assign(size * w, 0);
+    ctx.truth.resize(w);
+    ctx.known.resize(w);
+    simd::fill(&ctx.reach[p.entry * w], n, true);
+
+    auto target = [&] (std::uint32_t pc) -> std::uint64_t* {
+        if (pc == Program::accept) return result.data();
+        if (pc == Program::reject) return nullptr;
+        return &ctx.reach[pc * w];
+    };
+
+    for (std::size_t pc = 0; pc < size; ++pc) {
+        const std::uint64_t* r = &ctx.reach[pc * w];
+        std::size_t lo = 0, hi = w;
+        while (lo < hi && !r[lo]) ++lo;
+        while (hi > lo && !r[hi - 1]) --hi;
+        if (lo == hi) continue;
+
+        std::size_t count = 0;
+        for (std::size_t i = lo; i < hi; ++i) count += simd::popcount(r[i]);
+
+        const Instr& in = p.code[pc];
+        auto truth = ctx.truth.data();
+        auto known = ctx.known.data();
+        if (count < ctx.sparse_fraction * (hi - lo) * 64 || !detail::dense(p, in, b, lo, hi, truth, known, ctx.elems)) {
+            ctx.sel.clear();
+            for (std::size_t i = lo; i < hi; ++i) {
+                truth[i] = known[i] = 0;
+                for (auto m = r[i]; m; m &= m - 1)
+                    ctx.sel.push_back(std::uint32_t(i * 64 + simd::ctz(m)));
+            }
+            detail::sparse(p, in, b, ctx.sel, truth, known, ctx.keys, ctx.ext_cache);
+        }
+
+        auto t = target(in.on_true);
+        auto f = target(in.on_false);
+        for (std::size_t i = lo; i < hi; ++i) {
+            auto yes = r[i] & known[i] & (in.neg ? ~truth[i] : truth[i]);
+            if (t) t[i] |= yes;
+            if (f) f[i] |= r[i] & ~yes;
+        }
+    }
+    return result;
+}
+
+template<typename P>
+inline Bitmap eval(const P& p, const Batch& b) {
+    BatchContext ctx;
+    return eval(p, b, ctx);
+}
+
+} // lexen
@@ -18,7 +18,24 @@ enum class var_type {
     strings
 };
 
+class Schema;
+class CompactAst;
+
+// variables of the default schema, not synchronized
 extern ast::VarIdx add_var(const std::string& name, var_type type);
 extern bool parse_str(const std::string& str, ast::Expression& v);
 
+// parse with variables of the schema, reentrant
+extern bool parse_str(const std::string& str, ast::Expression& v, const Schema& schema);
+
+// same, on failure pos is the end of the longest prefix parsing as an
+// expression, not necessarily where the error is
+extern bool parse_str(const std::string& str, ast::Expression& v, const Schema& schema, std::size_t& pos);
+
+// parse into the arena, sets its root; trees parsed before are kept
+extern bool parse_compact(const std::string& str, CompactAst& t, const Schema& schema);
+
+// types and slots of the variables registered by add_var
+extern const Schema& default_schema();
+
 } // lexen
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "ast.hpp"
+#include "schema.hpp"
 
 #include <boost/spirit/home/x3.hpp>
 
@@ -23,29 +24,32 @@ rule<class is_null, ast::UnaryExpr> is_null = "is_null";
 rule<class is_empty, ast::UnaryExpr> is_empty = "is_empty";
 rule<class cmp, ast::CompOp> cmp = "cmp";
 rule<class eqne, ast::CompOp> eqne = "eqne";
-rule<class num_comp, ast::NumComp> num_comp = "num_comp";
-rule<class str_comp, ast::StrComp> str_comp = "str_comp";
 rule<class set_op, ast::SetOp> set_op = "set_op";
-rule<class set_expr, ast::SetExpr> set_expr = "set_expr";
 rule<class list_op, ast::ListOp> list_op = "list_op";
-rule<class list_expr, ast::ListExpr> list_expr = "list_expr";
-rule<class predicate, ast::Expression> predicate = "predicate";
-rule<class negation, ast::Negation> negation = "negation";
-rule<class factor, ast::Expression> factor = "factor";
-rule<class conjunct, ast::Conjunction> conjunct = "conjunct";
-rule<class and_expr, ast::Expression> and_expr = "and_expr";
-rule<class disjunct, ast::Disjunction> disjunct = "disjunct";
-rule<class or_expr, ast::Expression> or_expr = "or_expr";
-rule<class expression, ast::Expression> expression = "expression";
-rule<class be, ast::Expression> be = "be";
-
-ast::Vars bool_var;
-ast::Vars int_var;
-ast::Vars num_var;
-ast::Vars str_var;
-ast::Vars int_list_var;
-ast::Vars str_list_var;
-ast::Vars list_var;
-ast::Vars var;
+
+// key of the schema in the parser context, see x3::with
+struct schema_tag;
+
+// variable of the schema in the context, looked up in one of its tables
+template<ast::Vars Schema::Symbols::*Table>
+struct var_parser : boost::spirit::x3::parser<var_parser<Table>> {
+    using attribute_type = ast::VarIdx;
+    static bool const has_attribute = true;
+
+    template<typename Iterator, typename Context, typename RContext, typename Attribute>
+    bool parse(Iterator& first, const Iterator& last, const Context& ctx, RContext& rctx, Attribute& attr) const {
+        const Schema& schema = boost::spirit::x3::get<schema_tag>(ctx);
+        return (schema.symbols().*Table).parse(first, last, ctx, rctx, attr);
+    }
+};
+
+var_parser<&Schema::Symbols::bool_var> bool_var;
+var_parser<&Schema::Symbols::int_var> int_var;
+var_parser<&Schema::Symbols::num_var> num_var;
+var_parser<&Schema::Symbols::str_var> str_var;
+var_parser<&Schema::Symbols::int_list_var> int_list_var;
+var_parser<&Schema::Symbols::str_list_var> str_list_var;
+var_parser<&Schema::Symbols::list_var> list_var;
+var_parser<&Schema::Symbols::var> var;
 
 } } // lexen::parser
@@ -9,14 +9,14 @@
 
 #include <boost/spirit/home/x3.hpp>
 #include <boost/fusion/include/adapt_struct.hpp>
+#include <cctype>
 
 #include "ast.hpp"
 #include "be.hpp"
+#include "compact_ast.hpp"
+#include "schema.hpp"
 
 BOOST_FUSION_ADAPT_STRUCT(lexen::ast::UnaryExpr, var, op)
-BOOST_FUSION_ADAPT_STRUCT(lexen::ast::Conjunction, items)
-BOOST_FUSION_ADAPT_STRUCT(lexen::ast::Disjunction, items)
-BOOST_FUSION_ADAPT_STRUCT(lexen::ast::Negation, expr)
 
 namespace lexen { namespace parser {
 
@@ -45,11 +45,6 @@ auto is_null_def = var >> (
 
 auto is_empty_def = list_var >> "is empty" >> attr(ast::UnaryOp::IsEmpty);
 
-#define VAR ( [] (auto& ctx) { _val(ctx).var = std::move(_attr(ctx)); } )
-#define VAL ( [] (auto& ctx) { _val(ctx).val = std::move(_attr(ctx)); } )
-#define CMP ( [] (auto& ctx) { _val(ctx).cmp = std::move(_attr(ctx)); } )
-#define PMC ( [] (auto& ctx) { _val(ctx).cmp = std::move(mirror(_attr(ctx))); } )
-
 inline ast::CompOp mirror(ast::CompOp x) {
     switch (x) {
         case ast::CompOp::Gt: return ast::CompOp::Lt;
@@ -77,134 +72,420 @@ auto cmp_def =
 
 static real_parser<double, strict_real_policies<double>> strict_double;
 
-auto num_comp_def =
-    num_var [VAR] >> cmp [CMP] >> (strict_double | int_) [VAL]
-  | (strict_double | int_) [VAL] >> cmp [PMC] >> num_var [VAR]
-;
+auto number = strict_double | int_;
 
-auto str_val_def =
+template<typename Number>
+inline ast::NumVal num_val(const Number& x) {
+    return boost::apply_visitor([] (auto v) { return ast::NumVal(v); }, x);
+}
+
+auto quoted =
     lexeme[ '"' >> *(char_ -  '"') >>  '"']
   | lexeme['\'' >> *(char_ - '\'') >> '\'']
 ;
 
-auto str_comp_def =
-    str_var [VAR] >> eqne [CMP] >> str_val [VAL]
-  | str_val [VAL] >> eqne [PMC] >> str_var [VAR]
-;
+auto str_val_def = quoted;
 
 auto int_list_def = "(" >> int_ % "," >> ")";
 auto str_list_def = "(" >> str_val % "," >> ")";
 
-#define A(N) boost::fusion::at_c<(N)>(_attr(ctx))
-#define VALxSET(T) ([] (auto& ctx) { _val(ctx) = ast::ValInSet<T>(A(0), A(1), A(2)); })
-#define VARxSET(T) ([] (auto& ctx) { _val(ctx) = ast::VarInSet<T>(A(0), A(1), A(2)); })
-#define SETxSET(T) ([] (auto& ctx) { _val(ctx) = ast::VarVsSet<T>(A(0), A(1), A(2)); })
-
 auto set_op_def =
      "in"     >> attr(ast::SetOp::In   )
   |  "not in" >> attr(ast::SetOp::NotIn)
 ;
 
-auto set_expr_def =
-    (int_    >> set_op >> int_list_var) [VALxSET(int)]
-  | (int_var >> set_op >> int_list    ) [VARxSET(int)]
-  | (str_val >> set_op >> str_list_var) [VALxSET(std::string)]
-  | (str_var >> set_op >> str_list    ) [VARxSET(std::string)]
-;
-
 auto list_op_def =
      "one of" >> attr(ast::ListOp::OneOf )
   |  "all of" >> attr(ast::ListOp::AllOf )
   | "none of" >> attr(ast::ListOp::NoneOf)
 ;
 
-auto list_expr_def =
-    (int_list_var >> list_op >> int_list) [SETxSET(int)]
-  | (str_list_var >> list_op >> str_list) [SETxSET(std::string)]
-;
+BOOST_SPIRIT_DEFINE(
+    bool_const, str_val, is_null, is_empty, eqne, cmp, int_list, str_list, set_op, list_op
+)
 
-auto predicate_def =
-    is_null
-  | is_empty
-  | num_comp
-  | str_comp
-  | set_expr
-  | list_expr
-  | bool_const
-  | bool_var
+/*
+ * Trees built by the grammar below. A builder gives the types of nodes
+ * and literals, the rules parsing literals, and makes a node of what each
+ * predicate parses; items of and/or are collected into its items, grouped
+ * into one node, or the only item if there is one. Alternatives that fail
+ * roll back what they added, see scoped.
+ */
+enum class Group { And, Or };
+
+// ast::Expression trees
+struct TreeBuilder {
+    using node = ast::Expression;
+    using items = std::vector<ast::Expression>;
+    using str = std::string;
+    using ints = std::vector<int>;
+    using strs = std::vector<std::string>;
+    struct mark_type {};
+
+    static auto str_val() { return parser::str_val; }
+    static auto int_list() { return parser::int_list; }
+    static auto str_list() { return parser::str_list; }
+
+    template<typename Context>
+    static mark_type mark(const Context&) { return {}; }
+    template<typename Context>
+    static void rollback(const Context&, mark_type) {}
+
+    template<typename Context>
+    static node unary(const Context&, const ast::UnaryExpr& x) { return node(x); }
+    template<typename Context>
+    static node num_comp(const Context&, ast::VarIdx var, ast::CompOp cmp, ast::NumVal val) {
+        return node(ast::NumComp{var, std::move(val), cmp});
+    }
+    template<typename Context>
+    static node str_comp(const Context&, ast::VarIdx var, ast::CompOp cmp, str& val) {
+        return node(ast::StrComp{var, std::move(val), cmp});
+    }
+    template<typename Context>
+    static node int_in_list(const Context&, int val, ast::SetOp op, ast::VarIdx list) {
+        return node(ast::SetExpr(ast::ValInSet<int>(val, op, list)));
+    }
+    template<typename Context>
+    static node str_in_list(const Context&, const str& val, ast::SetOp op, ast::VarIdx list) {
+        return node(ast::SetExpr(ast::ValInSet<std::string>(val, op, list)));
+    }
+    template<typename Context>
+    static node var_in_ints(const Context&, ast::VarIdx var, ast::SetOp op, const ints& set) {
+        return node(ast::SetExpr(ast::VarInSet<int>(var, op, set)));
+    }
+    template<typename Context>
+    static node var_in_strs(const Context&, ast::VarIdx var, ast::SetOp op, const strs& set) {
+        return node(ast::SetExpr(ast::VarInSet<std::string>(var, op, set)));
+    }
+    template<typename Context>
+    static node var_vs_ints(const Context&, ast::VarIdx var, ast::ListOp op, const ints& set) {
+        return node(ast::ListExpr(ast::VarVsSet<int>(var, op, set)));
+    }
+    template<typename Context>
+    static node var_vs_strs(const Context&, ast::VarIdx var, ast::ListOp op, const strs& set) {
+        return node(ast::ListExpr(ast::VarVsSet<std::string>(var, op, set)));
+    }
+    template<typename Context>
+    static node bool_const(const Context&, ast::BoolVal x) { return node(x); }
+    template<typename Context>
+    static node bool_var(const Context&, ast::VarIdx var) { return node(var); }
 #ifdef PREDICATE_EXTENSION_RULE
-  | PREDICATE_EXTENSION_RULE
+    template<typename Context, typename Ext>
+    static node ext(const Context&, Ext& x) { return node(std::move(x)); }
 #endif
-;
+    template<typename Context>
+    static node negation(const Context&, node& x) { return node(ast::Negation{std::move(x)}); }
+
+    template<typename Context>
+    static void begin(const Context&, items&) {}
+    template<typename Context>
+    static void push(const Context&, items& list, node& x) { list.push_back(std::move(x)); }
+    template<typename Context>
+    static node group(const Context&, items& list, Group g) {
+        if (list.size() == 1) return std::move(list[0]);
+        if (g == Group::And) return node(ast::Conjunction{std::move(list)});
+        return node(ast::Disjunction{std::move(list)});
+    }
+};
 
-auto expression_def = "(" >> or_expr >> ")" | predicate;
+namespace compact {
 
-auto negation_def = "not" >> expression;
+struct arena_tag;
 
-auto factor_def = negation | expression;
+template<typename Context>
+inline CompactAst& arena(const Context& ctx) { return x3::get<arena_tag>(ctx); }
 
-auto conjunct_def = factor % ( lit("&&") | "and" );
+// range of a literal list in the arena
+struct Range {
+    std::uint32_t first;
+    std::uint32_t size;
+};
 
-auto reduce = [] (auto& ctx) {
-    if (_attr(ctx).items.size() == 1) {
-        _val(ctx) = std::move(_attr(ctx).items[0]);
-    } else {
-        _val(ctx) = std::move(_attr(ctx));
+rule<class c_str_val, std::uint32_t> str_val = "str_val";
+rule<class c_int_list, Range> int_list = "int_list";
+rule<class c_str_list, Range> str_list = "str_list";
+
+auto str_val_def = x3::raw[quoted] [ ([] (auto& ctx) {
+    auto& r = _attr(ctx);
+    _val(ctx) = arena(ctx).add_str(std::string_view(&*r.begin() + 1, std::size_t(r.end() - r.begin()) - 2));
+}) ];
+
+auto begin_ints = [] (auto& ctx) { _val(ctx) = Range{std::uint32_t(arena(ctx).ints.size()), 0}; };
+auto push_int = [] (auto& ctx) { arena(ctx).ints.push_back(_attr(ctx)); ++_val(ctx).size; };
+auto begin_strs = [] (auto& ctx) { _val(ctx) = Range{std::uint32_t(arena(ctx).strs.size()), 0}; };
+auto count_str = [] (auto& ctx) { ++_val(ctx).size; };
+
+auto int_list_def = lit("(") [begin_ints] >> int_ [push_int] % "," >> ")";
+auto str_list_def = lit("(") [begin_strs] >> str_val [count_str] % "," >> ")";
+
+BOOST_SPIRIT_DEFINE(str_val, int_list, str_list)
+
+} // compact
+
+// CompactAst nodes, appended to the arena in the parser context; and/or
+// items go through its stack
+struct CompactBuilder {
+    using node = NodeId;
+    using items = NodeId;       // size of the stack at the first item
+    using str = std::uint32_t;
+    using ints = compact::Range;
+    using strs = compact::Range;
+    using mark_type = CompactAst::Mark;
+
+    static auto str_val() { return compact::str_val; }
+    static auto int_list() { return compact::int_list; }
+    static auto str_list() { return compact::str_list; }
+
+    template<typename Context>
+    static mark_type mark(const Context& ctx) { return compact::arena(ctx).mark(); }
+    template<typename Context>
+    static void rollback(const Context& ctx, const mark_type& m) { compact::arena(ctx).rollback(m); }
+
+    template<typename Context>
+    static node unary(const Context& ctx, const ast::UnaryExpr& x) {
+        return add(ctx, NodeKind::Unary, x.op, x.var);
+    }
+    template<typename Context>
+    static node num_comp(const Context& ctx, ast::VarIdx var, ast::CompOp cmp, const ast::NumVal& val) {
+        return add(ctx, NodeKind::NumComp, cmp, var, compact::arena(ctx).add_num(val));
+    }
+    template<typename Context>
+    static node str_comp(const Context& ctx, ast::VarIdx var, ast::CompOp cmp, str val) {
+        return add(ctx, NodeKind::StrComp, cmp, var, val);
+    }
+    template<typename Context>
+    static node int_in_list(const Context& ctx, int val, ast::SetOp op, ast::VarIdx list) {
+        return add(ctx, NodeKind::IntInList, op, list, std::uint32_t(val));
+    }
+    template<typename Context>
+    static node str_in_list(const Context& ctx, str val, ast::SetOp op, ast::VarIdx list) {
+        return add(ctx, NodeKind::StrInList, op, list, val);
+    }
+    template<typename Context>
+    static node var_in_ints(const Context& ctx, ast::VarIdx var, ast::SetOp op, const ints& set) {
+        return add(ctx, NodeKind::VarInInts, op, var, set.first, set.size);
+    }
+    template<typename Context>
+    static node var_in_strs(const Context& ctx, ast::VarIdx var, ast::SetOp op, const strs& set) {
+        return add(ctx, NodeKind::VarInStrs, op, var, set.first, set.size);
+    }
+    template<typename Context>
+    static node var_vs_ints(const Context& ctx, ast::VarIdx var, ast::ListOp op, const ints& set) {
+        return add(ctx, NodeKind::VarVsInts, op, var, set.first, set.size);
+    }
+    template<typename Context>
+    static node var_vs_strs(const Context& ctx, ast::VarIdx var, ast::ListOp op, const strs& set) {
+        return add(ctx, NodeKind::VarVsStrs, op, var, set.first, set.size);
+    }
+    template<typename Context>
+    static node bool_const(const Context& ctx, ast::BoolVal x) {
+        return add(ctx, NodeKind::Bool, x.value, ast::VarIdx(0));
+    }
+    template<typename Context>
+    static node bool_var(const Context& ctx, ast::VarIdx var) { return add(ctx, NodeKind::Var, 0, var); }
+#ifdef PREDICATE_EXTENSION_RULE
+    template<typename Context, typename Ext>
+    static node ext(const Context& ctx, Ext& x) {
+        auto& t = compact::arena(ctx);
+        t.ext.push_back(std::move(x));
+        return t.add(NodeKind::Ext, 0, 0, std::uint32_t(t.ext.size() - 1));
+    }
+#endif
+    template<typename Context>
+    static node negation(const Context& ctx, node x) { return add(ctx, NodeKind::Not, 0, ast::VarIdx(0), x); }
+
+    template<typename Context>
+    static void begin(const Context& ctx, items& list) { list = NodeId(compact::arena(ctx).stack.size()); }
+    template<typename Context>
+    static void push(const Context& ctx, items&, node x) { compact::arena(ctx).stack.push_back(x); }
+    template<typename Context>
+    static node group(const Context& ctx, items list, Group g) {
+        return compact::arena(ctx).group(g == Group::And ? NodeKind::And : NodeKind::Or, list);
+    }
+
+private:
+    template<typename Context, typename Op>
+    static node add(const Context& ctx, NodeKind kind, Op op, ast::VarIdx var, std::uint32_t a = 0, std::uint32_t b = 0) {
+        return compact::arena(ctx).add(kind, std::uint8_t(op), var.index, a, b);
     }
 };
 
-auto and_expr_def = conjunct [reduce];
+// rolls back what the subject added if it fails
+template<typename Subject, typename Builder>
+struct scoped_directive : x3::unary_parser<Subject, scoped_directive<Subject, Builder>> {
+    using base_type = x3::unary_parser<Subject, scoped_directive<Subject, Builder>>;
+    static bool const is_pass_through_unary = true;
 
-auto disjunct_def = and_expr % ( lit("||") | "or" );
+    constexpr scoped_directive(const Subject& subject) : base_type(subject) {}
 
-auto or_expr_def = disjunct [reduce];
+    template<typename Iterator, typename Context, typename RContext, typename Attribute>
+    bool parse(Iterator& first, const Iterator& last, const Context& ctx, RContext& rctx, Attribute& attr) const {
+        auto m = Builder::mark(ctx);
+        if (this->subject.parse(first, last, ctx, rctx, attr)) return true;
+        Builder::rollback(ctx, m);
+        return false;
+    }
+};
 
-auto be_def = or_expr >> eoi;
+template<typename Builder>
+struct scoped_gen {
+    template<typename Subject>
+    constexpr scoped_directive<typename x3::extension::as_parser<Subject>::value_type, Builder>
+    operator[](const Subject& subject) const { return { x3::as_parser(subject) }; }
+};
 
-BOOST_SPIRIT_DEFINE(
-    bool_const, str_val, is_null, is_empty, eqne, cmp, num_comp, str_comp,
-    int_list, str_list, set_op, set_expr, list_op, list_expr, predicate,
-    negation, factor, conjunct, disjunct, and_expr, or_expr, expression, be
-)
+template<typename Builder>
+constexpr scoped_gen<Builder> scoped{};
+
+/*
+ * Structure of expressions, the one grammar of every builder: rules are
+ * templates of the builder, their attribute is its node or its items.
+ */
+template<typename B> struct predicate_id;
+template<typename B> struct expression_id;
+template<typename B> struct factor_id;
+template<typename B> struct and_items_id;
+template<typename B> struct and_expr_id;
+template<typename B> struct or_items_id;
+template<typename B> struct or_expr_id;
+template<typename B> struct be_id;
+
+template<typename B> const rule<predicate_id<B>, typename B::node> predicate = "predicate";
+template<typename B> const rule<expression_id<B>, typename B::node> expression = "expression";
+template<typename B> const rule<factor_id<B>, typename B::node> factor = "factor";
+template<typename B> const rule<and_items_id<B>, typename B::items> and_items = "and_items";
+template<typename B> const rule<and_expr_id<B>, typename B::node> and_expr = "and_expr";
+template<typename B> const rule<or_items_id<B>, typename B::items> or_items = "or_items";
+template<typename B> const rule<or_expr_id<B>, typename B::node> or_expr = "or_expr";
+template<typename B> const rule<be_id<B>, typename B::node> be = "be";
+
+#define A(N) boost::fusion::at_c<(N)>(_attr(ctx))
+#define NODE(F, ...) ( [] (auto& ctx) { _val(ctx) = B::F(ctx, __VA_ARGS__); } )
+
+template<typename B>
+const auto predicate_def =
+    scoped<B>[ is_null [NODE(unary, _attr(ctx))] ]
+  | scoped<B>[ is_empty [NODE(unary, _attr(ctx))] ]
+  | scoped<B>[ (num_var >> cmp >> number) [NODE(num_comp, A(0), A(1), num_val(A(2)))] ]
+  | scoped<B>[ (number >> cmp >> num_var) [NODE(num_comp, A(2), mirror(A(1)), num_val(A(0)))] ]
+  | scoped<B>[ (str_var >> eqne >> B::str_val()) [NODE(str_comp, A(0), A(1), A(2))] ]
+  | scoped<B>[ (B::str_val() >> eqne >> str_var) [NODE(str_comp, A(2), mirror(A(1)), A(0))] ]
+  | scoped<B>[ (int_ >> set_op >> int_list_var) [NODE(int_in_list, A(0), A(1), A(2))] ]
+  | scoped<B>[ (int_var >> set_op >> B::int_list()) [NODE(var_in_ints, A(0), A(1), A(2))] ]
+  | scoped<B>[ (B::str_val() >> set_op >> str_list_var) [NODE(str_in_list, A(0), A(1), A(2))] ]
+  | scoped<B>[ (str_var >> set_op >> B::str_list()) [NODE(var_in_strs, A(0), A(1), A(2))] ]
+  | scoped<B>[ (int_list_var >> list_op >> B::int_list()) [NODE(var_vs_ints, A(0), A(1), A(2))] ]
+  | scoped<B>[ (str_list_var >> list_op >> B::str_list()) [NODE(var_vs_strs, A(0), A(1), A(2))] ]
+  | bool_const [NODE(bool_const, _attr(ctx))]
+  | bool_var [NODE(bool_var, _attr(ctx))]
+#ifdef PREDICATE_EXTENSION_RULE
+  | scoped<B>[ PREDICATE_EXTENSION_RULE [NODE(ext, _attr(ctx))] ]
+#endif
+;
+
+auto pass = [] (auto& ctx) { _val(ctx) = std::move(_attr(ctx)); };
+
+template<typename B>
+const auto expression_def = scoped<B>["(" >> or_expr<B> [pass] >> ")"] | predicate<B> [pass];
+
+template<typename B>
+const auto factor_def =
+    scoped<B>[ "not" >> expression<B> [NODE(negation, _attr(ctx))] ]
+  | expression<B> [pass]
+;
+
+// items of and/or, added by actions, so they are omitted from the attribute
+template<typename B, typename Item, typename Sep>
+inline auto items(const Item& item, const Sep& sep) {
+    return x3::eps [ ([] (auto& ctx) { B::begin(ctx, _val(ctx)); }) ]
+        >> x3::omit[ item [ ([] (auto& ctx) { B::push(ctx, _val(ctx), _attr(ctx)); }) ] ] % sep;
+}
+
+template<typename B>
+const auto and_items_def = items<B>(factor<B>, lit("&&") | "and");
+
+template<typename B>
+const auto and_expr_def = and_items<B> [NODE(group, _attr(ctx), Group::And)];
+
+template<typename B>
+const auto or_items_def = items<B>(and_expr<B>, lit("||") | "or");
+
+template<typename B>
+const auto or_expr_def = or_items<B> [NODE(group, _attr(ctx), Group::Or)];
+
+template<typename B>
+const auto be_def = or_expr<B> [pass] >> eoi;
+
+#undef NODE
+#undef A
+
+// BOOST_SPIRIT_DEFINE for rules of the builder
+#define LEXEN_DEFINE_RULE(NAME, ATTR)                                           \
+    template<typename B, typename Iterator, typename Context>                   \
+    inline bool parse_rule(rule<NAME##_id<B>, typename B::ATTR>,                \
+        Iterator& first, const Iterator& last, const Context& ctx,              \
+        typename B::ATTR& attr)                                                 \
+    {                                                                           \
+        static auto const def = (NAME<B> = NAME##_def<B>);                      \
+        return def.parse(first, last, ctx, x3::unused, attr);                   \
+    }
+
+LEXEN_DEFINE_RULE(predicate, node)
+LEXEN_DEFINE_RULE(expression, node)
+LEXEN_DEFINE_RULE(factor, node)
+LEXEN_DEFINE_RULE(and_items, items)
+LEXEN_DEFINE_RULE(and_expr, node)
+LEXEN_DEFINE_RULE(or_items, items)
+LEXEN_DEFINE_RULE(or_expr, node)
+LEXEN_DEFINE_RULE(be, node)
+
+#undef LEXEN_DEFINE_RULE
 
 } // lexen::parser
 
 namespace {
-ast::VarIdx idx(1);
+Schema schema;
 }
 
 ast::VarIdx add_var(const std::string& name, var_type type) {
-    switch (type) {
-    case var_type::boolean:
-        parser::bool_var.add(name, idx);
-        break;
-    case var_type::integer:
-        parser::int_var.add(name, idx);
-        parser::num_var.add(name, idx);
-        break;
-    case var_type::realnum:
-        parser::num_var.add(name, idx);
-        break;
-    case var_type::string:
-        parser::str_var.add(name, idx);
-        break;
-    case var_type::integers:
-        parser::int_list_var.add(name, idx);
-        parser::list_var.add(name, idx);
-        break;
-    case var_type::strings:
-        parser::str_list_var.add(name, idx);
-        parser::list_var.add(name, idx);
-        break;
-    }
-    auto ret = idx;
-    parser::var.add(name, idx);
-    idx.inc();
-    return ret;
+    return schema.add(name, type);
+}
+
+const Schema& default_schema() {
+    return schema;
+}
+
+bool parse_str(const std::string& str, ast::Expression& v, const Schema& schema) {
+    namespace x3 = boost::spirit::x3;
+    auto p = x3::with<parser::schema_tag>(schema)[parser::be<parser::TreeBuilder>];
+    return x3::phrase_parse(str.begin(), str.end(), p, x3::space, v);
+}
+
+bool parse_str(const std::string& str, ast::Expression& v, const Schema& schema, std::size_t& pos) {
+    namespace x3 = boost::spirit::x3;
+    auto it = str.begin();
+    auto p = x3::with<parser::schema_tag>(schema)[parser::or_expr<parser::TreeBuilder>];
+    bool ok = x3::phrase_parse(it, str.end(), p, x3::space, v);
+    while (it != str.end() && std::isspace(static_cast<unsigned char>(*it))) ++it;
+    pos = std::size_t(it - str.begin());
+    return ok && it == str.end();
+}
+
+bool parse_compact(const std::string& str, CompactAst& t, const Schema& schema) {
+    namespace x3 = boost::spirit::x3;
+    auto m = t.mark();
+    NodeId root;
+    auto p = x3::with<parser::schema_tag>(schema)[x3::with<parser::compact::arena_tag>(t)[parser::be<parser::CompactBuilder>]];
+    if (x3::phrase_parse(str.begin(), str.end(), p, x3::space, root)) {
+        t.root = root;
+        return true;
+    }
+    t.rollback(m);
+    return false;
 }
 
 bool parse_str(const std::string& str, ast::Expression& v) {
-    return boost::spirit::x3::phrase_parse(str.begin(), str.end(), lexen::parser::be, boost::spirit::x3::space, v);
+    return parse_str(str, v, schema);
 }
 
 } // lexen
@@ -0,0 +1,300 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions parser - arena allocated compact AST
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ast.hpp"
+#include "list_view.hpp"
+
+namespace lexen {
+
+namespace x3 = boost::spirit::x3;
+
+// index of a node in CompactAst
+using NodeId = std::uint32_t;
+
+enum class NodeKind : std::uint8_t {
+    Bool,       // op = value
+    Var,        // boolean variable
+    NumComp,    // op = CompOp, a = value in nums
+    StrComp,    // op = CompOp, a = string in strs
+    Unary,      // op = UnaryOp
+    IntInList,  // integer in list variable, op = SetOp, a = value
+    StrInList,  // string in list variable, op = SetOp, a = string in strs
+    VarInInts,  // integer variable in set, op = SetOp, a, b = range of ints
+    VarInStrs,  // string variable in set, op = SetOp, a, b = range of strs
+    VarVsInts,  // integer list variable vs set, op = ListOp, a, b = range of ints
+    VarVsStrs,  // string list variable vs set, op = ListOp, a, b = range of strs
+    Ext,        // predicate extension, a = index in ext
+    And,        // a, b = range of items
+    Or,         // a, b = range of items
+    Not         // a = operand
+};
+
+struct Node {
+    NodeKind kind;
+    std::uint8_t op;
+    std::int32_t var;
+    std::uint32_t a;
+    std::uint32_t b;
+};
+
+/*
+ * Expression trees in a few flat arrays: fixed size nodes addressed by
+ * 32-bit ids, items of and/or, and pools of literals. Nodes are appended
+ * children first. clear() drops all trees at once and keeps the storage,
+ * so an instance reused for parsing does not allocate once warmed up.
+ */
+class CompactAst {
+public:
+    // string in chars
+    struct Str {
+        std::uint32_t offset;
+        std::uint32_t size;
+    };
+
+    // sizes of the arrays, see rollback()
+    struct Mark {
+        std::size_t nodes, items, nums, ints, chars, strs, stack;
+#ifdef PREDICATE_EXTENSION_AST_TYPE
+        std::size_t ext;
+#endif
+    };
+
+    std::vector<Node> nodes;
+    std::vector<NodeId> items;
+    std::vector<ast::NumVal> nums;
+    std::vector<int> ints;
+    std::string chars;
+    std::vector<Str> strs;
+#ifdef PREDICATE_EXTENSION_AST_TYPE
+    std::vector<PREDICATE_EXTENSION_AST_TYPE> ext;
+#endif
+    std::vector<NodeId> stack;  // items of and/or being built
+    NodeId root = 0;
+
+    void clear() { rollback(Mark{}); }
+
+    Mark mark() const {
+        return Mark{nodes.size(), items.size(), nums.size(), ints.size(), chars.size(), strs.size(), stack.size()
+#ifdef PREDICATE_EXTENSION_AST_TYPE
+            , ext.size()
+#endif
+        };
+    }
+
+    // drops everything added since the mark
+    void rollback(const Mark& m) {
+        nodes.resize(m.nodes);
+        items.resize(m.items);
+        nums.resize(m.nums);
+        ints.resize(m.ints);
+        chars.resize(m.chars);
+        strs.resize(m.strs);
+        stack.resize(m.stack);
+#ifdef PREDICATE_EXTENSION_AST_TYPE
+        ext.resize(m.ext);
+#endif
+    }
+
+    const Node& node(NodeId id) const { return nodes[id]; }
+
+    // items of and/or
+    ListView<NodeId> children(NodeId id) const {
+        auto& x = nodes[id];
+        return ListView<NodeId>(items.data() + x.a, x.b);
+    }
+
+    std::string_view str(std::uint32_t i) const {
+        return std::string_view(chars.data() + strs[i].offset, strs[i].size);
+    }
+
+    NodeId add(NodeKind kind, std::uint8_t op, std::int32_t var = 0, std::uint32_t a = 0, std::uint32_t b = 0) {
+        nodes.push_back(Node{kind, op, var, a, b});
+        return NodeId(nodes.size() - 1);
+    }
+
+    // index of the string in strs
+    std::uint32_t add_str(std::string_view s) {
+        strs.push_back(Str{std::uint32_t(chars.size()), std::uint32_t(s.size())});
+        chars.append(s.data(), s.size());
+        return std::uint32_t(strs.size() - 1);
+    }
+
+    std::uint32_t add_num(const ast::NumVal& x) {
+        nums.push_back(x);
+        return std::uint32_t(nums.size() - 1);
+    }
+
+    // And/Or of the nodes on the stack past mark, or the only one of them
+    NodeId group(NodeKind kind, std::size_t mark) {
+        NodeId id;
+        if (stack.size() - mark == 1) {
+            id = stack.back();
+        } else {
+            auto first = std::uint32_t(items.size());
+            items.insert(items.end(), stack.begin() + mark, stack.end());
+            id = add(kind, 0, 0, first, std::uint32_t(items.size() - first));
+        }
+        stack.resize(mark);
+        return id;
+    }
+
+    // copy of an expression tree
+    NodeId add(const ast::Expression& e);
+
+    // expression tree of a node
+    ast::Expression expression(NodeId id) const;
+
+    ast::Expression expression() const { return expression(root); }
+};
+
+namespace detail {
+
+class compact_builder : public boost::static_visitor<NodeId> {
+public:
+    explicit compact_builder(CompactAst& t) : t_(t) {}
+
+    NodeId operator()(const ast::BoolVal& x) const { return t_.add(NodeKind::Bool, x.value); }
+    NodeId operator()(const ast::VarIdx& x) const { return t_.add(NodeKind::Var, 0, x.index); }
+    NodeId operator()(const ast::NumComp& x) const {
+        return t_.add(NodeKind::NumComp, std::uint8_t(x.cmp), x.var.index, t_.add_num(x.val));
+    }
+    NodeId operator()(const ast::StrComp& x) const {
+        return t_.add(NodeKind::StrComp, std::uint8_t(x.cmp), x.var.index, t_.add_str(x.val));
+    }
+    NodeId operator()(const ast::UnaryExpr& x) const {
+        return t_.add(NodeKind::Unary, std::uint8_t(x.op), x.var.index);
+    }
+    NodeId operator()(const ast::SetExpr& x) const { return boost::apply_visitor(*this, x); }
+    NodeId operator()(const ast::ValInSet<int>& x) const {
+        return t_.add(NodeKind::IntInList, std::uint8_t(x.op), x.set.index, std::uint32_t(x.val));
+    }
+    NodeId operator()(const ast::ValInSet<std::string>& x) const {
+        return t_.add(NodeKind::StrInList, std::uint8_t(x.op), x.set.index, t_.add_str(x.val));
+    }
+    NodeId operator()(const ast::VarInSet<int>& x) const {
+        return t_.add(NodeKind::VarInInts, std::uint8_t(x.op), x.var.index, ints(x.set), std::uint32_t(x.set.size()));
+    }
+    NodeId operator()(const ast::VarInSet<std::string>& x) const {
+        return t_.add(NodeKind::VarInStrs, std::uint8_t(x.op), x.var.index, strs(x.set), std::uint32_t(x.set.size()));
+    }
+    NodeId operator()(const ast::ListExpr& x) const { return boost::apply_visitor(*this, x); }
+    NodeId operator()(const ast::VarVsSet<int>& x) const {
+        return t_.add(NodeKind::VarVsInts, std::uint8_t(x.op), x.var.index, ints(x.set), std::uint32_t(x.set.size()));
+    }
+    NodeId operator()(const ast::VarVsSet<std::string>& x) const {
+        return t_.add(NodeKind::VarVsStrs, std::uint8_t(x.op), x.var.index, strs(x.set), std::uint32_t(x.set.size()));
+    }
+#ifdef PREDICATE_EXTENSION_AST_TYPE
+    NodeId operator()(const PREDICATE_EXTENSION_AST_TYPE& x) const {
+        t_.ext.push_back(x);
+        return t_.add(NodeKind::Ext, 0, 0, std::uint32_t(t_.ext.size() - 1));
+    }
+#endif
+    NodeId operator()(const x3::forward_ast<ast::Conjunction>& x) const { return group(NodeKind::And, x.get().items); }
+    NodeId operator()(const x3::forward_ast<ast::Disjunction>& x) const { return group(NodeKind::Or, x.get().items); }
+    NodeId operator()(const x3::forward_ast<ast::Negation>& x) const {
+        return t_.add(NodeKind::Not, 0, 0, boost::apply_visitor(*this, x.get().expr));
+    }
+
+private:
+    std::uint32_t ints(const std::vector<int>& set) const {
+        auto first = std::uint32_t(t_.ints.size());
+        t_.ints.insert(t_.ints.end(), set.begin(), set.end());
+        return first;
+    }
+
+    std::uint32_t strs(const std::vector<std::string>& set) const {
+        auto first = std::uint32_t(t_.strs.size());
+        for (auto& s : set) t_.add_str(s);
+        return first;
+    }
+
+    // and/or of a single item stays a node of its own
+    NodeId group(NodeKind kind, const std::vector<ast::Expression>& items) const {
+        auto mark = t_.stack.size();
+        for (auto& x : items) {
+            auto id = boost::apply_visitor(*this, x);
+            t_.stack.push_back(id);
+        }
+        auto first = std::uint32_t(t_.items.size());
+        t_.items.insert(t_.items.end(), t_.stack.begin() + mark, t_.stack.end());
+        t_.stack.resize(mark);
+        return t_.add(kind, 0, 0, first, std::uint32_t(items.size()));
+    }
+
+    CompactAst& t_;
+};
+
+} // detail
+
+inline NodeId CompactAst::add(const ast::Expression& e) {
+    return boost::apply_visitor(detail::compact_builder(*this), e);
+}
+
+inline ast::Expression CompactAst::expression(NodeId id) const {
+    auto& x = nodes[id];
+    ast::VarIdx var(x.var);
+    auto int_set = [this, &x] { return std::vector<int>(ints.begin() + x.a, ints.begin() + x.a + x.b); };
+    auto str_set = [this, &x] {
+        std::vector<std::string> set;
+        for (std::uint32_t i = 0; i < x.b; ++i) set.emplace_back(str(x.a + i));
+        return set;
+    };
+    switch (x.kind) {
+    case NodeKind::Bool:
+        return ast::Expression(ast::BoolVal(x.op != 0));
+    case NodeKind::Var:
+        return ast::Expression(var);
+    case NodeKind::NumComp:
+        return ast::Expression(ast::NumComp{var, nums[x.a], ast::CompOp(x.op)});
+    case NodeKind::StrComp:
+        return ast::Expression(ast::StrComp{var, std::string(str(x.a)), ast::CompOp(x.op)});
+    case NodeKind::Unary:
+        return ast::Expression(ast::UnaryExpr{ast::UnaryOp(x.op), var});
+    case NodeKind::IntInList:
+        return ast::Expression(ast::SetExpr(ast::ValInSet<int>(int(x.a), ast::SetOp(x.op), var)));
+    case NodeKind::StrInList:
+        return ast::Expression(ast::SetExpr(ast::ValInSet<std::string>(std::string(str(x.a)), ast::SetOp(x.op), var)));
+    case NodeKind::VarInInts:
+        return ast::Expression(ast::SetExpr(ast::VarInSet<int>(var, ast::SetOp(x.op), int_set())));
+    case NodeKind::VarInStrs:
+        return ast::Expression(ast::SetExpr(ast::VarInSet<std::string>(var, ast::SetOp(x.op), str_set())));
+    case NodeKind::VarVsInts:
+        return ast::Expression(ast::ListExpr(ast::VarVsSet<int>(var, ast::ListOp(x.op), int_set())));
+    case NodeKind::VarVsStrs:
+        return ast::Expression(ast::ListExpr(ast::VarVsSet<std::string>(var, ast::ListOp(x.op), str_set())));
+    case NodeKind::Ext:
+#ifdef PREDICATE_EXTENSION_AST_TYPE
+        return ast::Expression(ext[x.a]);
+#else
+        break;
+#endif
+    case NodeKind::And: {
+        ast::Conjunction c;
+        for (auto i : children(id)) c.items.push_back(expression(i));
+        return ast::Expression(c);
+    }
+    case NodeKind::Or: {
+        ast::Disjunction d;
+        for (auto i : children(id)) d.items.push_back(expression(i));
+        return ast::Expression(d);
+    }
+    case NodeKind::Not:
+        return ast::Expression(ast::Negation{expression(x.a)});
+    }
+    BOOST_ASSERT_MSG(false, "unsupported node kind");
+    return ast::Expression();
+}
+
+} // lexen
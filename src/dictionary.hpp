@@ -0,0 +1,93 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions engine - string dictionary
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+#pragma once
+
+#include <boost/assert.hpp>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace lexen {
+
+/*
+ * Interned strings with dense 32-bit codes, assigned in order of first
+ * interning. Codes never change, so a dictionary shared by compiled
+ * programs and dictionary-encoded columns can keep growing while both are
+ * in use: equal strings have equal codes. Not synchronized.
+ *
+ * Codes of different dictionaries are unrelated; id() tells dictionaries
+ * apart for as long as the process runs, ids are never reused.
+ */
+class Dictionary {
+public:
+    static constexpr std::uint32_t npos = 0xFFFFFFFFu;
+
+    Dictionary() : id_(next_id()) {}
+    // interned strings are viewed by the code map
+    Dictionary(const Dictionary&) = delete;
+    Dictionary& operator=(const Dictionary&) = delete;
+    // the moved from dictionary is empty under a new id, so its codes are
+    // not confused with the ones moved away
+    Dictionary(Dictionary&& x) : strs_(std::move(x.strs_)), codes_(std::move(x.codes_)), id_(x.id_) {
+        x.clear();
+    }
+    Dictionary& operator=(Dictionary&& x) {
+        if (this != &x) {
+            strs_ = std::move(x.strs_);
+            codes_ = std::move(x.codes_);
+            id_ = x.id_;
+            x.clear();
+        }
+        return *this;
+    }
+
+    std::uint32_t id() const { return id_; }
+
+    // code of the string, added if new
+    std::uint32_t intern(std::string_view s) {
+        auto it = codes_.find(s);
+        if (it != codes_.end()) return it->second;
+        // codes are compared as signed 32-bit integers
+        BOOST_ASSERT_MSG(strs_.size() < 0x7FFFFFFFu, "dictionary is full");
+        auto code = std::uint32_t(strs_.size());
+        strs_.emplace_back(s);
+        codes_.emplace(strs_.back(), code);
+        return code;
+    }
+
+    // code of the string, or npos
+    std::uint32_t find(std::string_view s) const {
+        auto it = codes_.find(s);
+        return it == codes_.end() ? npos : it->second;
+    }
+
+    std::string_view str(std::uint32_t code) const { return strs_[code]; }
+
+    std::size_t size() const { return strs_.size(); }
+
+private:
+    void clear() {
+        codes_.clear();
+        strs_.clear();
+        id_ = next_id();
+    }
+
+    static std::uint32_t next_id() {
+        static std::atomic<std::uint32_t> n{0};
+        return n.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::deque<std::string> strs_;  // stable addresses for the keys
+    std::unordered_map<std::string_view, std::uint32_t> codes_;
+    std::uint32_t id_;
+};
+
+} // lexen
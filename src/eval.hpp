@@ -0,0 +1,260 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions engine - compiled program evaluation
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <iterator>
+
+#include "program.hpp"
+#include "simd.hpp"
+
+namespace lexen {
+
+/*
+ * Record is anything providing the following accessors:
+ *
+ *   bool is_null(ast::VarIdx) const;
+ *   bool is_empty(ast::VarIdx) const;           // list variable
+ *   bool get_bool(ast::VarIdx) const;
+ *   double get_num(ast::VarIdx) const;          // integer or real variable
+ *   std::string_view get_str(ast::VarIdx) const;
+ *   <contiguous range of int> get_ints(ast::VarIdx) const;
+ *   <range of std::string_view> get_strs(ast::VarIdx) const;
+ *
+ * Value accessors are only called for non-null variables. Predicate
+ * extensions are evaluated by eval_extension(ext, record) found by ADL,
+ * see extension.hpp.
+ *
+ * Programs are Program or ProgramView, both have the same pools.
+ */
+
+namespace detail {
+
+inline bool cmp(ast::CompOp op, double a, double b) {
+    switch (op) {
+    case ast::CompOp::Gt: return a >  b;
+    case ast::CompOp::Ge: return a >= b;
+    case ast::CompOp::Lt: return a <  b;
+    case ast::CompOp::Le: return a <= b;
+    case ast::CompOp::Eq: return a == b;
+    case ast::CompOp::Ne: return a != b;
+    }
+    return false;
+}
+
+template<typename P>
+inline bool has_int(const P& p, const Slice& s, int x) {
+    return p.int_pool.has(p.int_sets[s.offset], x);
+}
+
+template<typename P>
+inline bool has_str(const P& p, const StrSet& set, std::string_view x, const StrKey& k) {
+    return find(set, p.str_slots.data(), p.chars.data(), x, k);
+}
+
+// integer set membership of a number
+template<typename P>
+inline bool has_num(const P& p, const Slice& s, double x) {
+    if (!(x >= INT_MIN && x <= INT_MAX) || double(int(x)) != x) return false;
+    return has_int(p, s, int(x));
+}
+
+template<typename List, typename T>
+inline bool contains(const List& list, const T& x) {
+    return std::find(list.begin(), list.end(), x) != list.end();
+}
+
+// number within bounds of the range instruction
+template<typename P>
+inline bool in_range(const P& p, const Instr& in, double x) {
+    auto lo = p.nums[in.arg.slice.offset];
+    auto hi = p.nums[in.arg.slice.offset + 1];
+    return (in.sub & 1 ? x > lo : x >= lo) && (in.sub & 2 ? x < hi : x <= hi);
+}
+
+// integer is an element of the list
+template<typename List>
+inline bool has_elem(const List& list, int x) {
+    return simd::find_i32(std::data(list), std::size(list), x);
+}
+
+// Every integer of the set is an element of the list: sorted lists are
+// merged with the set, others are scanned for each element of the set.
+template<typename P, typename List>
+inline bool all_ints(const P& p, const IntSet& set, const List& list) {
+    auto data = std::data(list);
+    std::size_t n = std::size(list);
+    if (n < set.size) return false;
+    if (std::is_sorted(data, data + n)) {
+        std::size_t i = 0;
+        return p.int_pool.every(set, [data, n, &i] (int x) {
+            while (i < n && data[i] < x) ++i;
+            return i < n && data[i] == x;
+        });
+    }
+    return p.int_pool.every(set, [data, n] (int x) { return simd::find_i32(data, n, x); });
+}
+
+template<typename P, typename List>
+inline bool one_int(const P& p, const IntSet& set, const List& list) {
+    for (int x : list)
+        if (p.int_pool.has(set, x)) return true;
+    return false;
+}
+
+// Every string of the set is an element of the list: small sets are
+// scanned for, otherwise distinct table slots hit by the list are counted,
+// in bits on the stack for tables of up to 4096 slots, in scratch of the
+// key cache for larger ones, which is kept for the next records.
+template<typename P, typename List>
+inline bool all_strs(const P& p, const StrSet& set, const List& list, StrKeyCache* keys) {
+    if (std::size(list) < set.size) return false;
+    if (set.size <= 8) {
+        for (std::uint32_t i = 0; i < set.size; ++i)
+            if (!contains(list, p.str(p.strs[set.strs + i]))) return false;
+        return true;
+    }
+    constexpr std::size_t small = 64;
+    std::size_t words = (std::size_t(set.mask) + 64) / 64;
+    std::uint64_t bits[small];
+    std::vector<std::uint64_t> local;
+    std::uint64_t* seen = bits;
+    if (words <= small) std::fill_n(bits, words, 0);
+    else if (keys) seen = keys->bits(words);
+    else {
+        local.assign(words, 0);
+        seen = local.data();
+    }
+    std::uint32_t found = 0;
+    for (std::string_view x : list) {
+        auto i = find_slot(set, p.str_slots.data(), p.chars.data(), x, str_key(x));
+        if (i == StrSlot::npos || (seen[i / 64] >> (i % 64) & 1)) continue;
+        seen[i / 64] |= std::uint64_t(1) << (i % 64);
+        if (++found == set.size) return true;
+    }
+    return false;
+}
+
+template<typename P, typename List>
+inline bool one_str(const P& p, const StrSet& set, const List& list) {
+    for (std::string_view x : list)
+        if (has_str(p, set, x, str_key(x))) return true;
+    return false;
+}
+
+#ifdef PREDICATE_EXTENSION_AST_TYPE
+// Extension predicate, cached by the value of its variable if there is a
+// cache and the extension declares the variable, see extension.hpp.
+template<typename P, typename Record>
+inline bool ext(const P& p, const Instr& in, const Record& rec, ResultCache* cache) {
+    using X = std::decay_t<decltype(p.ext[0])>;
+    auto i = in.arg.slice.offset;
+    auto& x = p.ext[i];
+    if constexpr (has_ext_var<X>::value) {
+        auto var = extension_var(x);
+        if (cache && !rec.is_null(var))
+            return cache->get(p.ext_ids[i], rec.get_str(var), [&] { return bool(eval_extension(x, rec)); });
+    }
+    (void)cache;
+    return eval_extension(x, rec);
+}
+#endif
+
+// Checks predicate of the instruction ignoring its neg flag. Returns false
+// when variable the predicate depends on is null, sets null flag then.
+// Keys of string variables are shared through the cache if given, results
+// of extensions through the result cache.
+template<typename P, typename Record>
+inline bool test(const P& p, const Instr& in, const Record& rec, bool& null,
+    StrKeyCache* keys = nullptr, ResultCache* ext_cache = nullptr)
+{
+    (void)ext_cache;    // used by extensions only
+    ast::VarIdx var(in.var);
+    null = false;
+    switch (in.op) {
+    case OpCode::IsNull:
+        return rec.is_null(var);
+    case OpCode::IsNotNull:
+        return !rec.is_null(var);
+    case OpCode::IsEmpty:
+        return rec.is_null(var) || rec.is_empty(var);
+#ifdef PREDICATE_EXTENSION_AST_TYPE
+    case OpCode::Ext:
+        return ext(p, in, rec, ext_cache);
+#endif
+    default:
+        break;
+    }
+    if (rec.is_null(var)) {
+        null = true;
+        return false;
+    }
+    switch (in.op) {
+    case OpCode::BoolVar:
+        return rec.get_bool(var);
+    case OpCode::NumCmp:
+        return cmp(ast::CompOp(in.sub), rec.get_num(var), in.arg.num);
+    case OpCode::NumRange:
+        return in_range(p, in, rec.get_num(var));
+    case OpCode::StrEq:
+        return rec.get_str(var) == p.str(in.arg.slice);
+    case OpCode::IntIn:
+        return has_num(p, in.arg.slice, rec.get_num(var));
+    case OpCode::StrIn: {
+        auto x = rec.get_str(var);
+        return has_str(p, p.str_sets[in.arg.slice.offset], x, keys ? keys->get(in.var, x) : str_key(x));
+    }
+    case OpCode::HasInt:
+        return has_elem(rec.get_ints(var), in.arg.ival);
+    case OpCode::HasStr:
+        return contains(rec.get_strs(var), p.str(in.arg.slice));
+    case OpCode::IntsVs: {
+        auto& set = p.int_sets[in.arg.slice.offset];
+        if (ast::ListOp(in.sub) == ast::ListOp::AllOf) return all_ints(p, set, rec.get_ints(var));
+        return one_int(p, set, rec.get_ints(var));
+    }
+    case OpCode::StrsVs: {
+        auto& set = p.str_sets[in.arg.slice.offset];
+        if (ast::ListOp(in.sub) == ast::ListOp::AllOf) return all_strs(p, set, rec.get_strs(var), keys);
+        return one_str(p, set, rec.get_strs(var));
+    }
+    default:
+        break;
+    }
+    BOOST_ASSERT_MSG(false, "unsupported op code");
+    return false;
+}
+
+} // detail
+
+// Run program against a record, unknown result counts as false. The cache
+// is reset, its scratch is reused across calls. Extension results are
+// cached in ext_cache if given, see extension.hpp.
+template<typename P, typename Record>
+inline bool eval(const P& p, const Record& rec, StrKeyCache& keys, ResultCache* ext_cache = nullptr) {
+    const Instr* code = p.code.data();
+    std::uint32_t pc = p.entry;
+    keys.reset();
+    while (pc < Program::reject) {
+        const Instr& in = code[pc];
+        bool null;
+        bool r = detail::test(p, in, rec, null, &keys, ext_cache);
+        pc = !null && r != in.neg ? in.on_true : in.on_false;
+    }
+    return pc == Program::accept;
+}
+
+// same with a cache of its own, "all of" over large string sets allocates
+template<typename P, typename Record>
+inline bool eval(const P& p, const Record& rec) {
+    StrKeyCache keys;
+    return eval(p, rec, keys);
+}
+
+} // lexen
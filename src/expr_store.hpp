@@ -0,0 +1,143 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions engine - hash-consed expression store
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "ast_hash.hpp"
+
+namespace lexen {
+
+namespace x3 = boost::spirit::x3;
+
+// id of an expression in ExprStore
+using ExprId = std::uint32_t;
+
+/*
+ * Canonical store of expressions. Every node is interned: identical
+ * subtrees are stored once and get the same id, so structural equality of
+ * interned expressions is equality of their ids. Node hashes are the same
+ * as boost::hash of the corresponding ast::Expression.
+ */
+class ExprStore {
+public:
+    enum class Kind : std::uint8_t { Leaf, And, Or, Not };
+
+    ExprId intern(const ast::Expression& e) {
+        if (auto c = boost::get<x3::forward_ast<ast::Conjunction>>(&e.get()))
+            return compound(Kind::And, e.get().which(), c->get().items);
+        if (auto d = boost::get<x3::forward_ast<ast::Disjunction>>(&e.get()))
+            return compound(Kind::Or, e.get().which(), d->get().items);
+        if (auto n = boost::get<x3::forward_ast<ast::Negation>>(&e.get())) {
+            ExprId child = intern(n->get().expr);
+            std::size_t h = e.get().which();
+            boost::hash_combine(h, nodes_[child].hash);
+            return insert(Node{Kind::Not, 0, 1, h}, &child);
+        }
+        auto h = boost::hash<ast::Expression>()(e);
+        for (auto id : bucket(h)) {
+            auto& x = nodes_[id];
+            if (x.kind == Kind::Leaf && leaves_[x.first] == e) return id;
+        }
+        auto id = ExprId(nodes_.size());
+        nodes_.push_back(Node{Kind::Leaf, std::uint32_t(leaves_.size()), 0, h});
+        leaves_.push_back(e);
+        index_[h].push_back(id);
+        return id;
+    }
+
+    // rebuilds expression tree
+    ast::Expression get(ExprId id) const {
+        auto& x = nodes_[id];
+        switch (x.kind) {
+        case Kind::Leaf:
+            return leaves_[x.first];
+        case Kind::And: {
+            ast::Conjunction c;
+            for (auto i : children(id)) c.items.push_back(get(i));
+            return ast::Expression(c);
+        }
+        case Kind::Or: {
+            ast::Disjunction d;
+            for (auto i : children(id)) d.items.push_back(get(i));
+            return ast::Expression(d);
+        }
+        case Kind::Not:
+            return ast::Expression(ast::Negation{get(children_[x.first])});
+        }
+        return ast::Expression();
+    }
+
+    Kind kind(ExprId id) const { return nodes_[id].kind; }
+
+    // stable structural hash
+    std::size_t hash(ExprId id) const { return nodes_[id].hash; }
+
+    // items of and/or, operand of not
+    std::vector<ExprId> children(ExprId id) const {
+        auto& x = nodes_[id];
+        if (x.kind == Kind::Leaf) return {};
+        return std::vector<ExprId>(children_.begin() + x.first, children_.begin() + x.first + x.count);
+    }
+
+    const ast::Expression& leaf(ExprId id) const { return leaves_[nodes_[id].first]; }
+
+    // number of distinct nodes
+    std::size_t size() const { return nodes_.size(); }
+
+private:
+    struct Node {
+        Kind kind;
+        std::uint32_t first;    // leaf index or offset of the children
+        std::uint32_t count;    // number of children
+        std::size_t hash;
+    };
+
+    const std::vector<ExprId>& bucket(std::size_t h) const {
+        static const std::vector<ExprId> empty;
+        auto it = index_.find(h);
+        return it == index_.end() ? empty : it->second;
+    }
+
+    ExprId compound(Kind kind, int which, const std::vector<ast::Expression>& items) {
+        std::vector<ExprId> ids;
+        ids.reserve(items.size());
+        std::size_t items_hash = 0;
+        for (auto& item : items) {
+            ids.push_back(intern(item));
+            boost::hash_combine(items_hash, nodes_[ids.back()].hash);
+        }
+        std::size_t h = which;
+        boost::hash_combine(h, items_hash);
+        return insert(Node{kind, 0, std::uint32_t(ids.size()), h}, ids.data());
+    }
+
+    ExprId insert(Node node, const ExprId* ids) {
+        for (auto id : bucket(node.hash)) {
+            auto& x = nodes_[id];
+            if (x.kind == node.kind && x.count == node.count
+                && std::equal(ids, ids + node.count, children_.begin() + x.first))
+                return id;
+        }
+        node.first = std::uint32_t(children_.size());
+        children_.insert(children_.end(), ids, ids + node.count);
+        auto id = ExprId(nodes_.size());
+        nodes_.push_back(node);
+        index_[node.hash].push_back(id);
+        return id;
+    }
+
+    std::vector<Node> nodes_;
+    std::vector<ExprId> children_;
+    std::vector<ast::Expression> leaves_;
+    std::unordered_map<std::size_t, std::vector<ExprId>> index_;
+};
+
+} // lexen
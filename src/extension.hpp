@@ -0,0 +1,133 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions engine - predicate extension evaluation
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/container_hash/hash.hpp>
+
+#include "ast.hpp"
+#include "result_cache.hpp"
+
+namespace lexen {
+
+class Batch;
+
+/*
+ * Predicate extensions are evaluated through functions found by ADL on
+ * the type programs store them as, ExtCode. That is the AST node type
+ * PREDICATE_EXTENSION_AST_TYPE, or PREDICATE_EXTENSION_EVAL_TYPE if the
+ * extension defines one:
+ *
+ *   // required, result of the predicate for a record (see eval.hpp)
+ *   bool eval_extension(const ExtCode&, const Record&);
+ *
+ *   // compile hook, required with PREDICATE_EXTENSION_EVAL_TYPE: the
+ *   // form to evaluate, e.g. with a matcher built for the literal
+ *   ExtCode compile_extension(const PREDICATE_EXTENSION_AST_TYPE&);
+ *
+ *   // optional batch hook: sets bits of truth for the rows of the batch
+ *   // the predicate is true for, only rows are looked at
+ *   void eval_extension(const ExtCode&, const Batch&, const std::vector<std::uint32_t>& rows,
+ *       std::uint64_t* truth);
+ *
+ *   // optional cost hint, in units of a numeric comparison, 16 if missing
+ *   double extension_cost(const ExtCode&);
+ *
+ *   // optional, string variable the result depends on alone
+ *   ast::VarIdx extension_var(const ExtCode&);
+ *
+ * Extension results are always known: a predicate over a null variable
+ * decides what it is itself.
+ *
+ * Results of extensions declaring their variable may be cached in a
+ * ResultCache, opted in by a pointer: BatchContext::ext_cache for batches,
+ * keyed by dictionary and code over dictionary-encoded columns instead of
+ * calling the batch hook, by the string value where batches fall back to
+ * row at a time evaluation; RuleSetContext::ext_cache, also used by rule
+ * indexes and dependency tracking, AdaptiveProgram::set_ext_cache() and
+ * the ext_cache argument of eval() for records, keyed by the string
+ * value. Null values are not cached. Each distinct extension is one
+ * predicate of the cache, its id is interned by the AST node in the
+ * process (see detail::ext_id()), so programs compiled from the same
+ * extension, including recompiled ones, share results.
+ *
+ * Programs intern the AST node, and the optimizer, rule sets, rule
+ * indexes and adaptive programs hash expressions, so they also need
+ * operator== and hash_value() of the AST node for boost::hash. Rule set
+ * images can not hold extensions. The macros must be defined and the
+ * functions declared before the engine headers are included.
+ */
+
+#ifdef PREDICATE_EXTENSION_AST_TYPE
+
+#ifdef PREDICATE_EXTENSION_EVAL_TYPE
+using ExtCode = PREDICATE_EXTENSION_EVAL_TYPE;
+#else
+using ExtCode = PREDICATE_EXTENSION_AST_TYPE;
+#endif
+
+namespace detail {
+
+template<typename X>
+inline ExtCode compile_ext(const X& x) {
+#ifdef PREDICATE_EXTENSION_EVAL_TYPE
+    return compile_extension(x);
+#else
+    return x;
+#endif
+}
+
+// ResultCache predicate id of the extension, the same for equal AST nodes
+// in the process; nodes are kept for the lifetime of the process
+template<typename X>
+inline std::uint32_t ext_id(const X& x) {
+    static std::mutex mutex;
+    static std::unordered_map<X, std::uint32_t, boost::hash<X>> ids;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = ids.find(x);
+    if (it == ids.end()) it = ids.emplace(x, ResultCache::predicate()).first;
+    return it->second;
+}
+
+template<typename X, typename = void>
+struct has_ext_batch : std::false_type {};
+
+template<typename X>
+struct has_ext_batch<X, std::void_t<decltype(eval_extension(std::declval<const X&>(),
+    std::declval<const Batch&>(), std::declval<const std::vector<std::uint32_t>&>(),
+    std::declval<std::uint64_t*>()))>> : std::true_type {};
+
+template<typename X, typename = void>
+struct has_ext_cost : std::false_type {};
+
+template<typename X>
+struct has_ext_cost<X, std::void_t<decltype(extension_cost(std::declval<const X&>()))>> : std::true_type {};
+
+template<typename X, typename = void>
+struct has_ext_var : std::false_type {};
+
+template<typename X>
+struct has_ext_var<X, std::void_t<decltype(extension_var(std::declval<const X&>()))>> : std::true_type {};
+
+template<typename X>
+inline double ext_cost(const X& x) {
+    if constexpr (has_ext_cost<X>::value) return double(extension_cost(x));
+    else return 16;
+}
+
+} // detail
+
+#endif
+
+} // lexen
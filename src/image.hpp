@@ -0,0 +1,568 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions engine - memory mappable rule set image
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+#include "mapped_file.hpp"
+#include "rule_index.hpp"
+#include "rule_set.hpp"
+#include "schema.hpp"
+
+namespace lexen {
+
+/*
+ * Binary image of a built rule set or rule index: a header followed by
+ * the flat arrays of the rule set, each 8-byte aligned, at offsets from
+ * the start of the image. An index image holds the rule set of its
+ * residual atoms the same way, followed by the arrays of the index. There
+ * are no pointers, so a mapped image is used in place, and processes
+ * mapping the same file share its pages. Images are only readable by the
+ * same version on the same byte order and struct layout, which the header
+ * records, against a schema giving the variables the image reads the same
+ * types, which the header records a fingerprint of. Section bounds, jump
+ * targets, pool references, op codes and index kinds against types of
+ * their variables, order of index entries and bool bytes are checked once
+ * on load, so a corrupt image is rejected rather than read out of bounds.
+ * Rule sets with predicate extensions have no images: compiled extensions
+ * are not plain data.
+ */
+namespace image {
+
+constexpr char magic[8] = {'L', 'E', 'X', 'E', 'N', 'R', 'S', 0};
+constexpr std::uint32_t version = 3;
+constexpr std::uint32_t byte_order = 0x01020304u;
+
+enum Section : std::uint32_t {
+    Code, IntSets, Ints, Bits, Chunks, Lows, Nums, Chars, Strs, StrSets, StrSlots, RuleCode, Entries,
+    IndexVars, IndexNums, IndexInts, IndexStrs, IndexChars, IndexBounds, IndexLists, IndexPostings,
+    IndexConjuncts, IndexAlways,
+    sections
+};
+
+enum Kind : std::uint32_t { RuleSetKind, RuleIndexKind };
+
+// array in the image, size in elements
+struct Extent {
+    std::uint64_t offset;
+    std::uint64_t size;
+};
+
+struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint32_t layout[10];   // sizes of structs, see layout()
+    std::uint32_t entry;        // of predicates program
+    std::uint32_t kind;
+    std::uint32_t rules;        // of an index
+    std::uint32_t reserved;
+    std::uint64_t schema;       // fingerprint of variables read, see fingerprint()
+    Extent extents[sections];
+};
+
+inline void layout(std::uint32_t* x) {
+    x[0] = sizeof(Instr);
+    x[1] = sizeof(IntSet);
+    x[2] = sizeof(StrSet);
+    x[3] = sizeof(StrSlot);
+    x[4] = sizeof(IndexVar);
+    x[5] = sizeof(NumEntry);
+    x[6] = sizeof(IntEntry);
+    x[7] = sizeof(StrEntry);
+    x[8] = sizeof(Threshold);
+    x[9] = sizeof(IndexConjunct);
+}
+
+// Hash of the indices and types of the variables predicates and the index
+// read, false if the schema lacks one of them.
+inline bool fingerprint(ListView<Instr> preds, ListView<IndexVar> index, const Schema& schema,
+    std::uint64_t& out)
+{
+    std::vector<int> vars;
+    for (auto& in : preds) vars.push_back(in.var);
+    for (auto& v : index) vars.push_back(v.var);
+    std::sort(vars.begin(), vars.end());
+    vars.erase(std::unique(vars.begin(), vars.end()), vars.end());
+    out = 0x9e3779b97f4a7c15ull;
+    for (auto var : vars) {
+        if (!schema.has(ast::VarIdx(var))) return false;
+        auto type = std::uint64_t(schema.type(ast::VarIdx(var)));
+        out = str_mix((out ^ (std::uint64_t(std::uint32_t(var)) << 8 | type)) * 0x94d049bb133111ebull);
+    }
+    return true;
+}
+
+// copies with padding and unused argument bytes zeroed, as saved
+inline Instr plain(const Instr& x) {
+    Instr r;
+    std::memset(&r, 0, sizeof(r));
+    r.op = x.op;
+    r.sub = x.sub;
+    r.neg = x.neg;
+    r.var = x.var;
+    r.on_true = x.on_true;
+    r.on_false = x.on_false;
+    switch (x.op) {
+    case OpCode::BoolVar: case OpCode::IsNull: case OpCode::IsNotNull: case OpCode::IsEmpty:
+        break;
+    case OpCode::NumCmp:
+        r.arg.num = x.arg.num;
+        break;
+    case OpCode::HasInt: case OpCode::Pred:
+        r.arg.ival = x.arg.ival;
+        break;
+    default:
+        r.arg.slice = x.arg.slice;
+        break;
+    }
+    return r;
+}
+
+inline IntSet plain(const IntSet& x) {
+    IntSet r;
+    std::memset(&r, 0, sizeof(r));
+    r.kind = x.kind;
+    r.size = x.size;
+    r.offset = x.offset;
+    r.count = x.count;
+    r.min = x.min;
+    r.max = x.max;
+    return r;
+}
+
+// array of the image within its bounds
+template<typename T>
+inline bool get(std::string_view data, const Extent& x, ListView<T>& out) {
+    if (x.offset % 8 || x.offset > data.size() || x.size > (data.size() - x.offset) / sizeof(T))
+        return false;
+    out = ListView<T>(reinterpret_cast<const T*>(data.data() + x.offset), std::size_t(x.size));
+    return true;
+}
+
+// [offset, offset + size) is within n
+inline bool within(std::uint64_t offset, std::uint64_t size, std::uint64_t n) {
+    return offset <= n && size <= n - offset;
+}
+
+// jump target of instruction pc of code of size n, forward or terminal
+inline bool target(std::uint32_t to, std::size_t pc, std::size_t n) {
+    return to >= Program::reject || (to > pc && to < n);
+}
+
+inline bool entry(std::uint32_t to, std::size_t n) {
+    return to >= Program::reject || to < n;
+}
+
+inline bool check_int_set(const ProgramView& p, const IntSet& s) {
+    auto& pool = p.int_pool;
+    switch (s.kind) {
+    case IntSetKind::Array:
+        return within(s.offset, s.size, pool.ints.size());
+    case IntSetKind::Bitset:
+        return s.min <= s.max
+            && within(s.offset, (std::uint64_t(std::int64_t(s.max) - s.min) + 64) / 64, pool.bits.size());
+    case IntSetKind::Chunks:
+        if (!within(s.offset, s.count, pool.chunks.size())) return false;
+        for (std::uint32_t i = 0; i < s.count; ++i) {
+            auto& c = pool.chunks[s.offset + i];
+            bool ok = c.size > IntPool::max_array_chunk
+                ? within(c.offset, IntPool::chunk_bits / 64, pool.bits.size())
+                : within(c.offset, c.size, pool.lows.size());
+            if (!ok) return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+// Set of strings within the pools, with a table of its size loaded at
+// most by half, so lookups end at an empty slot.
+inline bool check_str_set(const ProgramView& p, const StrSet& s) {
+    std::uint64_t cap = std::uint64_t(s.mask) + 1;
+    if ((cap & s.mask) || cap < 2 * std::uint64_t(s.size) || !within(s.strs, s.size, p.strs.size())
+        || !within(s.slots, cap, p.str_slots.size()))
+        return false;
+    std::uint64_t used = 0;
+    for (std::uint64_t i = 0; i < cap; ++i) {
+        auto& x = p.str_slots[s.slots + i];
+        if (x.size == StrSlot::npos) continue;
+        if (!within(x.offset, x.size, p.chars.size())) return false;
+        ++used;
+    }
+    return used == s.size;
+}
+
+// neg byte holds a valid bool, read as a byte as it may not
+inline bool check_neg(const Instr& in) {
+    std::uint8_t b;
+    std::memcpy(&b, reinterpret_cast<const char*>(&in) + offsetof(Instr, neg), 1);
+    return b <= 1;
+}
+
+// predicate reads only what the pools have
+inline bool check_pred(const ProgramView& p, const Instr& in) {
+    auto& s = in.arg.slice;
+    switch (in.op) {
+    case OpCode::BoolVar: case OpCode::IsNull: case OpCode::IsNotNull: case OpCode::IsEmpty:
+    case OpCode::HasInt:
+        return true;
+    case OpCode::NumCmp:
+        return in.sub <= std::uint8_t(ast::CompOp::Ne);
+    case OpCode::NumRange:
+        return in.sub < 4 && within(s.offset, 2, p.nums.size());
+    case OpCode::StrEq: case OpCode::HasStr:
+        return within(s.offset, s.size, p.chars.size());
+    case OpCode::IntIn:
+        return s.offset < p.int_sets.size();
+    case OpCode::StrIn:
+        return s.offset < p.str_sets.size();
+    case OpCode::IntsVs:
+        return in.sub <= std::uint8_t(ast::ListOp::NoneOf) && s.offset < p.int_sets.size();
+    case OpCode::StrsVs:
+        return in.sub <= std::uint8_t(ast::ListOp::NoneOf) && s.offset < p.str_sets.size();
+    default:
+        return false;
+    }
+}
+
+// predicate applies to a variable of the type, as the grammar allows
+inline bool check_type(OpCode op, var_type t) {
+    switch (op) {
+    case OpCode::IsNull: case OpCode::IsNotNull:
+        return true;
+    case OpCode::IsEmpty:
+        return t == var_type::integers || t == var_type::strings;
+    case OpCode::BoolVar:
+        return t == var_type::boolean;
+    case OpCode::NumCmp: case OpCode::NumRange:
+        return t == var_type::integer || t == var_type::realnum;
+    case OpCode::IntIn:
+        return t == var_type::integer;
+    case OpCode::StrEq: case OpCode::StrIn:
+        return t == var_type::string;
+    case OpCode::HasInt: case OpCode::IntsVs:
+        return t == var_type::integers;
+    case OpCode::HasStr: case OpCode::StrsVs:
+        return t == var_type::strings;
+    default:
+        return false;
+    }
+}
+
+// contents of a rule set view read from an image refer within it, and its
+// predicates read variables of the schema as their types are
+inline bool check(const RuleSetView& r, const Schema& schema) {
+    auto& p = r.preds;
+    auto n = p.code.size();
+    if (!entry(p.entry, n)) return false;
+    for (std::size_t pc = 0; pc < n; ++pc) {
+        auto& in = p.code[pc];
+        ast::VarIdx var(in.var);
+        if (!check_neg(in) || !check_pred(p, in) || !schema.has(var) || !check_type(in.op, schema.type(var))
+            || !target(in.on_true, pc, n) || !target(in.on_false, pc, n))
+            return false;
+    }
+    for (auto& s : p.int_sets)
+        if (!check_int_set(p, s)) return false;
+    for (auto& s : p.strs)
+        if (!within(s.offset, s.size, p.chars.size())) return false;
+    for (auto& s : p.str_sets)
+        if (!check_str_set(p, s)) return false;
+
+    for (std::size_t pc = 0; pc < r.code.size(); ++pc) {
+        auto& in = r.code[pc];
+        if (!check_neg(in) || in.op != OpCode::Pred || in.arg.ival < 0 || std::size_t(in.arg.ival) >= n
+            || !target(in.on_true, pc, r.code.size()) || !target(in.on_false, pc, r.code.size()))
+            return false;
+    }
+    for (auto entry : r.entries)
+        if (!image::entry(entry, r.code.size())) return false;
+    return true;
+}
+
+// index kind applies to a variable of the type
+inline bool check_kind(IndexKind kind, var_type t) {
+    switch (kind) {
+    case IndexKind::Bool:
+        return t == var_type::boolean;
+    case IndexKind::Num:
+        return t == var_type::integer || t == var_type::realnum;
+    case IndexKind::Str:
+        return t == var_type::string;
+    case IndexKind::Ints:
+        return t == var_type::integers;
+    case IndexKind::Strs:
+        return t == var_type::strings;
+    default:
+        return false;
+    }
+}
+
+// entries of the slice are within the array and in strictly ascending order
+template<typename Entry, typename Less>
+inline bool check_sorted(ListView<Entry> all, const Slice& s, Less less) {
+    if (!within(s.offset, s.size, all.size())) return false;
+    for (std::uint32_t i = 1; i < s.size; ++i)
+        if (!less(all[s.offset + i - 1], all[s.offset + i])) return false;
+    return true;
+}
+
+// contents of an index view read from an image refer within it, its
+// variables are of types their index applies to, and the number of
+// indexed atoms of each conjunct is that of postings to it
+inline bool check(const RuleIndexView& x, const Schema& schema) {
+    if (!check(x.residuals, schema)) return false;
+    auto lists = x.lists.size();
+    auto by_value = [] (const auto& a, const auto& b) { return a.value < b.value; };
+    auto str_less = [&x] (const StrEntry& a, const StrEntry& b) { return x.str(a.value) < x.str(b.value); };
+    for (auto& v : x.vars) {
+        ast::VarIdx var(v.var);
+        if (!schema.has(var) || !check_kind(v.kind, schema.type(var))
+            || !within(v.bools[0].offset, v.bools[0].size, lists)
+            || !within(v.bools[1].offset, v.bools[1].size, lists)
+            || !check_sorted(x.nums, v.nums, by_value) || !check_sorted(x.ints, v.ints, by_value))
+            return false;
+        for (auto& b : v.bounds) {
+            if (!within(b.offset, b.size, x.bounds.size())) return false;
+            for (std::uint32_t i = 1; i < b.size; ++i)
+                if (!(x.bounds[b.offset + i - 1].value <= x.bounds[b.offset + i].value)) return false;
+        }
+        // values of entries are checked before they are compared
+        if (!within(v.strs.offset, v.strs.size, x.strs.size())) return false;
+        for (std::uint32_t i = 0; i < v.strs.size; ++i) {
+            auto& value = x.strs[v.strs.offset + i].value;
+            if (!within(value.offset, value.size, x.chars.size())) return false;
+        }
+        if (!check_sorted(x.strs, v.strs, str_less)) return false;
+    }
+    for (auto& e : x.nums)
+        if (!within(e.postings.offset, e.postings.size, lists)) return false;
+    for (auto& e : x.ints)
+        if (!within(e.postings.offset, e.postings.size, lists)) return false;
+    for (auto& e : x.strs)
+        if (!within(e.postings.offset, e.postings.size, lists)) return false;
+    for (auto p : x.lists)
+        if (p >= x.postings.size()) return false;
+    for (auto& t : x.bounds)
+        if (t.posting >= x.postings.size()) return false;
+
+    std::vector<std::uint32_t> need(x.conjuncts.size(), 0);
+    for (auto c : x.postings) {
+        if (c >= need.size()) return false;
+        ++need[c];
+    }
+    for (std::size_t c = 0; c < need.size(); ++c) {
+        auto& in = x.conjuncts[c];
+        if (in.rule >= x.rules || in.need != need[c]
+            || (in.residual != IndexConjunct::none && in.residual >= x.residuals.entries.size()))
+            return false;
+    }
+    for (auto c : x.always)
+        if (c >= need.size() || need[c]) return false;
+    return true;
+}
+
+// Image of the rule set, and of the index if given. Empty if there is no
+// image: the rule set has extensions, or reads variables the schema lacks.
+inline std::string save(const RuleSetView& r, const RuleIndexView* index, const Schema& schema) {
+#ifdef PREDICATE_EXTENSION_AST_TYPE
+    if (!r.preds.ext.empty()) return std::string();
+#endif
+    Header h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, magic, sizeof(h.magic));
+    h.version = version;
+    h.byte_order = byte_order;
+    layout(h.layout);
+    h.entry = r.preds.entry;
+    h.kind = index ? RuleIndexKind : RuleSetKind;
+    h.rules = index ? index->rules : 0;
+    if (!fingerprint(r.preds.code, index ? index->vars : ListView<IndexVar>(), schema, h.schema))
+        return std::string();
+
+    std::string out(sizeof(h), '\0');
+    auto put = [&out, &h] (Section s, const void* data, std::size_t size, std::size_t elem) {
+        out.resize((out.size() + 7) / 8 * 8, '\0');
+        h.extents[s] = Extent{out.size(), size};
+        out.append(static_cast<const char*>(data), size * elem);
+    };
+    // structs with padding are saved as plain copies
+    auto plain = [] (const auto& list) {
+        std::vector<std::decay_t<decltype(list[0])>> r;
+        for (auto& x : list) r.push_back(image::plain(x));
+        return r;
+    };
+    auto& p = r.preds;
+    auto code = plain(p.code);
+    auto int_sets = plain(p.int_sets);
+    auto rule_code = plain(r.code);
+    put(Code, code.data(), code.size(), sizeof(Instr));
+    put(IntSets, int_sets.data(), int_sets.size(), sizeof(IntSet));
+    put(Ints, p.int_pool.ints.data(), p.int_pool.ints.size(), sizeof(int));
+    put(Bits, p.int_pool.bits.data(), p.int_pool.bits.size(), sizeof(std::uint64_t));
+    put(Chunks, p.int_pool.chunks.data(), p.int_pool.chunks.size(), sizeof(IntChunk));
+    put(Lows, p.int_pool.lows.data(), p.int_pool.lows.size(), sizeof(std::uint16_t));
+    put(Nums, p.nums.data(), p.nums.size(), sizeof(double));
+    put(Chars, p.chars.data(), p.chars.size(), 1);
+    put(Strs, p.strs.data(), p.strs.size(), sizeof(Slice));
+    put(StrSets, p.str_sets.data(), p.str_sets.size(), sizeof(StrSet));
+    put(StrSlots, p.str_slots.data(), p.str_slots.size(), sizeof(StrSlot));
+    put(RuleCode, rule_code.data(), rule_code.size(), sizeof(Instr));
+    put(Entries, r.entries.data(), r.entries.size(), sizeof(std::uint32_t));
+    if (index) {
+        // index structs have no padding
+        auto& x = *index;
+        put(IndexVars, x.vars.data(), x.vars.size(), sizeof(IndexVar));
+        put(IndexNums, x.nums.data(), x.nums.size(), sizeof(NumEntry));
+        put(IndexInts, x.ints.data(), x.ints.size(), sizeof(IntEntry));
+        put(IndexStrs, x.strs.data(), x.strs.size(), sizeof(StrEntry));
+        put(IndexChars, x.chars.data(), x.chars.size(), 1);
+        put(IndexBounds, x.bounds.data(), x.bounds.size(), sizeof(Threshold));
+        put(IndexLists, x.lists.data(), x.lists.size(), sizeof(std::uint32_t));
+        put(IndexPostings, x.postings.data(), x.postings.size(), sizeof(std::uint32_t));
+        put(IndexConjuncts, x.conjuncts.data(), x.conjuncts.size(), sizeof(IndexConjunct));
+        put(IndexAlways, x.always.data(), x.always.size(), sizeof(std::uint32_t));
+    }
+    out.resize((out.size() + 7) / 8 * 8, '\0');
+    std::memcpy(&out[0], &h, sizeof(h));
+    return out;
+}
+
+// Rule set of the image of the kind, and the index if given. Returns false
+// if the data is not a valid image compatible with the schema.
+inline bool view(std::string_view data, const Schema& schema, Kind kind, RuleSetView& r, RuleIndexView* index) {
+    if (data.size() < sizeof(Header) || reinterpret_cast<std::uintptr_t>(data.data()) % 8)
+        return false;
+    Header h;
+    std::memcpy(&h, data.data(), sizeof(h));
+    std::uint32_t sizes[10];
+    layout(sizes);
+    if (std::memcmp(h.magic, magic, sizeof(h.magic)) || h.version != version || h.byte_order != byte_order
+        || std::memcmp(h.layout, sizes, sizeof(sizes)) || h.kind != kind)
+        return false;
+
+    RuleSetView v;
+    auto& p = v.preds;
+    p.entry = h.entry;
+    ListView<char> chars;
+    bool ok = get(data, h.extents[Code], p.code)
+        && get(data, h.extents[IntSets], p.int_sets)
+        && get(data, h.extents[Ints], p.int_pool.ints)
+        && get(data, h.extents[Bits], p.int_pool.bits)
+        && get(data, h.extents[Chunks], p.int_pool.chunks)
+        && get(data, h.extents[Lows], p.int_pool.lows)
+        && get(data, h.extents[Nums], p.nums)
+        && get(data, h.extents[Chars], chars)
+        && get(data, h.extents[Strs], p.strs)
+        && get(data, h.extents[StrSets], p.str_sets)
+        && get(data, h.extents[StrSlots], p.str_slots)
+        && get(data, h.extents[RuleCode], v.code)
+        && get(data, h.extents[Entries], v.entries);
+    if (!ok) return false;
+    p.chars = std::string_view(chars.data(), chars.size());
+
+    RuleIndexView x;
+    if (index) {
+        ListView<char> index_chars;
+        ok = get(data, h.extents[IndexVars], x.vars)
+            && get(data, h.extents[IndexNums], x.nums)
+            && get(data, h.extents[IndexInts], x.ints)
+            && get(data, h.extents[IndexStrs], x.strs)
+            && get(data, h.extents[IndexChars], index_chars)
+            && get(data, h.extents[IndexBounds], x.bounds)
+            && get(data, h.extents[IndexLists], x.lists)
+            && get(data, h.extents[IndexPostings], x.postings)
+            && get(data, h.extents[IndexConjuncts], x.conjuncts)
+            && get(data, h.extents[IndexAlways], x.always);
+        if (!ok) return false;
+        x.chars = std::string_view(index_chars.data(), index_chars.size());
+        x.rules = h.rules;
+        x.residuals = v;
+    }
+    std::uint64_t fp;
+    if (!fingerprint(p.code, x.vars, schema, fp) || fp != h.schema) return false;
+    if (index ? !check(x, schema) : !check(v, schema)) return false;
+    r = v;
+    if (index) *index = x;
+    return true;
+}
+
+} // image
+
+// Image of the rule set built against the schema. Empty if the rule set
+// has no image: it has extensions, or reads variables the schema lacks.
+inline std::string save_image(const RuleSetView& r, const Schema& schema) {
+    return image::save(r, nullptr, schema);
+}
+
+// same for the index, with its residual rule set
+inline std::string save_image(const RuleIndexView& x, const Schema& schema) {
+    return image::save(x.residuals, &x, schema);
+}
+
+// false if there is no image or it is not written, the file is left as is
+// in the former case
+template<typename View>
+inline bool save_image(const View& v, const Schema& schema, const std::string& path) {
+    auto data = save_image(v, schema);
+    if (data.empty()) return false;
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    f.write(data.data(), std::streamsize(data.size()));
+    return bool(f.flush());
+}
+
+// Rule set view of the image, the data must be 8-byte aligned and outlive
+// the view. Returns false if the data is not a valid image compatible with
+// the schema.
+inline bool view_image(std::string_view data, const Schema& schema, RuleSetView& r) {
+    return image::view(data, schema, image::RuleSetKind, r, nullptr);
+}
+
+// same for an index image
+inline bool view_image(std::string_view data, const Schema& schema, RuleIndexView& x) {
+    RuleSetView residuals;
+    return image::view(data, schema, image::RuleIndexKind, residuals, &x);
+}
+
+// Rule set or index image mapped from a file, shared with other
+// processes mapping the same file.
+template<typename View>
+class MappedImage {
+public:
+    MappedImage() = default;
+    MappedImage(const std::string& path, const Schema& schema) { open(path, schema); }
+
+    // false if the file can not be mapped or is not a valid image
+    // compatible with the schema
+    bool open(const std::string& path, const Schema& schema) {
+        file_ = MappedFile(path);
+        ok_ = file_.is_open() && view_image(file_.view(), schema, rules_);
+        if (!ok_) rules_ = View();
+        return ok_;
+    }
+
+    bool is_open() const { return ok_; }
+
+    const View& rules() const { return rules_; }
+
+private:
+    MappedFile file_;
+    View rules_;
+    bool ok_ = false;
+};
+
+using RuleSetImage = MappedImage<RuleSetView>;
+using RuleIndexImage = MappedImage<RuleIndexView>;
+
+} // lexen
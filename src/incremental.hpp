@@ -0,0 +1,158 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions engine - incremental rule set re-evaluation
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+#pragma once
+
+#include <algorithm>
+
+#include "rule_set.hpp"
+
+namespace lexen {
+
+// Results of a rule set for one entity, kept between its updates.
+struct RuleSetState {
+    RuleSetContext preds;               // predicate results
+    std::vector<std::uint64_t> matched; // per rule
+    std::vector<std::uint32_t> dirty;   // rules to re-run, scratch
+    std::vector<std::uint64_t> marks;   // per rule, set for dirty ones
+};
+
+/*
+ * Dependencies of a rule set: predicates reading each variable and rules
+ * reading each predicate. After eval() of an entity's record, update()
+ * with the variables that changed since re-tests only their predicates,
+ * then re-runs only the rules some predicate result of which flipped.
+ * Extension predicates may read any variable and are re-tested on every
+ * update. The rule set must outlive the dependencies.
+ */
+class RuleSetDeps {
+public:
+    RuleSetDeps() = default;
+
+    explicit RuleSetDeps(const RuleSetView& rules) : rules_(rules) {
+        auto& preds = rules.preds.code;
+        std::uint32_t vars = 0;
+        for (auto& in : preds)
+            vars = std::max(vars, std::uint32_t(in.var) + 1);
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> var_pred;
+        for (std::uint32_t i = 0; i < preds.size(); ++i) {
+            if (preds[i].op == OpCode::Ext) {
+                always_.push_back(i);
+                continue;
+            }
+            var_pred.emplace_back(std::uint32_t(preds[i].var), i);
+        }
+        invert(var_pred, vars, var_first_, var_preds_);
+
+        // predicates of each rule: instructions reachable from its entry
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> pred_rule;
+        std::vector<std::uint32_t> seen(rules.code.size(), 0), pred_seen(preds.size(), 0), stack;
+        for (std::uint32_t rule = 0; rule < rules.size(); ++rule) {
+            stack.assign(1, rules.entries[rule]);
+            while (!stack.empty()) {
+                auto pc = stack.back();
+                stack.pop_back();
+                if (pc >= Program::reject || seen[pc] == rule + 1) continue;
+                seen[pc] = rule + 1;
+                auto& in = rules.code[pc];
+                auto id = std::uint32_t(in.arg.ival);
+                if (pred_seen[id] != rule + 1) {
+                    pred_seen[id] = rule + 1;
+                    pred_rule.emplace_back(id, rule);
+                }
+                stack.push_back(in.on_true);
+                stack.push_back(in.on_false);
+            }
+        }
+        invert(pred_rule, std::uint32_t(preds.size()), pred_first_, pred_rules_);
+    }
+
+    const RuleSetView& rules() const { return rules_; }
+
+    // full evaluation, initializes the state
+    template<typename Record>
+    void eval(const Record& rec, RuleSetState& s) const {
+        std::vector<std::uint32_t> out;
+        detail::eval_rules(rules_.preds, rules_.code, rules_.entries, rec, s.preds, out);
+        s.matched.assign((rules_.size() + 63) / 64, 0);
+        s.marks.assign(s.matched.size(), 0);
+        for (auto rule : out)
+            s.matched[rule / 64] |= std::uint64_t(1) << (rule % 64);
+    }
+
+    // Re-evaluates after the variables changed in the record, flipped gets
+    // ids of the rules the result of which changed, in ascending order.
+    template<typename Record>
+    void update(const Record& rec, ListView<ast::VarIdx> vars, RuleSetState& s,
+        std::vector<std::uint32_t>& flipped) const
+    {
+        BOOST_ASSERT_MSG(s.matched.size() == (rules_.size() + 63) / 64, "state is not evaluated");
+        s.preds.keys.reset();
+        s.dirty.clear();
+        auto retest = [&] (std::uint32_t pred) {
+            if (!detail::eval_pred(rules_.preds, pred, rec, s.preds)) return;
+            for (auto i = pred_first_[pred]; i < pred_first_[pred + 1]; ++i) {
+                auto rule = pred_rules_[i];
+                auto bit = std::uint64_t(1) << (rule % 64);
+                if (s.marks[rule / 64] & bit) continue;
+                s.marks[rule / 64] |= bit;
+                s.dirty.push_back(rule);
+            }
+        };
+        for (auto var : vars) {
+            auto v = std::uint32_t(var.index);
+            if (v + 1 >= var_first_.size()) continue;
+            for (auto i = var_first_[v]; i < var_first_[v + 1]; ++i) retest(var_preds_[i]);
+        }
+        for (auto pred : always_) retest(pred);
+
+        std::sort(s.dirty.begin(), s.dirty.end());
+        flipped.clear();
+        for (auto rule : s.dirty) {
+            auto bit = std::uint64_t(1) << (rule % 64);
+            s.marks[rule / 64] &= ~bit;
+            bool r = detail::run_rule(rules_.code, rules_.entries[rule], s.preds);
+            if (r != bool(s.matched[rule / 64] & bit)) {
+                s.matched[rule / 64] ^= bit;
+                flipped.push_back(rule);
+            }
+        }
+    }
+
+    bool matched(const RuleSetState& s, std::uint32_t rule) const {
+        return s.matched[rule / 64] >> (rule % 64) & 1;
+    }
+
+    // ids of rules true for the entity, in ascending order
+    void matches(const RuleSetState& s, std::vector<std::uint32_t>& out) const {
+        out.clear();
+        for (std::uint32_t rule = 0; rule < rules_.size(); ++rule)
+            if (matched(s, rule)) out.push_back(rule);
+    }
+
+private:
+    // (key, value) pairs into values grouped by key, first has n + 1 bounds
+    static void invert(const std::vector<std::pair<std::uint32_t, std::uint32_t>>& pairs, std::uint32_t n,
+        std::vector<std::uint32_t>& first, std::vector<std::uint32_t>& values)
+    {
+        first.assign(n + 1, 0);
+        for (auto& x : pairs) ++first[x.first + 1];
+        for (std::uint32_t i = 0; i < n; ++i) first[i + 1] += first[i];
+        values.resize(pairs.size());
+        auto next = first;
+        for (auto& x : pairs) values[next[x.first]++] = x.second;
+    }
+
+    RuleSetView rules_;
+    std::vector<std::uint32_t> var_first_;      // per variable, bounds in var_preds_
+    std::vector<std::uint32_t> var_preds_;
+    std::vector<std::uint32_t> pred_first_;     // per predicate, bounds in pred_rules_
+    std::vector<std::uint32_t> pred_rules_;
+    std::vector<std::uint32_t> always_;         // extension predicates
+};
+
+} // lexen
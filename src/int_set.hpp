@@ -0,0 +1,176 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions engine - compressed integer sets
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "list_view.hpp"
+
+namespace lexen {
+
+// Representation of an integer literal set, chosen by its density:
+// sorted array for small sparse sets, bitset over [min, max] for dense
+// ones, and roaring-style chunks of 2^16 values for large sparse sets,
+// every chunk being an array of low 16 bits or a bitset itself.
+enum class IntSetKind : std::uint8_t { Array, Bitset, Chunks };
+
+struct IntSet {
+    IntSetKind kind;
+    std::uint32_t size;     // number of elements
+    std::uint32_t offset;   // ints for array, bits for bitset, chunks for chunks
+    std::uint32_t count;    // number of chunks, unused otherwise
+    std::int32_t min;
+    std::int32_t max;
+};
+
+struct IntChunk {
+    std::int32_t key;       // value >> 16
+    std::uint32_t offset;   // lows for array chunk, bits for bitset chunk
+    std::uint32_t size;     // number of elements
+};
+
+// Storage of integer sets of a program in sequences of type Seq: vectors
+// while the program is built, views of a mapped program image.
+template<template<typename...> class Seq>
+struct BasicIntPool {
+    static constexpr std::uint32_t chunk_bits = 1 << 16;
+    // array chunks with more elements are bitsets
+    static constexpr std::uint32_t max_array_chunk = chunk_bits / 16;
+    // sets of less elements are never chunked
+    static constexpr std::uint32_t min_chunked = 1024;
+
+    Seq<int> ints;
+    Seq<std::uint64_t> bits;
+    Seq<IntChunk> chunks;
+    Seq<std::uint16_t> lows;
+
+    bool has(const IntSet& s, int x) const {
+        if (x < s.min || x > s.max) return false;
+        switch (s.kind) {
+        case IntSetKind::Array:
+            return find(ints.data() + s.offset, s.size, x);
+        case IntSetKind::Bitset:
+            return bit(s.offset, std::uint64_t(std::int64_t(x) - s.min));
+        case IntSetKind::Chunks: {
+            auto first = chunks.data() + s.offset;
+            auto last = first + s.count;
+            auto c = std::lower_bound(first, last, x >> 16,
+                [] (const IntChunk& a, int key) { return a.key < key; });
+            if (c == last || c->key != x >> 16) return false;
+            if (c->size > max_array_chunk) return bit(c->offset, x & 0xFFFF);
+            return find(lows.data() + c->offset, c->size, std::uint16_t(x & 0xFFFF));
+        }
+        }
+        return false;
+    }
+
+    // calls f with every element in ascending order while it returns true
+    template<typename F>
+    bool every(const IntSet& s, F f) const {
+        switch (s.kind) {
+        case IntSetKind::Array:
+            for (std::uint32_t i = 0; i < s.size; ++i)
+                if (!f(ints[s.offset + i])) return false;
+            return true;
+        case IntSetKind::Bitset:
+            return every_bit(s.offset, std::uint64_t(std::int64_t(s.max) - s.min) + 1, s.min, f);
+        case IntSetKind::Chunks:
+            for (std::uint32_t i = 0; i < s.count; ++i) {
+                auto& c = chunks[s.offset + i];
+                auto base = std::int64_t(c.key) * chunk_bits;
+                if (c.size > max_array_chunk) {
+                    if (!every_bit(c.offset, chunk_bits, base, f)) return false;
+                } else {
+                    for (std::uint32_t j = 0; j < c.size; ++j)
+                        if (!f(int(base + lows[c.offset + j]))) return false;
+                }
+            }
+            return true;
+        }
+        return true;
+    }
+
+protected:
+    // branchless binary search
+    template<typename T>
+    static bool find(const T* base, std::uint32_t n, T x) {
+        if (n == 0) return false;
+        while (n > 1) {
+            auto half = n / 2;
+            base = base[half] <= x ? base + half : base;
+            n -= half;
+        }
+        return *base == x;
+    }
+
+    bool bit(std::uint32_t offset, std::uint64_t i) const {
+        return bits[offset + i / 64] >> (i % 64) & 1;
+    }
+
+    template<typename F>
+    bool every_bit(std::uint32_t offset, std::uint64_t span, std::int64_t base, F& f) const {
+        for (std::uint64_t w = 0; w < (span + 63) / 64; ++w)
+            for (auto m = bits[offset + w]; m; m &= m - 1)
+                if (!f(int(base + std::int64_t(w * 64 + __builtin_ctzll(m))))) return false;
+        return true;
+    }
+};
+
+struct IntPool : BasicIntPool<std::vector> {
+    // adds sorted unique set
+    IntSet add(const std::vector<int>& set) {
+        IntSet r{IntSetKind::Array, std::uint32_t(set.size()), 0, 0, 0, -1};
+        if (set.empty()) return r;
+        r.min = set.front();
+        r.max = set.back();
+        auto span = std::uint64_t(std::int64_t(r.max) - r.min) + 1;
+        // bitset takes no more than 32 bits per element
+        if (span <= 32 * std::uint64_t(set.size())) {
+            r.kind = IntSetKind::Bitset;
+            r.offset = add_bits(set.begin(), set.end(), r.min, span);
+        } else if (set.size() >= min_chunked) {
+            r.kind = IntSetKind::Chunks;
+            r.offset = std::uint32_t(chunks.size());
+            for (auto it = set.begin(); it != set.end(); ) {
+                auto key = *it >> 16;
+                auto end = std::find_if(it, set.end(), [key] (int x) { return x >> 16 != key; });
+                auto n = std::uint32_t(end - it);
+                if (n > max_array_chunk) {
+                    chunks.push_back(IntChunk{key, add_bits(it, end, key * std::int64_t(chunk_bits), chunk_bits), n});
+                } else {
+                    chunks.push_back(IntChunk{key, std::uint32_t(lows.size()), n});
+                    for (; it != end; ++it) lows.push_back(std::uint16_t(*it & 0xFFFF));
+                }
+                it = end;
+                ++r.count;
+            }
+        } else {
+            r.offset = std::uint32_t(ints.size());
+            ints.insert(ints.end(), set.begin(), set.end());
+        }
+        return r;
+    }
+
+private:
+    template<typename It>
+    std::uint32_t add_bits(It first, It last, std::int64_t base, std::uint64_t span) {
+        auto offset = std::uint32_t(bits.size());
+        bits.resize(bits.size() + (span + 63) / 64, 0);
+        for (; first != last; ++first) {
+            auto i = std::uint64_t(*first - base);
+            bits[offset + i / 64] |= std::uint64_t(1) << (i % 64);
+        }
+        return offset;
+    }
+};
+
+using IntPoolView = BasicIntPool<ListView>;
+
+} // lexen
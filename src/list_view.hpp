@@ -0,0 +1,35 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions engine - read-only array view
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace lexen {
+
+// read-only view of a list value or a pool, the data is owned by the caller
+template<typename T>
+class ListView {
+public:
+    ListView() : data_(nullptr), size_(0) {}
+    ListView(const T* data, std::size_t size) : data_(data), size_(size) {}
+    ListView(const std::vector<T>& v) : data_(v.data()), size_(v.size()) {}
+
+    const T* begin() const { return data_; }
+    const T* end() const { return data_ + size_; }
+    const T* data() const { return data_; }
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const T& operator[](std::size_t i) const { return data_[i]; }
+
+private:
+    const T* data_;
+    std::size_t size_;
+};
+
+} // lexen
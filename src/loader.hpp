@@ -0,0 +1,138 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions engine - parallel bulk rule loading
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "be.hpp"
+#include "mapped_file.hpp"
+#include "program.hpp"
+#include "schema.hpp"
+#include "thread_pool.hpp"
+
+namespace lexen {
+
+// rule of a rule file, line numbers start at 1
+struct LoadedRule {
+    std::string id;             // empty if the line has no id
+    std::uint32_t line;
+    ast::Expression expr;
+    Program prog;
+};
+
+// Line that does not parse. Column (from 1) is just past the longest
+// prefix of the expression that parses, not the exact error position,
+// which is there or further right.
+struct LoadError {
+    std::uint32_t line;
+    std::uint32_t column;
+};
+
+struct RuleFile {
+    std::vector<LoadedRule> rules;      // in order of lines
+    std::vector<LoadError> errors;      // in order of lines
+};
+
+namespace detail {
+
+// rules of the whole lines of the text, line numbers relative to its
+// start; lines gets the number of lines
+inline void load_lines(std::string_view text, const Schema& schema, RuleFile& out, std::uint32_t& lines) {
+    lines = 0;
+    std::string src;
+    while (!text.empty()) {
+        auto eol = text.find('\n');
+        auto line = text.substr(0, eol);
+        text.remove_prefix(eol == std::string_view::npos ? text.size() : eol + 1);
+        ++lines;
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.find_first_not_of(" \t") == std::string_view::npos) continue;
+
+        LoadedRule r;
+        r.line = lines;
+        std::size_t at = 0;
+        auto end = line.find_first_of(" \t\v\f\r");
+        if (end != 0 && end != std::string_view::npos && line[end] == '\t') {
+            r.id = std::string(line.substr(0, end));
+            at = end + 1;
+        }
+        src.assign(line.substr(at));
+        std::size_t pos;
+        if (!parse_str(src, r.expr, schema, pos)) {
+            out.errors.push_back(LoadError{lines, std::uint32_t(at + pos + 1)});
+            continue;
+        }
+        r.prog = compile(r.expr);
+        out.rules.push_back(std::move(r));
+    }
+}
+
+} // detail
+
+/*
+ * Parses and compiles rules of the text, one expression per line,
+ * optionally preceded by its id: the first token of a line followed by a
+ * tab, with no whitespace before it or in it. Expressions may contain
+ * tabs anywhere else; blank lines are skipped. The
+ * text is split at line boundaries into chunks parsed in parallel on the
+ * pool. The schema must not change during loading. An exception of
+ * parsing or compiling a chunk is rethrown once chunks already started
+ * are done.
+ */
+inline RuleFile load_rules(std::string_view text, const Schema& schema, ThreadPool& pool) {
+    // several chunks per thread to even out lines of different length
+    auto chunks = std::max<std::size_t>(1, std::min<std::size_t>(pool.size() * 4, text.size() / 4096));
+    std::vector<std::string_view> parts;
+    while (!text.empty()) {
+        auto n = std::min(text.size(), text.size() / chunks + 1);
+        auto eol = text.find('\n', n - 1);
+        n = eol == std::string_view::npos ? text.size() : eol + 1;
+        parts.push_back(text.substr(0, n));
+        text.remove_prefix(n);
+        if (chunks > 1) --chunks;
+    }
+
+    std::vector<RuleFile> files(parts.size());
+    std::vector<std::uint32_t> lines(parts.size());
+    parallel_for(pool, parts.size(), [&] (std::size_t i) {
+        detail::load_lines(parts[i], schema, files[i], lines[i]);
+    });
+
+    RuleFile out;
+    std::uint32_t base = 0;
+    for (std::size_t i = 0; i < parts.size(); ++i) {
+        for (auto& r : files[i].rules) {
+            r.line += base;
+            out.rules.push_back(std::move(r));
+        }
+        for (auto& e : files[i].errors) {
+            e.line += base;
+            out.errors.push_back(e);
+        }
+        base += lines[i];
+    }
+    return out;
+}
+
+inline RuleFile load_rules(std::string_view text, const Schema& schema) {
+    ThreadPool pool;
+    return load_rules(text, schema, pool);
+}
+
+// rules of the memory mapped file, false if it can not be read
+inline bool load_rules(const std::string& path, const Schema& schema, ThreadPool& pool, RuleFile& out) {
+    MappedFile file(path);
+    if (!file.is_open()) return false;
+    out = load_rules(file.view(), schema, pool);
+    return true;
+}
+
+} // lexen
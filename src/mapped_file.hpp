@@ -0,0 +1,75 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions engine - read-only memory mapped file
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace lexen {
+
+// Whole file mapped for reading, pages are shared with other processes
+// mapping the same file. is_open() is false if the file cannot be mapped.
+class MappedFile {
+public:
+    MappedFile() = default;
+
+    explicit MappedFile(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (::fstat(fd, &st) == 0) {
+            size_ = std::size_t(st.st_size);
+            if (size_ == 0) {
+                open_ = true;
+            } else {
+                void* p = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+                if (p != MAP_FAILED) {
+                    data_ = static_cast<const char*>(p);
+                    open_ = true;
+                }
+            }
+        }
+        ::close(fd);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& x) noexcept { swap(x); }
+    MappedFile& operator=(MappedFile&& x) noexcept {
+        swap(x);
+        return *this;
+    }
+
+    ~MappedFile() {
+        if (data_) ::munmap(const_cast<char*>(data_), size_);
+    }
+
+    bool is_open() const { return open_; }
+    const char* data() const { return data_; }
+    std::size_t size() const { return size_; }
+    std::string_view view() const { return std::string_view(data_, size_); }
+
+private:
+    void swap(MappedFile& x) {
+        std::swap(data_, x.data_);
+        std::swap(size_, x.size_);
+        std::swap(open_, x.open_);
+    }
+
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+    bool open_ = false;
+};
+
+} // lexen
@@ -0,0 +1,531 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions engine - logical optimizer
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <unordered_set>
+#include <vector>
+
+#include "ast_hash.hpp"
+#include "program.hpp"
+#include "schema.hpp"
+
+namespace lexen {
+
+namespace x3 = boost::spirit::x3;
+
+namespace detail {
+
+struct expr_ptr_hash {
+    std::size_t operator()(const ast::Expression* e) const { return boost::hash<ast::Expression>()(*e); }
+};
+
+struct expr_ptr_eq {
+    bool operator()(const ast::Expression* a, const ast::Expression* b) const { return *a == *b; }
+};
+
+using ExprPtrSet = std::unordered_set<const ast::Expression*, expr_ptr_hash, expr_ptr_eq>;
+
+inline ast::CompOp negate(ast::CompOp op) {
+    switch (op) {
+    case ast::CompOp::Gt: return ast::CompOp::Le;
+    case ast::CompOp::Ge: return ast::CompOp::Lt;
+    case ast::CompOp::Lt: return ast::CompOp::Ge;
+    case ast::CompOp::Le: return ast::CompOp::Gt;
+    case ast::CompOp::Eq: return ast::CompOp::Ne;
+    case ast::CompOp::Ne: return ast::CompOp::Eq;
+    }
+    BOOST_ASSERT_MSG(false, "can't negate unsupported op");
+    return op;
+}
+
+inline ast::SetOp negate(ast::SetOp op) {
+    return op == ast::SetOp::In ? ast::SetOp::NotIn : ast::SetOp::In;
+}
+
+inline double num(const ast::NumVal& v) {
+    return boost::apply_visitor([] (auto x) { return double(x); }, v);
+}
+
+inline ast::NumVal num_val(double x) {
+    if (x >= INT_MIN && x <= INT_MAX && double(int(x)) == x) return ast::NumVal(int(x));
+    return ast::NumVal(x);
+}
+
+// Per variable fusion of and/or items: comparisons and set membership
+// tests of one variable are merged into a single range, a single set
+// test, or constant false when they contradict each other. Items of
+// other kinds are left as is.
+class Fuser {
+public:
+    Fuser(const Schema& schema, bool all) : schema_(schema), all_(all) {}
+
+    // returns false when and of the items can't be true
+    bool run(std::vector<ast::Expression>& items) {
+        std::vector<int> owner(items.size(), -1);
+        for (std::size_t i = 0; i < items.size(); ++i) owner[i] = add(items[i], i);
+
+        std::vector<ast::Expression> out;
+        for (std::size_t i = 0; i < items.size(); ++i) {
+            if (owner[i] < 0) {
+                out.push_back(std::move(items[i]));
+            } else if (owner[i] & 1) {
+                auto& d = strs_[owner[i] >> 1];
+                if (d.count == 1) out.push_back(std::move(items[i]));
+                else if (d.first == i && !emit(d, out)) return false;
+            } else {
+                auto& d = nums_[owner[i] >> 1];
+                if (d.count == 1) out.push_back(std::move(items[i]));
+                else if (d.first == i && !emit(d, out)) return false;
+            }
+        }
+        items.swap(out);
+        return true;
+    }
+
+private:
+    struct Bound {
+        double val;
+        bool strict;
+        const ast::NumComp* src;
+    };
+
+    template<typename V>
+    struct Domain {
+        ast::VarIdx var;
+        std::size_t first;          // position of the first item
+        std::size_t count = 0;      // number of items
+        bool has_points = false;
+        std::vector<V> points;      // sorted, values the variable may take
+        std::vector<V> excluded;    // sorted, values it may not (and only)
+        Bound bounds[2];            // lower and upper, numeric only
+        bool has[2] = {false, false};
+
+        const Bound* lo() const { return has[0] ? &bounds[0] : nullptr; }
+        const Bound* hi() const { return has[1] ? &bounds[1] : nullptr; }
+    };
+
+    static std::vector<double> nums(const std::vector<int>& set) {
+        return std::vector<double>(set.begin(), set.end());
+    }
+
+    template<typename V>
+    static std::vector<V> sorted(std::vector<V> v) {
+        std::sort(v.begin(), v.end());
+        v.erase(std::unique(v.begin(), v.end()), v.end());
+        return v;
+    }
+
+    // returns id of the domain the item belongs to, or -1
+    int add(const ast::Expression& e, std::size_t pos) {
+        if (auto x = boost::get<ast::NumComp>(&e.get())) {
+            if (x->cmp == ast::CompOp::Ne && !all_) return -1;
+            auto id = domain(nums_, num_ids_, x->var, pos, 0);
+            auto& d = nums_[id >> 1];
+            auto v = num(x->val);
+            switch (x->cmp) {
+            case ast::CompOp::Eq: point(d, {v}); break;
+            case ast::CompOp::Ne: exclude(d, {v}); break;
+            default: bound(d, *x, v); break;
+            }
+            return id;
+        }
+        if (auto x = boost::get<ast::StrComp>(&e.get())) {
+            if (x->cmp == ast::CompOp::Ne && !all_) return -1;
+            auto id = domain(strs_, str_ids_, x->var, pos, 1);
+            if (x->cmp == ast::CompOp::Eq) point(strs_[id >> 1], {x->val});
+            else exclude(strs_[id >> 1], {x->val});
+            return id;
+        }
+        auto s = boost::get<ast::SetExpr>(&e.get());
+        if (!s) return -1;
+        if (auto x = boost::get<ast::VarInSet<int>>(&s->get())) {
+            if (x->op == ast::SetOp::NotIn && !all_) return -1;
+            auto id = domain(nums_, num_ids_, x->var, pos, 0);
+            if (x->op == ast::SetOp::In) point(nums_[id >> 1], sorted(nums(x->set)));
+            else exclude(nums_[id >> 1], sorted(nums(x->set)));
+            return id;
+        }
+        if (auto x = boost::get<ast::VarInSet<std::string>>(&s->get())) {
+            if (x->op == ast::SetOp::NotIn && !all_) return -1;
+            auto id = domain(strs_, str_ids_, x->var, pos, 1);
+            if (x->op == ast::SetOp::In) point(strs_[id >> 1], sorted(x->set));
+            else exclude(strs_[id >> 1], sorted(x->set));
+            return id;
+        }
+        return -1;
+    }
+
+    template<typename D>
+    static int domain(std::vector<D>& ds, std::unordered_map<int, int>& ids, ast::VarIdx var,
+        std::size_t pos, int tag)
+    {
+        auto it = ids.emplace(var.index, int(ds.size())).first;
+        if (it->second == int(ds.size())) {
+            ds.emplace_back();
+            ds.back().var = var;
+            ds.back().first = pos;
+        }
+        ++ds[it->second].count;
+        return it->second << 1 | tag;
+    }
+
+    // and: intersection of allowed values, or: union
+    template<typename V>
+    void point(Domain<V>& d, const std::vector<V>& set) const {
+        std::vector<V> r;
+        if (!d.has_points) r = set;
+        else if (all_) std::set_intersection(d.points.begin(), d.points.end(), set.begin(), set.end(), std::back_inserter(r));
+        else std::set_union(d.points.begin(), d.points.end(), set.begin(), set.end(), std::back_inserter(r));
+        d.points.swap(r);
+        d.has_points = true;
+    }
+
+    template<typename V>
+    static void exclude(Domain<V>& d, const std::vector<V>& set) {
+        std::vector<V> r;
+        std::set_union(d.excluded.begin(), d.excluded.end(), set.begin(), set.end(), std::back_inserter(r));
+        d.excluded.swap(r);
+    }
+
+    // and keeps the tighter bound, or the weaker one
+    void bound(Domain<double>& d, const ast::NumComp& x, double v) const {
+        bool lower = is_lower(x.cmp);
+        bool strict = x.cmp == ast::CompOp::Gt || x.cmp == ast::CompOp::Lt;
+        auto& cur = d.bounds[lower ? 0 : 1];
+        auto& has = d.has[lower ? 0 : 1];
+        if (has) {
+            bool tighter = v == cur.val ? strict && !cur.strict : lower == (v > cur.val);
+            bool weaker = v == cur.val ? !strict && cur.strict : !tighter;
+            if (!(all_ ? tighter : weaker)) return;
+        }
+        cur = Bound{v, strict, &x};
+        has = true;
+    }
+
+    static bool within(const Bound* lo, const Bound* hi, double x) {
+        if (lo && !(lo->strict ? x > lo->val : x >= lo->val)) return false;
+        if (hi && !(hi->strict ? x < hi->val : x <= hi->val)) return false;
+        return true;
+    }
+
+    bool integer(ast::VarIdx var) const {
+        return schema_.has(var) && schema_.type(var) == var_type::integer;
+    }
+
+    // values an integer variable can take
+    static std::vector<int> ints(const std::vector<double>& set) {
+        std::vector<int> r;
+        for (auto x : set)
+            if (x >= INT_MIN && x <= INT_MAX && double(int(x)) == x) r.push_back(int(x));
+        return r;
+    }
+
+    bool emit(Domain<double>& d, std::vector<ast::Expression>& out) const {
+        auto comp = [&d] (double x, ast::CompOp op) { return ast::Expression(ast::NumComp{d.var, num_val(x), op}); };
+        auto lo = d.lo(), hi = d.hi();
+        bool is_int = integer(d.var);
+        if (all_) {
+            // x >= 3 and x <= 3 is x = 3
+            if (!d.has_points && lo && hi && lo->val == hi->val && !lo->strict && !hi->strict)
+                point(d, {lo->val});
+            if (d.has_points) {
+                std::vector<double> r;
+                for (auto x : d.points)
+                    if (within(lo, hi, x) && !std::binary_search(d.excluded.begin(), d.excluded.end(), x))
+                        r.push_back(x);
+                if (is_int) r = nums(ints(r));
+                if (r.empty()) return false;
+                if (r.size() == 1) out.push_back(comp(r[0], ast::CompOp::Eq));
+                else out.push_back(ast::Expression(ast::SetExpr(ast::VarInSet<int>(d.var, ast::SetOp::In, ints(r)))));
+                return true;
+            }
+            // bounds of a range are kept together, see detail::is_range()
+            if (lo && hi && lo->val >= hi->val) return false;
+            if (lo && hi) {
+                ast::Conjunction range{{ast::Expression(*lo->src), ast::Expression(*hi->src)}};
+                out.push_back(ast::Expression(range));
+            } else if (lo || hi) {
+                out.push_back(ast::Expression(*(lo ? lo : hi)->src));
+            }
+            std::vector<double> r;
+            for (auto x : d.excluded)
+                if (within(lo, hi, x)) r.push_back(x);
+            if (!is_int) {
+                for (auto x : r) out.push_back(comp(x, ast::CompOp::Ne));
+            } else if (auto set = ints(r); set.size() == 1) {
+                out.push_back(comp(set[0], ast::CompOp::Ne));
+            } else if (set.size() > 1) {
+                out.push_back(ast::Expression(ast::SetExpr(ast::VarInSet<int>(d.var, ast::SetOp::NotIn, set))));
+            } else if (!lo && !hi && !r.empty()) {
+                // integer x <> 5.5 holds for any value, but not for null
+                out.push_back(comp(r[0], ast::CompOp::Ne));
+            }
+            return true;
+        }
+        // points within bounds are covered by them
+        if (lo) out.push_back(ast::Expression(*lo->src));
+        if (hi) out.push_back(ast::Expression(*hi->src));
+        std::vector<double> r;
+        for (auto x : d.points)
+            if (!(lo && within(lo, nullptr, x)) && !(hi && within(nullptr, hi, x))) r.push_back(x);
+        if (!is_int) {
+            for (auto x : r) out.push_back(comp(x, ast::CompOp::Eq));
+        } else if (auto set = ints(r); set.size() == 1) {
+            out.push_back(comp(set[0], ast::CompOp::Eq));
+        } else if (set.size() > 1) {
+            out.push_back(ast::Expression(ast::SetExpr(ast::VarInSet<int>(d.var, ast::SetOp::In, set))));
+        }
+        return true;
+    }
+
+    bool emit(const Domain<std::string>& d, std::vector<ast::Expression>& out) const {
+        auto set = [&d, &out] (const std::vector<std::string>& v, bool in) {
+            if (v.size() == 1)
+                out.push_back(ast::Expression(ast::StrComp{d.var, v[0], in ? ast::CompOp::Eq : ast::CompOp::Ne}));
+            else if (v.size() > 1)
+                out.push_back(ast::Expression(ast::SetExpr(
+                    ast::VarInSet<std::string>(d.var, in ? ast::SetOp::In : ast::SetOp::NotIn, v))));
+        };
+        if (all_ && d.has_points) {
+            std::vector<std::string> r;
+            std::set_difference(d.points.begin(), d.points.end(), d.excluded.begin(), d.excluded.end(),
+                std::back_inserter(r));
+            if (r.empty()) return false;
+            set(r, true);
+        } else {
+            set(d.points, true);
+            set(d.excluded, false);
+        }
+        return true;
+    }
+
+    const Schema& schema_;
+    bool all_;
+    std::vector<Domain<double>> nums_;
+    std::vector<Domain<std::string>> strs_;
+    std::unordered_map<int, int> num_ids_;
+    std::unordered_map<int, int> str_ids_;
+};
+
+// Rewrites expression (negated if neg is set) into negation normal form:
+// constants folded, nested and/or flattened, duplicates and absorbed
+// items removed. Negation is left only above leaves having no negated
+// form: boolean variables, "is empty", "all of", extensions, and order
+// comparisons of variables not known to be integer, since "not x > 3"
+// is true for NaN while "x <= 3" is not.
+// Every rewrite holds in Kleene logic, so the result is equivalent to the
+// source both for null-is-false and three-valued evaluation.
+class Optimizer : public boost::static_visitor<ast::Expression> {
+public:
+    Optimizer(bool neg, const Schema& schema, bool fuse = false) : neg_(neg), schema_(schema), fuse_(fuse) {}
+
+    ast::Expression operator()(const ast::BoolVal& x) const {
+        return ast::Expression(ast::BoolVal(x.value != neg_));
+    }
+
+    ast::Expression operator()(const ast::VarIdx& x) const {
+        return keep(x);
+    }
+
+    ast::Expression operator()(const ast::NumComp& x) const {
+        if (!neg_) return ast::Expression(x);
+        bool ordered = x.cmp != ast::CompOp::Eq && x.cmp != ast::CompOp::Ne;
+        if (ordered && !integer(x.var)) return keep(x);
+        auto r = x;
+        r.cmp = negate(x.cmp);
+        return ast::Expression(r);
+    }
+
+    ast::Expression operator()(const ast::StrComp& x) const {
+        auto r = x;
+        if (neg_) r.cmp = negate(x.cmp);
+        return ast::Expression(r);
+    }
+
+    ast::Expression operator()(const ast::UnaryExpr& x) const {
+        if (!neg_) return ast::Expression(x);
+        switch (x.op) {
+        case ast::UnaryOp::IsNull:    return ast::Expression(ast::UnaryExpr{ast::UnaryOp::IsNotNull, x.var});
+        case ast::UnaryOp::IsNotNull: return ast::Expression(ast::UnaryExpr{ast::UnaryOp::IsNull, x.var});
+        case ast::UnaryOp::IsEmpty:   break;
+        }
+        return keep(x);
+    }
+
+    ast::Expression operator()(const ast::SetExpr& x) const {
+        return boost::apply_visitor(*this, x);
+    }
+
+    template<typename T>
+    ast::Expression operator()(const ast::ValInSet<T>& x) const {
+        auto r = x;
+        if (neg_) r.op = negate(x.op);
+        return ast::Expression(ast::SetExpr(r));
+    }
+
+    template<typename T>
+    ast::Expression operator()(const ast::VarInSet<T>& x) const {
+        auto r = x;
+        if (neg_) r.op = negate(x.op);
+        return ast::Expression(ast::SetExpr(r));
+    }
+
+    ast::Expression operator()(const ast::ListExpr& x) const {
+        return boost::apply_visitor(*this, x);
+    }
+
+    // "none of" is "not one of", "all of" has no negated form
+    template<typename T>
+    ast::Expression operator()(const ast::VarVsSet<T>& x) const {
+        if (!neg_) return ast::Expression(ast::ListExpr(x));
+        auto r = x;
+        switch (x.op) {
+        case ast::ListOp::OneOf:  r.op = ast::ListOp::NoneOf; break;
+        case ast::ListOp::NoneOf: r.op = ast::ListOp::OneOf; break;
+        case ast::ListOp::AllOf:  return keep(ast::ListExpr(x));
+        }
+        return ast::Expression(ast::ListExpr(r));
+    }
+
+#ifdef PREDICATE_EXTENSION_AST_TYPE
+    ast::Expression operator()(const PREDICATE_EXTENSION_AST_TYPE& x) const {
+        return keep(x);
+    }
+#endif
+
+    // not (a and b) = not a or not b
+    ast::Expression operator()(const x3::forward_ast<ast::Conjunction>& x) const {
+        return join(!neg_, x.get().items);
+    }
+
+    // not (a or b) = not a and not b
+    ast::Expression operator()(const x3::forward_ast<ast::Disjunction>& x) const {
+        return join(neg_, x.get().items);
+    }
+
+    ast::Expression operator()(const x3::forward_ast<ast::Negation>& x) const {
+        return boost::apply_visitor(Optimizer(!neg_, schema_, fuse_), x.get().expr);
+    }
+
+private:
+    bool integer(ast::VarIdx var) const {
+        return schema_.has(var) && schema_.type(var) == var_type::integer;
+    }
+
+    template<typename T>
+    ast::Expression keep(const T& x) const {
+        if (neg_) return ast::Expression(ast::Negation{ast::Expression(x)});
+        return ast::Expression(x);
+    }
+
+    // items of and (all is set) or or (all is cleared), null otherwise
+    static std::vector<ast::Expression>* items(ast::Expression& e, bool all) {
+        if (all) {
+            if (auto c = boost::get<x3::forward_ast<ast::Conjunction>>(&e.get())) return &c->get().items;
+        } else {
+            if (auto d = boost::get<x3::forward_ast<ast::Disjunction>>(&e.get())) return &d->get().items;
+        }
+        return nullptr;
+    }
+
+    static bool contains(const std::vector<ast::Expression>& set, const std::vector<ast::Expression>& sub) {
+        for (auto& x : sub)
+            if (std::find(set.begin(), set.end(), x) == set.end()) return false;
+        return true;
+    }
+
+    // and of the items when all is set, or of the items otherwise
+    ast::Expression join(bool all, const std::vector<ast::Expression>& src) const {
+        // fold constants and flatten; optimized items are flat already
+        std::vector<ast::Expression> flat;
+        for (auto& item : src) {
+            auto x = boost::apply_visitor(*this, item);
+            if (auto b = boost::get<ast::BoolVal>(&x.get())) {
+                if (b->value != all) return ast::Expression(*b);
+                continue;
+            }
+            if (auto sub = items(x, all)) {
+                for (auto& y : *sub) flat.push_back(std::move(y));
+            } else {
+                flat.push_back(std::move(x));
+            }
+        }
+
+        if (fuse_ && !Fuser(schema_, all).run(flat))
+            return ast::Expression(ast::BoolVal(false));
+
+        // a and a = a
+        std::vector<ast::Expression> uniq;
+        uniq.reserve(flat.size());
+        ExprPtrSet seen;
+        for (auto& x : flat) {
+            if (seen.count(&x)) continue;
+            uniq.push_back(std::move(x));
+            seen.insert(&uniq.back());
+        }
+
+        // a and (a or b) = a, (a or b) and (a or b or c) = a or b; of equal
+        // items the first one is kept
+        std::vector<bool> drop(uniq.size(), false);
+        for (std::size_t i = 0; i < uniq.size(); ++i) {
+            auto sub = items(uniq[i], !all);
+            if (!sub) continue;
+            for (auto& y : *sub) {
+                if (seen.count(&y)) {
+                    drop[i] = true;
+                    break;
+                }
+            }
+        }
+        for (std::size_t i = 0; i < uniq.size(); ++i) {
+            auto sub = items(uniq[i], !all);
+            if (drop[i] || !sub) continue;
+            for (std::size_t j = 0; j < uniq.size() && !drop[i]; ++j) {
+                auto other = items(uniq[j], !all);
+                if (j == i || drop[j] || !other || (other->size() == sub->size() && j > i)) continue;
+                if (contains(*sub, *other)) drop[i] = true;
+            }
+        }
+
+        std::vector<ast::Expression> out;
+        for (std::size_t i = 0; i < uniq.size(); ++i)
+            if (!drop[i]) out.push_back(std::move(uniq[i]));
+
+        if (out.empty()) return ast::Expression(ast::BoolVal(all));
+        if (out.size() == 1) return std::move(out[0]);
+        if (all) return ast::Expression(ast::Conjunction{std::move(out)});
+        return ast::Expression(ast::Disjunction{std::move(out)});
+    }
+
+    bool neg_;
+    const Schema& schema_;
+    bool fuse_;  // fuse domains if set
+};
+
+} // detail
+
+// Logical simplification of a parsed expression, see detail::Optimizer.
+// Compiled programs of the result have no more instructions than ones of
+// the source, usually less. The schema, the one the expression was parsed
+// with, tells integer variables, whose order comparisons are negated in
+// place.
+inline ast::Expression optimize(const ast::Expression& e, const Schema& schema) {
+    return boost::apply_visitor(detail::Optimizer(false, schema), e);
+}
+
+// optimize() with per variable fusion of comparisons, see detail::Fuser.
+// Contradicting comparisons of a variable fold into false even though
+// they are unknown for null variable, so the result accepts the same
+// records, but three-valued evaluation may give false instead of unknown.
+inline ast::Expression fuse(const ast::Expression& e, const Schema& schema) {
+    return boost::apply_visitor(detail::Optimizer(false, schema, true), e);
+}
+
+} // lexen
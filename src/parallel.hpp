@@ -0,0 +1,186 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions engine - multi-core batch evaluation
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "batch.hpp"
+#include "thread_pool.hpp"
+
+namespace lexen {
+
+/*
+ * Evaluation of large batches on all workers of a thread pool. A batch is
+ * split into morsels of morsel_rows() rows, a multiple of 64, and each is
+ * evaluated as a slice of the batch with scratch space of its worker, so
+ * memory used is bounded by morsel size times workers, not by the batch.
+ *
+ * Morsels are scheduled by work stealing: each worker starts with an equal
+ * run of consecutive morsels and takes them from the front; a worker out
+ * of morsels takes the back half of the longest run left. Workers are run
+ * by parallel_run(), so the calling thread is one of them, and it is safe
+ * to evaluate from a task of the same pool.
+ * Morsels write disjoint words of the result, so results come out in row
+ * order without a merge step.
+ *
+ * Settings of the context given, the sparse fraction and the extension
+ * result cache, which is shared, apply to every worker.
+ *
+ * One evaluation at a time per object.
+ */
+class ParallelEval {
+public:
+    explicit ParallelEval(ThreadPool& pool, std::size_t morsel_rows = 16384,
+        const BatchContext& ctx = BatchContext())
+        : pool_(pool)
+        , morsel_(std::max<std::size_t>(64, (morsel_rows + 63) / 64 * 64))
+        , ctx_(pool.size() + 1, settings(ctx)) {}
+
+    std::size_t morsel_rows() const { return morsel_; }
+
+    // bitmap of rows where the expression is true, same as eval()
+    template<typename P>
+    Bitmap eval(const P& p, const Batch& b) {
+        Bitmap result(simd::words(b.rows()), 0);
+        eval(p, b, result.data(), nullptr);
+        return result;
+    }
+
+    // ids of rows where the expression is true, in ascending order
+    template<typename P>
+    void select(const P& p, const Batch& b, std::vector<std::uint32_t>& rows) {
+        BOOST_ASSERT_MSG(b.rows() <= 0xFFFFFFFF, "row ids exceed 32 bits");
+        Bitmap bits(simd::words(b.rows()), 0);
+        auto n = morsels(b);
+        std::vector<std::size_t> first(n + 1, 0);
+        eval(p, b, bits.data(), first.data() + 1);
+        for (std::size_t m = 0; m < n; ++m) first[m + 1] += first[m];
+        rows.resize(first[n]);
+        auto words = morsel_ / 64;
+        run(n, [&] (unsigned, std::size_t m) {
+            auto out = rows.data() + first[m];
+            auto hi = std::min(bits.size(), (m + 1) * words);
+            for (auto i = m * words; i < hi; ++i)
+                for (auto x = bits[i]; x; x &= x - 1)
+                    *out++ = std::uint32_t(i * 64 + simd::ctz(x));
+        });
+    }
+
+    // Evaluates batches returned by source() as pointers, until null, and
+    // passes each with its result to sink(batch, bitmap) in order. The
+    // next batch is requested only when the sink returns, so a slow
+    // consumer holds the producer back and one batch is in flight.
+    template<typename P, typename Source, typename Sink>
+    void eval_stream(const P& p, Source&& source, Sink&& sink) {
+        while (const Batch* b = source()) sink(*b, eval(p, *b));
+    }
+
+private:
+    // morsels [first, end) not taken yet, both packed in one word
+    struct alignas(64) Run {
+        std::atomic<std::uint64_t> span{0};
+    };
+
+    static std::uint64_t pack(std::uint32_t first, std::uint32_t end) {
+        return std::uint64_t(end) << 32 | first;
+    }
+    static std::uint32_t left(std::uint64_t span) {
+        auto first = std::uint32_t(span), end = std::uint32_t(span >> 32);
+        return first < end ? end - first : 0;
+    }
+
+    std::size_t morsels(const Batch& b) const { return (b.rows() + morsel_ - 1) / morsel_; }
+
+    // result bits into out, counts of true rows per morsel into counts if set
+    template<typename P>
+    void eval(const P& p, const Batch& b, std::uint64_t* out, std::size_t* counts) {
+        run(morsels(b), [&] (unsigned worker, std::size_t m) {
+            auto first = m * morsel_;
+            auto r = lexen::eval(p, b.slice(first, std::min(morsel_, b.rows() - first)), ctx_[worker]);
+            std::copy(r.begin(), r.end(), out + first / 64);
+            if (!counts) return;
+            std::size_t n = 0;
+            for (auto x : r) n += simd::popcount(x);
+            counts[m] = n;
+        });
+    }
+
+    // context of a worker, with settings of ctx and no scratch
+    static BatchContext settings(const BatchContext& ctx) {
+        BatchContext r;
+        r.sparse_fraction = ctx.sparse_fraction;
+        r.ext_cache = ctx.ext_cache;
+        return r;
+    }
+
+    // Morsels as runs of consecutive ones, one per worker; a worker takes
+    // the front of its own run, and once it is empty the back half of the
+    // longest run left.
+    class Stealing {
+    public:
+        Stealing(std::size_t n, unsigned workers) : workers_(workers), runs_(new Run[workers]) {
+            for (unsigned w = 0; w < workers; ++w)
+                runs_[w].span = pack(std::uint32_t(n * w / workers), std::uint32_t(n * (w + 1) / workers));
+        }
+
+        bool next(unsigned self, std::size_t& morsel) {
+            auto& own = runs_[self].span;
+            do {
+                for (auto span = own.load(); left(span);) {
+                    if (own.compare_exchange_weak(span, span + 1)) {
+                        morsel = std::uint32_t(span);
+                        return true;
+                    }
+                }
+            } while (steal(self));
+            return false;
+        }
+
+    private:
+        // moves back half of the longest run of others to own, which is
+        // empty; false if no morsels are left
+        bool steal(unsigned self) {
+            for (;;) {
+                unsigned victim = self;
+                std::uint64_t seen = 0;
+                for (unsigned w = 0; w < workers_; ++w) {
+                    auto span = runs_[w].span.load();
+                    if (w != self && left(span) > left(seen)) {
+                        victim = w;
+                        seen = span;
+                    }
+                }
+                if (victim == self) return false;
+                auto end = std::uint32_t(seen >> 32);
+                auto mid = end - (left(seen) + 1) / 2;
+                if (!runs_[victim].span.compare_exchange_strong(seen, pack(std::uint32_t(seen), mid))) continue;
+                runs_[self].span = pack(mid, end);
+                return true;
+            }
+        }
+
+        unsigned workers_;
+        std::unique_ptr<Run[]> runs_;
+    };
+
+    // calls f(worker, morsel) for morsels [0, n) on the caller and the pool,
+    // as parallel_run() does
+    template<typename F>
+    void run(std::size_t n, F&& f) {
+        BOOST_ASSERT_MSG(n <= 0xFFFFFFFF, "too many morsels");
+        parallel_run<Stealing>(pool_, n, unsigned(ctx_.size()), f);
+    }
+
+    ThreadPool& pool_;
+    std::size_t morsel_;
+    std::vector<BatchContext> ctx_;     // per worker, the caller is 0
+};
+
+} // lexen
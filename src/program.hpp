@@ -0,0 +1,435 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions engine - compiled program
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ast.hpp"
+#include "dictionary.hpp"
+#include "extension.hpp"
+#include "int_set.hpp"
+#include "str_set.hpp"
+
+namespace lexen {
+
+namespace x3 = boost::spirit::x3;
+
+// predicate operation codes, every instruction of the program is a predicate
+enum class OpCode : std::uint8_t {
+    BoolVar,    // boolean variable is true
+    IsNull,     // variable is null
+    IsNotNull,  // variable is not null
+    IsEmpty,    // list variable is null or has no elements
+    NumCmp,     // numeric variable vs numeric literal, sub = CompOp
+    NumRange,   // numeric variable within range, arg.slice = bounds in nums,
+                // sub = strict lower (bit 0) and upper (bit 1) bounds
+    StrEq,      // string variable equals string literal
+    IntIn,      // integer variable in literal set, arg.slice = int_sets index
+    StrIn,      // string variable in literal set, arg.slice = str_sets index
+    HasInt,     // integer literal is an element of list variable
+    HasStr,     // string literal is an element of list variable
+    IntsVs,     // integer list variable vs literal set, sub = ListOp,
+                // arg.slice = int_sets index
+    StrsVs,     // string list variable vs literal set, sub = ListOp,
+                // arg.slice = str_sets index
+    Ext,        // predicate extension
+    Pred        // result of a shared predicate, arg.ival = predicate id
+};
+
+// [offset, offset + size) range in one of the program pools
+struct Slice {
+    std::uint32_t offset;
+    std::uint32_t size;
+};
+
+union Arg {
+    double num;
+    std::int32_t ival;
+    Slice slice;
+};
+
+// Single predicate with jump targets. Program control flow is forward only,
+// negation is encoded by the neg flag, and/or - by the jump targets.
+struct Instr {
+    OpCode op;
+    std::uint8_t sub;
+    bool neg;
+    std::int32_t var;
+    std::uint32_t on_true;
+    std::uint32_t on_false;
+    Arg arg;
+};
+
+struct Program {
+    // terminal jump targets
+    static constexpr std::uint32_t accept = 0xFFFFFFFFu;
+    static constexpr std::uint32_t reject = 0xFFFFFFFEu;
+
+    std::vector<Instr> code;
+    std::uint32_t entry = reject;
+
+    // literal pools
+    std::vector<IntSet> int_sets;
+    IntPool int_pool;
+    std::vector<double> nums;   // range bounds
+    std::string chars;          // string arena
+    std::vector<Slice> strs;    // strings in arena, sorted within a set
+    std::vector<StrSet> str_sets;
+    std::vector<StrSlot> str_slots;
+#ifdef PREDICATE_EXTENSION_AST_TYPE
+    std::vector<ExtCode> ext;   // see extension.hpp
+    std::vector<std::uint32_t> ext_ids; // per ext, detail::ext_id()
+#endif
+
+    // string literals interned into dict, see intern()
+    const Dictionary* dict = nullptr;
+    std::vector<std::uint32_t> lit_codes;   // per instruction, code of StrEq literal
+    std::vector<IntSet> code_sets;          // per str_sets, codes in int_pool
+
+    std::string_view str(const Slice& s) const {
+        return std::string_view(chars.data() + s.offset, s.size);
+    }
+};
+
+// Read-only program over pools owned elsewhere, such as a mapped program
+// image. Evaluates exactly as the program it was made from; compiled
+// extensions are viewed in memory only, images can not hold them.
+struct ProgramView {
+    ListView<Instr> code;
+    std::uint32_t entry = Program::reject;
+
+    ListView<IntSet> int_sets;
+    IntPoolView int_pool;
+    ListView<double> nums;
+    std::string_view chars;
+    ListView<Slice> strs;
+    ListView<StrSet> str_sets;
+    ListView<StrSlot> str_slots;
+#ifdef PREDICATE_EXTENSION_AST_TYPE
+    ListView<ExtCode> ext;
+    ListView<std::uint32_t> ext_ids;
+#endif
+
+    // string literals interned into dict, see intern()
+    const Dictionary* dict = nullptr;
+    ListView<std::uint32_t> lit_codes;
+    ListView<IntSet> code_sets;
+
+    ProgramView() = default;
+
+    ProgramView(const Program& p)
+        : code(p.code), entry(p.entry), int_sets(p.int_sets)
+        , int_pool{p.int_pool.ints, p.int_pool.bits, p.int_pool.chunks, p.int_pool.lows}
+        , nums(p.nums), chars(p.chars), strs(p.strs), str_sets(p.str_sets), str_slots(p.str_slots)
+#ifdef PREDICATE_EXTENSION_AST_TYPE
+        , ext(p.ext), ext_ids(p.ext_ids)
+#endif
+        , dict(p.dict), lit_codes(p.lit_codes), code_sets(p.code_sets) {}
+
+    std::string_view str(const Slice& s) const {
+        return std::string_view(chars.data() + s.offset, s.size);
+    }
+};
+
+namespace detail {
+
+inline bool is_lower(ast::CompOp op) { return op == ast::CompOp::Gt || op == ast::CompOp::Ge; }
+inline bool is_upper(ast::CompOp op) { return op == ast::CompOp::Lt || op == ast::CompOp::Le; }
+
+// lower and upper bound of the same variable, compiled into a single
+// range check
+inline bool is_range(const ast::Conjunction& x) {
+    if (x.items.size() != 2) return false;
+    auto lo = boost::get<ast::NumComp>(&x.items[0].get());
+    auto hi = boost::get<ast::NumComp>(&x.items[1].get());
+    return lo && hi && lo->var == hi->var && is_lower(lo->cmp) && is_upper(hi->cmp);
+}
+
+// number of instructions an expression compiles into
+struct leaf_count : boost::static_visitor<std::uint32_t> {
+    std::uint32_t operator()(const ast::BoolVal&) const { return 0; }
+    std::uint32_t operator()(const x3::forward_ast<ast::Conjunction>& x) const {
+        return is_range(x.get()) ? 1 : sum(x.get().items);
+    }
+    std::uint32_t operator()(const x3::forward_ast<ast::Disjunction>& x) const {
+        return sum(x.get().items);
+    }
+    std::uint32_t operator()(const x3::forward_ast<ast::Negation>& x) const {
+        return boost::apply_visitor(*this, x.get().expr);
+    }
+    template<typename T>
+    std::uint32_t operator()(const T&) const { return 1; }
+
+    std::uint32_t sum(const std::vector<ast::Expression>& items) const {
+        std::uint32_t n = 0;
+        for (auto& x : items) n += boost::apply_visitor(*this, x);
+        return n;
+    }
+};
+
+inline std::uint32_t leaves(const ast::Expression& e) {
+    return boost::apply_visitor(leaf_count(), e);
+}
+
+// Emits instructions of an expression into the preallocated code range
+// starting at base, returns entry point. An expression jumps to t when it
+// evaluates to true (false if neg is set), otherwise to f; unknown result
+// (null variable) always jumps to f, which gives SQL semantics at the top.
+class Emitter : public boost::static_visitor<std::uint32_t> {
+public:
+    Emitter(Program& p, std::uint32_t base, std::uint32_t t, std::uint32_t f, bool neg)
+        : p_(p), base_(base), t_(t), f_(f), neg_(neg) {}
+
+    std::uint32_t operator()(const ast::BoolVal& x) const {
+        return x.value != neg_ ? t_ : f_;
+    }
+
+    std::uint32_t operator()(const ast::VarIdx& x) const {
+        return leaf(OpCode::BoolVar, 0, false, x);
+    }
+
+    std::uint32_t operator()(const ast::UnaryExpr& x) const {
+        switch (x.op) {
+        case ast::UnaryOp::IsNull:    return leaf(OpCode::IsNull, 0, false, x.var);
+        case ast::UnaryOp::IsNotNull: return leaf(OpCode::IsNotNull, 0, false, x.var);
+        case ast::UnaryOp::IsEmpty:   return leaf(OpCode::IsEmpty, 0, false, x.var);
+        }
+        BOOST_ASSERT_MSG(false, "unsupported unary op");
+        return f_;
+    }
+
+    std::uint32_t operator()(const ast::NumComp& x) const {
+        Arg a;
+        a.num = boost::apply_visitor([] (auto v) { return double(v); }, x.val);
+        return leaf(OpCode::NumCmp, std::uint8_t(x.cmp), false, x.var, a);
+    }
+
+    std::uint32_t operator()(const ast::StrComp& x) const {
+        Arg a;
+        a.slice = add_str(x.val);
+        return leaf(OpCode::StrEq, 0, x.cmp == ast::CompOp::Ne, x.var, a);
+    }
+
+    std::uint32_t operator()(const ast::SetExpr& x) const {
+        return boost::apply_visitor(*this, x);
+    }
+
+    std::uint32_t operator()(const ast::ValInSet<int>& x) const {
+        Arg a;
+        a.ival = x.val;
+        return leaf(OpCode::HasInt, 0, x.op == ast::SetOp::NotIn, x.set, a);
+    }
+
+    std::uint32_t operator()(const ast::ValInSet<std::string>& x) const {
+        Arg a;
+        a.slice = add_str(x.val);
+        return leaf(OpCode::HasStr, 0, x.op == ast::SetOp::NotIn, x.set, a);
+    }
+
+    std::uint32_t operator()(const ast::VarInSet<int>& x) const {
+        Arg a;
+        a.slice = add_ints(x.set);
+        return leaf(OpCode::IntIn, 0, x.op == ast::SetOp::NotIn, x.var, a);
+    }
+
+    std::uint32_t operator()(const ast::VarInSet<std::string>& x) const {
+        Arg a;
+        a.slice = add_str_set(x.set);
+        return leaf(OpCode::StrIn, 0, x.op == ast::SetOp::NotIn, x.var, a);
+    }
+
+    std::uint32_t operator()(const ast::ListExpr& x) const {
+        return boost::apply_visitor(*this, x);
+    }
+
+    // "none of" is a negated "one of"
+    std::uint32_t operator()(const ast::VarVsSet<int>& x) const {
+        Arg a;
+        a.slice = add_ints(x.set);
+        return leaf(OpCode::IntsVs, list_op(x.op), x.op == ast::ListOp::NoneOf, x.var, a);
+    }
+
+    std::uint32_t operator()(const ast::VarVsSet<std::string>& x) const {
+        Arg a;
+        a.slice = add_str_set(x.set);
+        return leaf(OpCode::StrsVs, list_op(x.op), x.op == ast::ListOp::NoneOf, x.var, a);
+    }
+
+#ifdef PREDICATE_EXTENSION_AST_TYPE
+    std::uint32_t operator()(const PREDICATE_EXTENSION_AST_TYPE& x) const {
+        Arg a;
+        a.slice = Slice{std::uint32_t(p_.ext.size()), 1};
+        p_.ext.push_back(detail::compile_ext(x));
+        p_.ext_ids.push_back(detail::ext_id(x));
+        return leaf(OpCode::Ext, 0, false, ast::VarIdx(0), a);
+    }
+#endif
+
+    // not (a and b) = not a or not b
+    std::uint32_t operator()(const x3::forward_ast<ast::Conjunction>& x) const {
+        if (is_range(x.get())) return range(x.get());
+        return neg_ ? any(x.get().items) : all(x.get().items);
+    }
+
+    // not (a or b) = not a and not b
+    std::uint32_t operator()(const x3::forward_ast<ast::Disjunction>& x) const {
+        return neg_ ? all(x.get().items) : any(x.get().items);
+    }
+
+    std::uint32_t operator()(const x3::forward_ast<ast::Negation>& x) const {
+        return boost::apply_visitor(Emitter(p_, base_, t_, f_, !neg_), x.get().expr);
+    }
+
+private:
+    static std::uint8_t list_op(ast::ListOp op) {
+        return std::uint8_t(op == ast::ListOp::AllOf ? ast::ListOp::AllOf : ast::ListOp::OneOf);
+    }
+
+    std::uint32_t range(const ast::Conjunction& x) const {
+        auto& lo = boost::get<ast::NumComp>(x.items[0].get());
+        auto& hi = boost::get<ast::NumComp>(x.items[1].get());
+        auto num = [] (const ast::NumVal& v) { return boost::apply_visitor([] (auto n) { return double(n); }, v); };
+        Arg a;
+        a.slice = Slice{std::uint32_t(p_.nums.size()), 2};
+        p_.nums.push_back(num(lo.val));
+        p_.nums.push_back(num(hi.val));
+        std::uint8_t sub = (lo.cmp == ast::CompOp::Gt ? 1 : 0) | (hi.cmp == ast::CompOp::Lt ? 2 : 0);
+        return leaf(OpCode::NumRange, sub, false, lo.var, a);
+    }
+
+    std::uint32_t leaf(OpCode op, std::uint8_t sub, bool neg, ast::VarIdx var, Arg a = Arg()) const {
+        p_.code[base_] = Instr{op, sub, neg != neg_, var.index, t_, f_, a};
+        return base_;
+    }
+
+    // children are laid out in source order, but emitted backwards so that
+    // the entry point of the next sibling is known
+    std::vector<std::uint32_t> offsets(const std::vector<ast::Expression>& items) const {
+        std::vector<std::uint32_t> off(items.size());
+        std::uint32_t at = base_;
+        for (std::size_t i = 0; i < items.size(); ++i) {
+            off[i] = at;
+            at += leaves(items[i]);
+        }
+        return off;
+    }
+
+    std::uint32_t all(const std::vector<ast::Expression>& items) const {
+        auto off = offsets(items);
+        auto next = t_;
+        for (std::size_t i = items.size(); i-- > 0; )
+            next = boost::apply_visitor(Emitter(p_, off[i], next, f_, neg_), items[i]);
+        return next;
+    }
+
+    std::uint32_t any(const std::vector<ast::Expression>& items) const {
+        auto off = offsets(items);
+        auto next = f_;
+        for (std::size_t i = items.size(); i-- > 0; )
+            next = boost::apply_visitor(Emitter(p_, off[i], t_, next, neg_), items[i]);
+        return next;
+    }
+
+    Slice add_str(const std::string& s) const {
+        Slice r{std::uint32_t(p_.chars.size()), std::uint32_t(s.size())};
+        p_.chars += s;
+        return r;
+    }
+
+    // slice refers to the set in int_sets
+    Slice add_ints(const std::vector<int>& set) const {
+        std::vector<int> sorted(set);
+        std::sort(sorted.begin(), sorted.end());
+        sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+        Slice r{std::uint32_t(p_.int_sets.size()), std::uint32_t(sorted.size())};
+        p_.int_sets.push_back(p_.int_pool.add(sorted));
+        return r;
+    }
+
+    // sorted strings of the set and their lookup table, slice refers to
+    // the set in str_sets
+    Slice add_str_set(const std::vector<std::string>& set) const {
+        std::vector<std::string> sorted(set);
+        std::sort(sorted.begin(), sorted.end());
+        sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+        auto strs = std::uint32_t(p_.strs.size());
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> items;
+        for (auto& s : sorted) {
+            p_.strs.push_back(add_str(s));
+            items.emplace_back(p_.strs.back().offset, p_.strs.back().size);
+        }
+        Slice r{std::uint32_t(p_.str_sets.size()), std::uint32_t(sorted.size())};
+        p_.str_sets.push_back(make_str_set(p_.str_slots, p_.chars, strs, items));
+        return r;
+    }
+
+    Program& p_;
+    std::uint32_t base_;
+    std::uint32_t t_;
+    std::uint32_t f_;
+    bool neg_;
+};
+
+} // detail
+
+// lower expression tree into a flat short-circuit program
+inline Program compile(const ast::Expression& e) {
+    Program p;
+    p.code.resize(detail::leaves(e));
+    p.entry = boost::apply_visitor(
+        detail::Emitter(p, 0, Program::accept, Program::reject, false), e);
+    return p;
+}
+
+// Program of one instruction per leaf, the leaves chained as a conjunction.
+// Unlike compile() of their conjunction, a lower and an upper bound of a
+// variable stay two instructions; a leaf which is a range is still one.
+inline Program compile_leaves(const std::vector<ast::Expression>& leaves) {
+    Program p;
+    p.code.resize(leaves.size());
+    std::uint32_t next = Program::accept;
+    for (std::size_t i = leaves.size(); i-- > 0; ) {
+        BOOST_ASSERT_MSG(detail::leaves(leaves[i]) == 1, "not a leaf");
+        next = boost::apply_visitor(
+            detail::Emitter(p, std::uint32_t(i), next, Program::reject, false), leaves[i]);
+    }
+    p.entry = next;
+    return p;
+}
+
+// Interns string literals of the program into the dictionary, so that
+// string predicates over columns encoded with the same dictionary compare
+// codes instead of strings: a code per StrEq literal, and a code set per
+// string set.
+inline void intern(Program& p, Dictionary& dict) {
+    p.dict = &dict;
+    p.lit_codes.assign(p.code.size(), Dictionary::npos);
+    for (std::size_t pc = 0; pc < p.code.size(); ++pc) {
+        auto& in = p.code[pc];
+        if (in.op == OpCode::StrEq) p.lit_codes[pc] = dict.intern(p.str(in.arg.slice));
+    }
+    p.code_sets.clear();
+    for (auto& s : p.str_sets) {
+        std::vector<int> codes;
+        for (std::uint32_t i = 0; i < s.size; ++i) codes.push_back(int(dict.intern(p.str(p.strs[s.strs + i]))));
+        std::sort(codes.begin(), codes.end());
+        p.code_sets.push_back(p.int_pool.add(codes));
+    }
+}
+
+inline Program compile(const ast::Expression& e, Dictionary& dict) {
+    Program p = compile(e);
+    intern(p, dict);
+    return p;
+}
+
+} // lexen
@@ -0,0 +1,95 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions engine - packed record
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+#pragma once
+
+#include <cstring>
+
+#include "schema.hpp"
+
+namespace lexen {
+
+// Values of schema variables in fixed-offset slots of a single buffer plus
+// validity bitmap. Strings and lists are views, their data is owned by the
+// caller. Record is reusable: clear() makes all variables null without any
+// memory allocation. Variables added to the schema after the record was
+// made are null until set, which grows the record.
+class Record {
+public:
+    explicit Record(const Schema& schema)
+        : schema_(&schema)
+        , buf_((schema.size() + 7) / 8)
+        , valid_((schema.vars() + 63) / 64)
+    {}
+
+    const Schema& schema() const { return *schema_; }
+
+    void clear() { std::fill(valid_.begin(), valid_.end(), 0); }
+
+    void set_null(ast::VarIdx var) {
+        if (!is_null(var)) valid_[var.index / 64] &= ~bit(var);
+    }
+
+    void set_bool(ast::VarIdx var, bool x) { put(var, var_type::boolean, x); }
+    void set_int(ast::VarIdx var, int x) { put(var, var_type::integer, x); }
+    void set_real(ast::VarIdx var, double x) { put(var, var_type::realnum, x); }
+    void set_str(ast::VarIdx var, std::string_view x) { put(var, var_type::string, x); }
+    void set_ints(ast::VarIdx var, ListView<int> x) { put(var, var_type::integers, x); }
+    void set_strs(ast::VarIdx var, ListView<std::string_view> x) { put(var, var_type::strings, x); }
+
+    bool is_null(ast::VarIdx var) const {
+        auto word = std::size_t(var.index / 64);
+        return word >= valid_.size() || !(valid_[word] & bit(var));
+    }
+
+    bool is_empty(ast::VarIdx var) const {
+        return schema_->type(var) == var_type::integers
+            ? get<ListView<int>>(var).empty()
+            : get<ListView<std::string_view>>(var).empty();
+    }
+
+    bool get_bool(ast::VarIdx var) const { return get<bool>(var); }
+    int get_int(ast::VarIdx var) const { return get<int>(var); }
+    std::string_view get_str(ast::VarIdx var) const { return get<std::string_view>(var); }
+    ListView<int> get_ints(ast::VarIdx var) const { return get<ListView<int>>(var); }
+    ListView<std::string_view> get_strs(ast::VarIdx var) const {
+        return get<ListView<std::string_view>>(var);
+    }
+
+    // integer or real variable value
+    double get_num(ast::VarIdx var) const {
+        return schema_->type(var) == var_type::integer ? get<int>(var) : get<double>(var);
+    }
+
+private:
+    static std::uint64_t bit(ast::VarIdx var) {
+        return std::uint64_t(1) << (var.index % 64);
+    }
+
+    template<typename T>
+    void put(ast::VarIdx var, var_type type, const T& x) {
+        BOOST_ASSERT_MSG(schema_->has(var) && schema_->type(var) == type, "variable type mismatch");
+        (void)type;
+        if (schema_->offset(var) + sizeof(T) > buf_.size() * 8) buf_.resize((schema_->size() + 7) / 8);
+        if (std::size_t(var.index / 64) >= valid_.size()) valid_.resize((schema_->vars() + 63) / 64);
+        std::memcpy(reinterpret_cast<char*>(buf_.data()) + schema_->offset(var), &x, sizeof(T));
+        valid_[var.index / 64] |= bit(var);
+    }
+
+    template<typename T>
+    T get(ast::VarIdx var) const {
+        T x;
+        std::memcpy(&x, reinterpret_cast<const char*>(buf_.data()) + schema_->offset(var), sizeof(T));
+        return x;
+    }
+
+    const Schema* schema_;
+    std::vector<std::uint64_t> buf_;
+    std::vector<std::uint64_t> valid_;
+};
+
+} // lexen
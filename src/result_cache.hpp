@@ -0,0 +1,229 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions engine - sharded cache of predicate results
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "dictionary.hpp"
+
+namespace lexen {
+
+/*
+ * Bounded cache of results of expensive predicates, such as extensions,
+ * keyed by predicate id and the value: either a 64-bit key identifying
+ * it exactly, e.g. an integer, or a string by key() of its dictionary and
+ * code: a bare code means different strings in different dictionaries;
+ * or a string itself, found by its hash and compared in full. Ids of
+ * predicates come from predicate(), unique in the process, so a cache
+ * may serve any number of predicates of any programs; compiled programs
+ * get one per distinct extension, see extension.hpp.
+ *
+ * Keys are spread over shards, each guarded by its own mutex. Within a
+ * shard entries are 4-way set associative with CLOCK replacement per
+ * set: a hit sets the reference bit of the entry, a miss replaces the
+ * first entry under the hand of the set with the bit cleared, clearing
+ * the bits it passes. Memory is allocated at construction only, except
+ * for copies of string keys, which reuse the capacity of the entry they
+ * replace. Safe for concurrent use.
+ */
+class ResultCache {
+public:
+    static constexpr std::size_t ways = 4;
+
+    // capacity is rounded up to whole sets of every shard
+    explicit ResultCache(std::size_t capacity, std::size_t shards = 16)
+        : shards_(shards ? shards : 1)
+        , sets_(std::max<std::size_t>(1, (capacity + shards_ * ways - 1) / (shards_ * ways)))
+        , shard_(new Shard[shards_])
+    {
+        for (std::size_t i = 0; i < shards_; ++i) {
+            shard_[i].entries.resize(sets_ * ways);
+            shard_[i].hands.resize(sets_);
+        }
+    }
+
+    std::size_t capacity() const { return shards_ * sets_ * ways; }
+
+    // new predicate id, thread safe
+    static std::uint32_t predicate() {
+        static std::atomic<std::uint32_t> n{0};
+        return n.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // key of a dictionary-encoded string
+    static std::uint64_t key(const Dictionary& dict, std::uint32_t code) {
+        return std::uint64_t(dict.id()) << 32 | code;
+    }
+
+    // false if the result is not cached
+    bool find(std::uint32_t pred, std::uint64_t value, bool& result) {
+        return find(pred, Key{value, {}, false}, result);
+    }
+
+    bool find(std::uint32_t pred, std::string_view value, bool& result) {
+        return find(pred, Key{str_hash(value), value, true}, result);
+    }
+
+    void put(std::uint32_t pred, std::uint64_t value, bool result) {
+        put(pred, Key{value, {}, false}, result);
+    }
+
+    void put(std::uint32_t pred, std::string_view value, bool result) {
+        put(pred, Key{str_hash(value), value, true}, result);
+    }
+
+    // cached result, computed by f() and cached on a miss; f runs unlocked,
+    // so concurrent misses of one key may both compute it
+    template<typename F>
+    bool get(std::uint32_t pred, std::uint64_t value, F&& f) {
+        return get(pred, Key{value, {}, false}, f);
+    }
+
+    template<typename F>
+    bool get(std::uint32_t pred, std::string_view value, F&& f) {
+        return get(pred, Key{str_hash(value), value, true}, f);
+    }
+
+    std::uint64_t hits() const {
+        std::uint64_t n = 0;
+        for (std::size_t i = 0; i < shards_; ++i) n += shard_[i].hits.load(std::memory_order_relaxed);
+        return n;
+    }
+
+    std::uint64_t misses() const {
+        std::uint64_t n = 0;
+        for (std::size_t i = 0; i < shards_; ++i) n += shard_[i].misses.load(std::memory_order_relaxed);
+        return n;
+    }
+
+    // drops all entries and resets the counters
+    void clear() {
+        for (std::size_t i = 0; i < shards_; ++i) {
+            auto& s = shard_[i];
+            std::lock_guard<std::mutex> lock(s.mutex);
+            std::fill(s.entries.begin(), s.entries.end(), Entry{});
+            std::fill(s.hands.begin(), s.hands.end(), 0);
+            s.hits = 0;
+            s.misses = 0;
+        }
+    }
+
+private:
+    // value, or hash of the string for string keys
+    struct Key {
+        std::uint64_t value;
+        std::string_view str;
+        bool is_str;
+    };
+
+    struct Entry {
+        std::uint64_t value = 0;
+        std::string str;            // string key
+        std::uint32_t pred = 0;
+        std::uint8_t used = 0;
+        std::uint8_t ref = 0;
+        bool is_str = false;
+        bool result = false;
+
+        bool is(std::uint32_t p, const Key& k) const {
+            return used && pred == p && value == k.value && is_str == k.is_str && (!is_str || str == k.str);
+        }
+    };
+
+    // own cache line each, so shards do not contend through false sharing
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        std::vector<Entry> entries;         // sets of ways entries
+        std::vector<std::uint8_t> hands;    // per set
+        std::atomic<std::uint64_t> hits{0};
+        std::atomic<std::uint64_t> misses{0};
+    };
+
+    // splitmix64 finalizer of the key
+    static std::uint64_t hash(std::uint32_t pred, std::uint64_t value) {
+        std::uint64_t x = value ^ (std::uint64_t(pred) * 0x9e3779b97f4a7c15ull);
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+    static std::uint64_t str_hash(std::string_view s) {
+        return std::hash<std::string_view>()(s);
+    }
+
+    bool find(std::uint32_t pred, const Key& k, bool& result) {
+        auto h = hash(pred, k.value);
+        auto& s = shard(h);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto set = &s.entries[(h >> 32) % sets_ * ways];
+        for (std::size_t i = 0; i < ways; ++i) {
+            auto& e = set[i];
+            if (e.is(pred, k)) {
+                e.ref = 1;
+                result = e.result;
+                s.hits.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        s.misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    void put(std::uint32_t pred, const Key& k, bool result) {
+        auto h = hash(pred, k.value);
+        auto& s = shard(h);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto n = (h >> 32) % sets_;
+        auto set = &s.entries[n * ways];
+        for (std::size_t i = 0; i < ways; ++i) {
+            auto& e = set[i];
+            if (e.is(pred, k)) {
+                e.result = result;
+                return;
+            }
+        }
+        auto& hand = s.hands[n];
+        while (set[hand].used && set[hand].ref) {
+            set[hand].ref = 0;
+            hand = std::uint8_t((hand + 1) % ways);
+        }
+        auto& e = set[hand];
+        e.value = k.value;
+        e.str.assign(k.str.data(), k.str.size());
+        e.pred = pred;
+        e.used = 1;
+        e.ref = 0;
+        e.is_str = k.is_str;
+        e.result = result;
+        hand = std::uint8_t((hand + 1) % ways);
+    }
+
+    template<typename F>
+    bool get(std::uint32_t pred, const Key& k, F& f) {
+        bool r;
+        if (find(pred, k, r)) return r;
+        r = f();
+        put(pred, k, r);
+        return r;
+    }
+
+    Shard& shard(std::uint64_t h) { return shard_[std::uint32_t(h) % shards_]; }
+
+    std::size_t shards_;
+    std::size_t sets_;
+    std::unique_ptr<Shard[]> shard_;
+};
+
+} // lexen
@@ -0,0 +1,475 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions engine - index of many expressions
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+#pragma once
+
+#include <cmath>
+#include <unordered_map>
+
+#include "rule_set.hpp"
+
+namespace lexen {
+
+// scratch space of RuleIndex::match, one per thread
+struct MatchContext {
+    std::uint32_t gen = 0;
+    std::vector<std::uint32_t> stamp;       // per posting
+    std::vector<std::uint32_t> count;       // per conjunct
+    std::vector<std::uint32_t> touched;     // conjuncts with count > 0
+    std::vector<std::uint32_t> rule_stamp;  // per rule
+    std::vector<std::uint32_t> pred_stamp;  // per residual predicate
+    RuleSetContext preds;                   // residual predicate results
+};
+
+enum class IndexKind : std::uint32_t { None, Bool, Num, Str, Ints, Strs };
+
+// literal of an atom and its postings in the lists
+struct NumEntry {
+    double value;
+    Slice postings;
+};
+
+struct IntEntry {
+    std::int32_t value;
+    Slice postings;
+};
+
+struct StrEntry {
+    Slice value;        // in chars
+    Slice postings;
+};
+
+// range bound of an atom
+struct Threshold {
+    double value;
+    std::uint32_t posting;
+    std::uint32_t reserved;
+};
+
+// index of one variable, entries of each slice are sorted by value
+struct IndexVar {
+    // bounds by the atom comparison
+    enum Bound { Gt, Ge, Lt, Le };
+
+    std::int32_t var;
+    IndexKind kind;
+    Slice bools[2];     // in lists, by the value
+    Slice nums;
+    Slice ints;
+    Slice strs;
+    Slice bounds[4];
+};
+
+struct IndexConjunct {
+    static constexpr std::uint32_t none = 0xFFFFFFFFu;
+
+    std::uint32_t rule;
+    std::uint32_t need;         // number of indexed atoms
+    std::uint32_t residual;     // rule of residuals or none
+};
+
+/*
+ * Read-only index over flat arrays owned elsewhere, see RuleIndex::view()
+ * and RuleIndexImage. Literals are found by binary search in sorted
+ * entries, residual atoms are rules of a rule set over shared predicates,
+ * evaluated on first use per record.
+ */
+struct RuleIndexView {
+    std::uint32_t rules = 0;
+    ListView<IndexVar> vars;            // indexed variables
+    ListView<NumEntry> nums;
+    ListView<IntEntry> ints;
+    ListView<StrEntry> strs;
+    std::string_view chars;
+    ListView<Threshold> bounds;
+    ListView<std::uint32_t> lists;      // postings of literals
+    ListView<std::uint32_t> postings;   // posting -> conjunct
+    ListView<IndexConjunct> conjuncts;
+    ListView<std::uint32_t> always;     // conjuncts with no indexed atoms
+    RuleSetView residuals;
+
+    std::uint32_t size() const { return rules; }
+
+    std::string_view str(const Slice& s) const {
+        return std::string_view(chars.data() + s.offset, s.size);
+    }
+
+    // ids of expressions true for the record, in ascending order
+    template<typename Record>
+    void match(const Record& rec, MatchContext& ctx, std::vector<std::uint32_t>& out) const {
+        out.clear();
+        auto preds = residuals.preds.code.size();
+        ctx.stamp.resize(postings.size());
+        ctx.count.resize(conjuncts.size());
+        ctx.rule_stamp.resize(rules);
+        ctx.pred_stamp.resize(preds);
+        ctx.preds.truth.resize((preds + 63) / 64);
+        ctx.preds.known.resize((preds + 63) / 64);
+        ctx.preds.keys.reset();
+        if (++ctx.gen == 0) {
+            std::fill(ctx.stamp.begin(), ctx.stamp.end(), 0);
+            std::fill(ctx.rule_stamp.begin(), ctx.rule_stamp.end(), 0);
+            std::fill(ctx.pred_stamp.begin(), ctx.pred_stamp.end(), 0);
+            ctx.gen = 1;
+        }
+        ctx.touched.clear();
+
+        auto hit = [this, &ctx] (std::uint32_t posting) {
+            if (ctx.stamp[posting] == ctx.gen) return;
+            ctx.stamp[posting] = ctx.gen;
+            auto c = postings[posting];
+            if (ctx.count[c]++ == 0) ctx.touched.push_back(c);
+        };
+        auto hits = [this, &hit] (const Slice& s) {
+            for (std::uint32_t i = 0; i < s.size; ++i) hit(lists[s.offset + i]);
+        };
+        auto find_str = [this] (const IndexVar& v, std::string_view x) {
+            auto first = strs.begin() + v.strs.offset, last = first + v.strs.size;
+            auto it = std::lower_bound(first, last, x, [this] (const StrEntry& a, std::string_view x) {
+                return str(a.value) < x;
+            });
+            return it != last && str(it->value) == x ? &*it : nullptr;
+        };
+
+        for (auto& v : vars) {
+            ast::VarIdx var(v.var);
+            if (rec.is_null(var)) continue;
+            switch (v.kind) {
+            case IndexKind::Bool:
+                hits(v.bools[rec.get_bool(var)]);
+                break;
+            case IndexKind::Num: {
+                double x = rec.get_num(var);
+                if (std::isnan(x)) break;
+                if (auto e = find(nums, v.nums, x)) hits(e->postings);
+                probe(v, x, hit);
+                break;
+            }
+            case IndexKind::Str:
+                if (auto e = find_str(v, rec.get_str(var))) hits(e->postings);
+                break;
+            case IndexKind::Ints:
+                for (auto x : rec.get_ints(var))
+                    if (auto e = find(ints, v.ints, x)) hits(e->postings);
+                break;
+            case IndexKind::Strs:
+                for (auto x : rec.get_strs(var))
+                    if (auto e = find_str(v, std::string_view(x))) hits(e->postings);
+                break;
+            case IndexKind::None:
+                break;
+            }
+        }
+
+        auto check = [&] (std::uint32_t c) {
+            auto& x = conjuncts[c];
+            if (ctx.rule_stamp[x.rule] == ctx.gen) return;
+            if (x.residual != IndexConjunct::none && !detail::run_rule(residuals.preds, residuals.code,
+                    residuals.entries[x.residual], rec, ctx.preds, ctx.pred_stamp.data(), ctx.gen))
+                return;
+            ctx.rule_stamp[x.rule] = ctx.gen;
+            out.push_back(x.rule);
+        };
+        for (auto c : ctx.touched) {
+            if (ctx.count[c] == conjuncts[c].need) check(c);
+            ctx.count[c] = 0;
+        }
+        for (auto c : always) check(c);
+        std::sort(out.begin(), out.end());
+    }
+
+private:
+    template<typename Entry, typename T>
+    static const Entry* find(ListView<Entry> all, const Slice& s, T x) {
+        auto first = all.begin() + s.offset, last = first + s.size;
+        auto it = std::lower_bound(first, last, x, [] (const Entry& a, T x) { return a.value < x; });
+        return it != last && it->value == x ? &*it : nullptr;
+    }
+
+    template<typename Hit>
+    void probe(const IndexVar& v, double x, Hit& hit) const {
+        auto range = [this] (const Slice& s) {
+            auto first = bounds.begin() + s.offset;
+            return std::make_pair(first, first + s.size);
+        };
+        auto lower = [x] (auto r) {
+            return std::lower_bound(r.first, r.second, x, [] (const Threshold& a, double v) { return a.value < v; });
+        };
+        auto upper = [x] (auto r) {
+            return std::upper_bound(r.first, r.second, x, [] (double v, const Threshold& a) { return v < a.value; });
+        };
+        // x > t, x >= t, x < t, x <= t
+        auto gt = range(v.bounds[IndexVar::Gt]), ge = range(v.bounds[IndexVar::Ge]);
+        auto lt = range(v.bounds[IndexVar::Lt]), le = range(v.bounds[IndexVar::Le]);
+        for (auto it = gt.first, e = lower(gt); it != e; ++it) hit(it->posting);
+        for (auto it = ge.first, e = upper(ge); it != e; ++it) hit(it->posting);
+        for (auto it = upper(lt); it != lt.second; ++it) hit(it->posting);
+        for (auto it = lower(le); it != le.second; ++it) hit(it->posting);
+    }
+};
+
+/*
+ * Counting index of many expressions. Each expression is split into
+ * conjunctions of atoms (DNF). Atoms testing a variable for equality, set
+ * membership or a range bound are indexed by the variable: entries by the
+ * literal value, sorted threshold arrays for the bounds. Matching probes
+ * the index with the record values, counts satisfied atoms per conjunct,
+ * and conjuncts with all the atoms satisfied are checked against their
+ * residual (not indexed) atoms. Work is proportional to the candidates.
+ * The built index is flat, see view(), so it has an image as rule sets do.
+ */
+class RuleIndex {
+public:
+    // expressions with DNF larger than that are not split
+    static constexpr std::size_t max_conjuncts = 64;
+
+    // add expression, returns its id; ids are dense in order of addition
+    std::uint32_t add(const ast::Expression& e) {
+        auto rule = rules_++;
+        Dnf dnf;
+        if (!split(e, dnf)) dnf = Dnf{{e}};
+        for (auto& atoms : dnf) add_conjunct(rule, atoms);
+        dirty_ = true;
+        return rule;
+    }
+
+    // must be called after adding expressions, before matching
+    void build() {
+        residuals_.build();
+        flat_vars_.clear();
+        nums_.clear();
+        ints_.clear();
+        strs_.clear();
+        chars_.clear();
+        bounds_.clear();
+        lists_.clear();
+        for (auto idx : indexed_) {
+            auto& v = vars_[idx];
+            IndexVar x{};
+            x.var = idx;
+            x.kind = v.kind;
+            for (int b = 0; b < 2; ++b) x.bools[b] = list(v.bools[b]);
+            x.nums = entries(v.nums, nums_, [] (double k, Slice p) { return NumEntry{k, p}; });
+            x.ints = entries(v.ints, ints_, [] (int k, Slice p) { return IntEntry{k, p}; });
+            x.strs = entries(v.strs, strs_, [this] (const std::string& k, Slice p) {
+                Slice value{std::uint32_t(chars_.size()), std::uint32_t(k.size())};
+                chars_ += k;
+                return StrEntry{value, p};
+            });
+            for (int b = 0; b < 4; ++b) {
+                auto r = v.bounds[b];
+                std::sort(r.begin(), r.end());
+                x.bounds[b] = Slice{std::uint32_t(bounds_.size()), std::uint32_t(r.size())};
+                for (auto& t : r) bounds_.push_back(Threshold{t.first, t.second, 0});
+            }
+            flat_vars_.push_back(x);
+        }
+        dirty_ = false;
+    }
+
+    std::uint32_t size() const { return rules_; }
+
+    // view of the built index, valid until it changes
+    RuleIndexView view() const {
+        BOOST_ASSERT_MSG(!dirty_, "index is not built");
+        return RuleIndexView{rules_, flat_vars_, nums_, ints_, strs_, chars_, bounds_, lists_,
+            postings_, conjuncts_, always_, residuals_.view()};
+    }
+
+    // ids of expressions true for the record, in ascending order
+    template<typename Record>
+    void match(const Record& rec, MatchContext& ctx, std::vector<std::uint32_t>& out) const {
+        view().match(rec, ctx, out);
+    }
+
+private:
+    using Dnf = std::vector<std::vector<ast::Expression>>;
+    using Postings = std::vector<std::uint32_t>;
+
+    // atoms by literal, flattened by build()
+    struct VarIndex {
+        IndexKind kind = IndexKind::None;
+        Postings bools[2];
+        std::unordered_map<double, Postings> nums;
+        std::unordered_map<std::string, Postings> strs;
+        std::unordered_map<int, Postings> ints;
+        std::vector<std::pair<double, std::uint32_t>> bounds[4];
+    };
+
+    Slice list(const Postings& p) {
+        Slice s{std::uint32_t(lists_.size()), std::uint32_t(p.size())};
+        lists_.insert(lists_.end(), p.begin(), p.end());
+        return s;
+    }
+
+    // entries of the map sorted by literal, appended to out
+    template<typename Map, typename Entry, typename Make>
+    Slice entries(const Map& m, std::vector<Entry>& out, Make make) {
+        std::vector<const typename Map::value_type*> sorted;
+        for (auto& x : m) sorted.push_back(&x);
+        std::sort(sorted.begin(), sorted.end(), [] (auto a, auto b) { return a->first < b->first; });
+        Slice s{std::uint32_t(out.size()), std::uint32_t(sorted.size())};
+        for (auto x : sorted) out.push_back(make(x->first, list(x->second)));
+        return s;
+    }
+
+    // DNF with not, leaves and constants as atoms, false if too large
+    static bool split(const ast::Expression& e, Dnf& out) {
+        out.clear();
+        if (auto b = boost::get<ast::BoolVal>(&e.get())) {
+            if (b->value) out.emplace_back();
+            return true;
+        }
+        if (auto c = boost::get<x3::forward_ast<ast::Conjunction>>(&e.get())) {
+            out.emplace_back();
+            for (auto& item : c->get().items) {
+                Dnf d, next;
+                if (!split(item, d)) return false;
+                for (auto& a : out) {
+                    for (auto& b : d) {
+                        next.push_back(a);
+                        next.back().insert(next.back().end(), b.begin(), b.end());
+                    }
+                }
+                if (next.size() > max_conjuncts) return false;
+                out.swap(next);
+            }
+            return true;
+        }
+        if (auto d = boost::get<x3::forward_ast<ast::Disjunction>>(&e.get())) {
+            for (auto& item : d->get().items) {
+                Dnf x;
+                if (!split(item, x)) return false;
+                out.insert(out.end(), x.begin(), x.end());
+                if (out.size() > max_conjuncts) return false;
+            }
+            return true;
+        }
+        out.push_back({e});
+        return true;
+    }
+
+    VarIndex& var(ast::VarIdx v, IndexKind kind) {
+        if (v.index >= int(vars_.size())) vars_.resize(v.index + 1);
+        auto& x = vars_[v.index];
+        if (x.kind == IndexKind::None) indexed_.push_back(v.index);
+        BOOST_ASSERT_MSG(x.kind == IndexKind::None || x.kind == kind, "variable type mismatch");
+        x.kind = kind;
+        return x;
+    }
+
+    // adds the atom to the index unless it is not indexable
+    bool index(const ast::Expression& a, std::uint32_t posting) {
+        if (auto v = boost::get<ast::VarIdx>(&a.get())) {
+            var(*v, IndexKind::Bool).bools[1].push_back(posting);
+            return true;
+        }
+        if (auto n = boost::get<x3::forward_ast<ast::Negation>>(&a.get())) {
+            if (auto v = boost::get<ast::VarIdx>(&n->get().expr.get())) {
+                var(*v, IndexKind::Bool).bools[0].push_back(posting);
+                return true;
+            }
+            return false;
+        }
+        if (auto c = boost::get<ast::NumComp>(&a.get())) {
+            double x = boost::apply_visitor([] (auto v) { return double(v); }, c->val);
+            auto& v = var(c->var, IndexKind::Num);
+            switch (c->cmp) {
+            case ast::CompOp::Eq: v.nums[x].push_back(posting); return true;
+            case ast::CompOp::Gt: v.bounds[IndexVar::Gt].emplace_back(x, posting); return true;
+            case ast::CompOp::Ge: v.bounds[IndexVar::Ge].emplace_back(x, posting); return true;
+            case ast::CompOp::Lt: v.bounds[IndexVar::Lt].emplace_back(x, posting); return true;
+            case ast::CompOp::Le: v.bounds[IndexVar::Le].emplace_back(x, posting); return true;
+            case ast::CompOp::Ne: return false;
+            }
+        }
+        if (auto c = boost::get<ast::StrComp>(&a.get())) {
+            if (c->cmp != ast::CompOp::Eq) return false;
+            var(c->var, IndexKind::Str).strs[c->val].push_back(posting);
+            return true;
+        }
+        if (auto s = boost::get<ast::SetExpr>(&a.get())) {
+            if (auto x = boost::get<ast::VarInSet<int>>(s)) {
+                if (x->op != ast::SetOp::In) return false;
+                auto& v = var(x->var, IndexKind::Num);
+                for (auto i : x->set) v.nums[i].push_back(posting);
+                return true;
+            }
+            if (auto x = boost::get<ast::VarInSet<std::string>>(s)) {
+                if (x->op != ast::SetOp::In) return false;
+                auto& v = var(x->var, IndexKind::Str);
+                for (auto& i : x->set) v.strs[i].push_back(posting);
+                return true;
+            }
+            if (auto x = boost::get<ast::ValInSet<int>>(s)) {
+                if (x->op != ast::SetOp::In) return false;
+                var(x->set, IndexKind::Ints).ints[x->val].push_back(posting);
+                return true;
+            }
+            if (auto x = boost::get<ast::ValInSet<std::string>>(s)) {
+                if (x->op != ast::SetOp::In) return false;
+                var(x->set, IndexKind::Strs).strs[x->val].push_back(posting);
+                return true;
+            }
+        }
+        if (auto l = boost::get<ast::ListExpr>(&a.get())) {
+            if (auto x = boost::get<ast::VarVsSet<int>>(l)) {
+                if (x->op != ast::ListOp::OneOf) return false;
+                auto& v = var(x->var, IndexKind::Ints);
+                for (auto i : x->set) v.ints[i].push_back(posting);
+                return true;
+            }
+            if (auto x = boost::get<ast::VarVsSet<std::string>>(l)) {
+                if (x->op != ast::ListOp::OneOf) return false;
+                auto& v = var(x->var, IndexKind::Strs);
+                for (auto& i : x->set) v.strs[i].push_back(posting);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void add_conjunct(std::uint32_t rule, const std::vector<ast::Expression>& atoms) {
+        auto c = std::uint32_t(conjuncts_.size());
+        ast::Conjunction residual;
+        std::uint32_t need = 0;
+        for (auto& a : atoms) {
+            auto posting = std::uint32_t(postings_.size());
+            if (index(a, posting)) {
+                postings_.push_back(c);
+                ++need;
+            } else {
+                residual.items.push_back(a);
+            }
+        }
+        auto r = IndexConjunct::none;
+        if (!residual.items.empty())
+            r = residuals_.add(residual.items.size() == 1 ? residual.items[0] : ast::Expression(residual));
+        conjuncts_.push_back(IndexConjunct{rule, need, r});
+        if (need == 0) always_.push_back(c);
+    }
+
+    std::uint32_t rules_ = 0;
+    bool dirty_ = false;
+    std::vector<VarIndex> vars_;
+    std::vector<int> indexed_;                  // variables with index
+    std::vector<std::uint32_t> postings_;       // posting -> conjunct
+    std::vector<IndexConjunct> conjuncts_;
+    std::vector<std::uint32_t> always_;         // conjuncts with no indexed atoms
+    RuleSet residuals_;                         // residual atoms per conjunct
+
+    // built by build()
+    std::vector<IndexVar> flat_vars_;
+    std::vector<NumEntry> nums_;
+    std::vector<IntEntry> ints_;
+    std::vector<StrEntry> strs_;
+    std::string chars_;
+    std::vector<Threshold> bounds_;
+    std::vector<std::uint32_t> lists_;
+};
+
+} // lexen
@@ -0,0 +1,217 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions engine - rule set with shared predicates
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+#pragma once
+
+#include <unordered_map>
+
+#include "ast_hash.hpp"
+#include "eval.hpp"
+
+namespace lexen {
+
+// scratch space of RuleSet::eval, one per thread
+struct RuleSetContext {
+    std::vector<std::uint64_t> truth;   // per predicate
+    std::vector<std::uint64_t> known;   // per predicate, not null
+    StrKeyCache keys;                   // reset per record
+    // results of extensions, see extension.hpp; not owned
+    ResultCache* ext_cache = nullptr;
+};
+
+namespace detail {
+
+// leaves of an expression in the order compile() emits them
+struct leaf_collector : boost::static_visitor<void> {
+    leaf_collector(std::vector<const ast::Expression*>& l) : leaves(l) {}
+
+    void operator()(const x3::forward_ast<ast::Conjunction>& x) const { all(x.get().items); }
+    void operator()(const x3::forward_ast<ast::Disjunction>& x) const { all(x.get().items); }
+    void operator()(const x3::forward_ast<ast::Negation>& x) const { collect(x.get().expr); }
+    template<typename T>
+    void operator()(const T&) const {}
+
+    void all(const std::vector<ast::Expression>& items) const {
+        for (auto& x : items) collect(x);
+    }
+
+    void collect(const ast::Expression& e) const {
+        if (is_leaf(e)) leaves.push_back(&e);
+        else boost::apply_visitor(*this, e);
+    }
+
+    static bool is_leaf(const ast::Expression& e) {
+        if (auto c = boost::get<x3::forward_ast<ast::Conjunction>>(&e.get()))
+            return is_range(c->get());
+        return !boost::get<ast::BoolVal>(&e.get())
+            && !boost::get<x3::forward_ast<ast::Disjunction>>(&e.get())
+            && !boost::get<x3::forward_ast<ast::Negation>>(&e.get());
+    }
+
+    std::vector<const ast::Expression*>& leaves;
+};
+
+// Evaluates predicate i of preds into the context, returns true if its
+// result or null flag differ from the previous one.
+template<typename P, typename Record>
+inline bool eval_pred(const P& preds, std::size_t i, const Record& rec, RuleSetContext& ctx) {
+    auto& in = preds.code[i];
+    bool null;
+    bool r = test(preds, in, rec, null, &ctx.keys, ctx.ext_cache);
+    auto bit = std::uint64_t(1) << (i % 64);
+    auto truth = !null && r != in.neg ? bit : 0;
+    auto known = !null ? bit : 0;
+    auto& t = ctx.truth[i / 64];
+    auto& k = ctx.known[i / 64];
+    bool changed = (t & bit) != truth || (k & bit) != known;
+    t = (t & ~bit) | truth;
+    k = (k & ~bit) | known;
+    return changed;
+}
+
+// runs code of a rule from its entry over predicate results of the context
+inline bool run_rule(ListView<Instr> code, std::uint32_t pc, const RuleSetContext& ctx) {
+    while (pc < Program::reject) {
+        auto& in = code[pc];
+        auto id = std::uint32_t(in.arg.ival);
+        bool known = ctx.known[id / 64] >> (id % 64) & 1;
+        bool truth = ctx.truth[id / 64] >> (id % 64) & 1;
+        pc = known && truth != in.neg ? in.on_true : in.on_false;
+    }
+    return pc == Program::accept;
+}
+
+// Runs code of a rule as above, evaluating each predicate of preds into
+// the context on its first use, when its stamp is not gen yet.
+template<typename P, typename Record>
+inline bool run_rule(const P& preds, ListView<Instr> code, std::uint32_t pc, const Record& rec,
+    RuleSetContext& ctx, std::uint32_t* stamp, std::uint32_t gen)
+{
+    while (pc < Program::reject) {
+        auto& in = code[pc];
+        auto id = std::uint32_t(in.arg.ival);
+        if (stamp[id] != gen) {
+            stamp[id] = gen;
+            eval_pred(preds, id, rec, ctx);
+        }
+        bool known = ctx.known[id / 64] >> (id % 64) & 1;
+        bool truth = ctx.truth[id / 64] >> (id % 64) & 1;
+        pc = known && truth != in.neg ? in.on_true : in.on_false;
+    }
+    return pc == Program::accept;
+}
+
+// Evaluates each distinct predicate of preds, Program or ProgramView, once
+// into the context, then runs the code of every rule from its entry over
+// the results.
+template<typename P, typename Record>
+inline void eval_rules(const P& preds, ListView<Instr> code, ListView<std::uint32_t> entries,
+    const Record& rec, RuleSetContext& ctx, std::vector<std::uint32_t>& out)
+{
+    auto n = preds.code.size();
+    ctx.truth.assign((n + 63) / 64, 0);
+    ctx.known.assign((n + 63) / 64, 0);
+    ctx.keys.reset();
+    for (std::size_t i = 0; i < n; ++i)
+        eval_pred(preds, i, rec, ctx);
+
+    out.clear();
+    for (std::uint32_t rule = 0; rule < entries.size(); ++rule)
+        if (run_rule(code, entries[rule], ctx)) out.push_back(rule);
+}
+
+} // detail
+
+// Read-only rule set over data owned elsewhere, see RuleSet::view() and
+// RuleSetImage.
+struct RuleSetView {
+    ProgramView preds;                  // one instruction per predicate
+    ListView<Instr> code;               // programs of all expressions
+    ListView<std::uint32_t> entries;    // per expression
+
+    std::uint32_t size() const { return std::uint32_t(entries.size()); }
+
+    // ids of expressions true for the record, in ascending order
+    template<typename Record>
+    void eval(const Record& rec, RuleSetContext& ctx, std::vector<std::uint32_t>& out) const {
+        detail::eval_rules(preds, code, entries, rec, ctx, out);
+    }
+};
+
+/*
+ * Many expressions sharing their predicates. Identical leaves of all the
+ * expressions are stored once; per record each distinct predicate is
+ * evaluated once into a result bitset, then boolean structure of each
+ * expression runs over the bitset. Call build() after adding expressions.
+ */
+class RuleSet {
+public:
+    // add expression, returns its id; ids are dense in order of addition
+    std::uint32_t add(const ast::Expression& e) {
+        std::vector<const ast::Expression*> leaves;
+        detail::leaf_collector(leaves).collect(e);
+
+        auto prog = compile(e);
+        BOOST_ASSERT(prog.code.size() == leaves.size());
+        auto base = std::uint32_t(code_.size());
+        auto reloc = [base] (std::uint32_t pc) { return pc < Program::reject ? pc + base : pc; };
+        for (std::size_t i = 0; i < leaves.size(); ++i) {
+            auto it = ids_.emplace(*leaves[i], std::uint32_t(leaves_.size())).first;
+            if (it->second == leaves_.size()) leaves_.push_back(*leaves[i]);
+            auto in = prog.code[i];
+            // polarity only, own negation of the leaf is part of its result
+            in.neg = in.neg != intrinsic_neg(*leaves[i]);
+            in.op = OpCode::Pred;
+            in.sub = 0;
+            in.var = 0;
+            in.arg.ival = std::int32_t(it->second);
+            in.on_true = reloc(in.on_true);
+            in.on_false = reloc(in.on_false);
+            code_.push_back(in);
+        }
+        entries_.push_back(reloc(prog.entry));
+        return std::uint32_t(entries_.size() - 1);
+    }
+
+    // must be called after adding expressions, before evaluation
+    void build() {
+        preds_ = compile_leaves(leaves_);
+    }
+
+    std::uint32_t size() const { return std::uint32_t(entries_.size()); }
+
+    // number of distinct predicates
+    std::uint32_t predicates() const { return std::uint32_t(leaves_.size()); }
+
+    // ids of expressions true for the record, in ascending order
+    template<typename Record>
+    void eval(const Record& rec, RuleSetContext& ctx, std::vector<std::uint32_t>& out) const {
+        BOOST_ASSERT_MSG(preds_.code.size() == leaves_.size(), "rule set is not built");
+        detail::eval_rules(preds_, code_, entries_, rec, ctx, out);
+    }
+
+    // view of the built rule set, valid until it changes
+    RuleSetView view() const {
+        BOOST_ASSERT_MSG(preds_.code.size() == leaves_.size(), "rule set is not built");
+        return RuleSetView{preds_, code_, entries_};
+    }
+
+private:
+    // negation compile() puts into the leaf instruction itself
+    static bool intrinsic_neg(const ast::Expression& leaf) {
+        Program p = compile(leaf);
+        return p.code[0].neg;
+    }
+
+    std::unordered_map<ast::Expression, std::uint32_t, boost::hash<ast::Expression>> ids_;
+    std::vector<ast::Expression> leaves_;
+    Program preds_;                         // one instruction per predicate
+    std::vector<Instr> code_;               // programs of all expressions
+    std::vector<std::uint32_t> entries_;    // per expression
+};
+
+} // lexen
@@ -0,0 +1,142 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions engine - variables schema
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ast.hpp"
+#include "be.hpp"
+#include "list_view.hpp"
+
+namespace lexen {
+
+// Names, types and fixed slot offsets of variables. Slots of all variables
+// make up a single buffer, see Record. Parsing reads the name tables only,
+// so any number of threads may parse against a schema no one adds to.
+class Schema {
+public:
+    // name tables the parser looks variables up in, by type
+    struct Symbols {
+        ast::Vars bool_var;
+        ast::Vars int_var;
+        ast::Vars num_var;
+        ast::Vars str_var;
+        ast::Vars int_list_var;
+        ast::Vars str_list_var;
+        ast::Vars list_var;
+        ast::Vars var;
+    };
+
+    Schema() = default;
+    // name tables share their storage on copy, so a moved from schema
+    // gets fresh ones and is left empty
+    Schema(const Schema&) = delete;
+    Schema& operator=(const Schema&) = delete;
+    Schema(Schema&& x) : slots_(std::move(x.slots_)), size_(x.size_), symbols_(x.symbols_) {
+        x.clear();
+    }
+    Schema& operator=(Schema&& x) {
+        if (this != &x) {
+            slots_ = std::move(x.slots_);
+            size_ = x.size_;
+            symbols_ = x.symbols_;
+            x.clear();
+        }
+        return *this;
+    }
+
+    // register named variable with the next free index, indices start at 1
+    ast::VarIdx add(const std::string& name, var_type type) {
+        ast::VarIdx var(vars() > 1 ? vars() : 1);
+        switch (type) {
+        case var_type::boolean:
+            symbols_.bool_var.add(name, var);
+            break;
+        case var_type::integer:
+            symbols_.int_var.add(name, var);
+            symbols_.num_var.add(name, var);
+            break;
+        case var_type::realnum:
+            symbols_.num_var.add(name, var);
+            break;
+        case var_type::string:
+            symbols_.str_var.add(name, var);
+            break;
+        case var_type::integers:
+            symbols_.int_list_var.add(name, var);
+            symbols_.list_var.add(name, var);
+            break;
+        case var_type::strings:
+            symbols_.str_list_var.add(name, var);
+            symbols_.list_var.add(name, var);
+            break;
+        }
+        symbols_.var.add(name, var);
+        add(var, type);
+        return var;
+    }
+
+    // register unnamed variable, indices are expected to be dense
+    void add(ast::VarIdx var, var_type type) {
+        if (var.index >= int(slots_.size()))
+            slots_.resize(var.index + 1);
+        auto sz = slot_size(type);
+        size_ = (size_ + sz - 1) / sz * sz;
+        slots_[var.index] = Slot{type, size_, true};
+        size_ += sz;
+    }
+
+    bool has(ast::VarIdx var) const {
+        return var.index >= 0 && var.index < int(slots_.size()) && slots_[var.index].used;
+    }
+
+    var_type type(ast::VarIdx var) const { return slots_[var.index].type; }
+    std::uint32_t offset(ast::VarIdx var) const { return slots_[var.index].offset; }
+
+    // upper bound of variable indices
+    int vars() const { return int(slots_.size()); }
+
+    // size of all slots in bytes
+    std::uint32_t size() const { return size_; }
+
+    const Symbols& symbols() const { return symbols_; }
+
+    static std::uint32_t slot_size(var_type type) {
+        switch (type) {
+        case var_type::boolean:  return sizeof(bool);
+        case var_type::integer:  return sizeof(int);
+        case var_type::realnum:  return sizeof(double);
+        case var_type::string:   return sizeof(std::string_view);
+        case var_type::integers: return sizeof(ListView<int>);
+        case var_type::strings:  return sizeof(ListView<std::string_view>);
+        }
+        return 0;
+    }
+
+private:
+    void clear() {
+        slots_.clear();
+        size_ = 0;
+        symbols_ = Symbols();
+    }
+
+    struct Slot {
+        var_type type;
+        std::uint32_t offset;
+        bool used;
+    };
+
+    std::vector<Slot> slots_;
+    std::uint32_t size_ = 0;
+    Symbols symbols_;
+};
+
+} // lexen
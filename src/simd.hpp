@@ -0,0 +1,311 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions engine - vectorized predicate kernels
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+#pragma once
+
+#include <cmath>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+
+#include "ast.hpp"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define LEXEN_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+/*
+ * Kernels evaluate a predicate over n column values and write result bits,
+ * one per value, into (n + 63) / 64 words. Bits past n are cleared. AVX2
+ * versions are selected at run time, SSE2 is the x86-64 baseline, other
+ * targets use scalar code.
+ */
+
+namespace lexen { namespace simd {
+
+using ast::CompOp;
+
+inline std::size_t words(std::size_t n) { return (n + 63) / 64; }
+
+inline int popcount(std::uint64_t x) { return __builtin_popcountll(x); }
+inline int ctz(std::uint64_t x) { return __builtin_ctzll(x); }
+
+// clear bits past n in the last word
+inline void trim(std::uint64_t* out, std::size_t n) {
+    if (n % 64) out[n / 64] &= (std::uint64_t(1) << (n % 64)) - 1;
+}
+
+template<typename T, typename L>
+inline bool cmp(CompOp op, T a, L b) {
+    switch (op) {
+    case CompOp::Gt: return a >  b;
+    case CompOp::Ge: return a >= b;
+    case CompOp::Lt: return a <  b;
+    case CompOp::Le: return a <= b;
+    case CompOp::Eq: return a == b;
+    case CompOp::Ne: return a != b;
+    }
+    return false;
+}
+
+// scalar tail (or whole) loop starting at word-aligned row i
+template<typename T, typename L>
+inline void cmp_scalar(const T* x, std::size_t i, std::size_t n, CompOp op, L lit, std::uint64_t* out) {
+    for (; i < n; i += 64) {
+        std::uint64_t w = 0;
+        std::size_t m = n - i < 64 ? n - i : 64;
+        for (std::size_t j = 0; j < m; ++j)
+            w |= std::uint64_t(cmp(op, x[i + j], lit)) << j;
+        out[i / 64] = w;
+    }
+}
+
+#ifdef LEXEN_X86_SIMD
+
+// Ge, Le and Ne are computed as negated Lt, Gt and Eq
+inline bool inverted(CompOp op) {
+    return op == CompOp::Ge || op == CompOp::Le || op == CompOp::Ne;
+}
+
+__attribute__((target("avx2")))
+inline void cmp_i32_avx2(const int* x, std::size_t n, CompOp op, int lit, std::uint64_t* out) {
+    const __m256i l = _mm256_set1_epi32(lit);
+    bool inv = inverted(op);
+    std::size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        std::uint64_t w = 0;
+        for (std::size_t j = 0; j < 64; j += 8) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i + j));
+            __m256i r;
+            switch (op) {
+            case CompOp::Gt: case CompOp::Le: r = _mm256_cmpgt_epi32(v, l); break;
+            case CompOp::Lt: case CompOp::Ge: r = _mm256_cmpgt_epi32(l, v); break;
+            default:                          r = _mm256_cmpeq_epi32(v, l); break;
+            }
+            w |= std::uint64_t(_mm256_movemask_ps(_mm256_castsi256_ps(r))) << j;
+        }
+        out[i / 64] = inv ? ~w : w;
+    }
+    cmp_scalar(x, i, n, op, lit, out);
+}
+
+inline void cmp_i32_sse2(const int* x, std::size_t n, CompOp op, int lit, std::uint64_t* out) {
+    const __m128i l = _mm_set1_epi32(lit);
+    bool inv = inverted(op);
+    std::size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        std::uint64_t w = 0;
+        for (std::size_t j = 0; j < 64; j += 4) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i + j));
+            __m128i r;
+            switch (op) {
+            case CompOp::Gt: case CompOp::Le: r = _mm_cmpgt_epi32(v, l); break;
+            case CompOp::Lt: case CompOp::Ge: r = _mm_cmplt_epi32(v, l); break;
+            default:                          r = _mm_cmpeq_epi32(v, l); break;
+            }
+            w |= std::uint64_t(_mm_movemask_ps(_mm_castsi128_ps(r))) << j;
+        }
+        out[i / 64] = inv ? ~w : w;
+    }
+    cmp_scalar(x, i, n, op, lit, out);
+}
+
+__attribute__((target("avx2")))
+inline void cmp_f64_avx2(const double* x, std::size_t n, CompOp op, double lit, std::uint64_t* out) {
+    const __m256d l = _mm256_set1_pd(lit);
+    std::size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        std::uint64_t w = 0;
+        for (std::size_t j = 0; j < 64; j += 4) {
+            __m256d v = _mm256_loadu_pd(x + i + j);
+            __m256d r;
+            switch (op) {
+            case CompOp::Gt: r = _mm256_cmp_pd(v, l, _CMP_GT_OQ);  break;
+            case CompOp::Ge: r = _mm256_cmp_pd(v, l, _CMP_GE_OQ);  break;
+            case CompOp::Lt: r = _mm256_cmp_pd(v, l, _CMP_LT_OQ);  break;
+            case CompOp::Le: r = _mm256_cmp_pd(v, l, _CMP_LE_OQ);  break;
+            case CompOp::Eq: r = _mm256_cmp_pd(v, l, _CMP_EQ_OQ);  break;
+            default:         r = _mm256_cmp_pd(v, l, _CMP_NEQ_UQ); break;
+            }
+            w |= std::uint64_t(_mm256_movemask_pd(r)) << j;
+        }
+        out[i / 64] = w;
+    }
+    cmp_scalar(x, i, n, op, lit, out);
+}
+
+inline void cmp_f64_sse2(const double* x, std::size_t n, CompOp op, double lit, std::uint64_t* out) {
+    const __m128d l = _mm_set1_pd(lit);
+    std::size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        std::uint64_t w = 0;
+        for (std::size_t j = 0; j < 64; j += 2) {
+            __m128d v = _mm_loadu_pd(x + i + j);
+            __m128d r;
+            switch (op) {
+            case CompOp::Gt: r = _mm_cmpgt_pd(v, l);  break;
+            case CompOp::Ge: r = _mm_cmpge_pd(v, l);  break;
+            case CompOp::Lt: r = _mm_cmplt_pd(v, l);  break;
+            case CompOp::Le: r = _mm_cmple_pd(v, l);  break;
+            case CompOp::Eq: r = _mm_cmpeq_pd(v, l);  break;
+            default:         r = _mm_cmpneq_pd(v, l); break;
+            }
+            w |= std::uint64_t(_mm_movemask_pd(r)) << j;
+        }
+        out[i / 64] = w;
+    }
+    cmp_scalar(x, i, n, op, lit, out);
+}
+
+__attribute__((target("avx2")))
+inline void bools_avx2(const bool* x, std::size_t n, std::uint64_t* out) {
+    const __m256i zero = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        auto p = reinterpret_cast<const __m256i*>(x + i);
+        std::uint32_t lo = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(p), zero));
+        std::uint32_t hi = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(p + 1), zero));
+        out[i / 64] = ~(std::uint64_t(hi) << 32 | lo);
+    }
+    cmp_scalar(x, i, n, CompOp::Ne, false, out);
+}
+
+inline void bools_sse2(const bool* x, std::size_t n, std::uint64_t* out) {
+    const __m128i zero = _mm_setzero_si128();
+    std::size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        std::uint64_t w = 0;
+        for (std::size_t j = 0; j < 64; j += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i + j));
+            w |= std::uint64_t(std::uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)))) << j;
+        }
+        out[i / 64] = ~w;
+    }
+    cmp_scalar(x, i, n, CompOp::Ne, false, out);
+}
+
+__attribute__((target("avx2")))
+inline bool find_i32_avx2(const int* x, std::size_t n, int v) {
+    const __m256i l = _mm256_set1_epi32(v);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i r = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i)), l);
+        if (_mm256_movemask_epi8(r)) return true;
+    }
+    for (; i < n; ++i)
+        if (x[i] == v) return true;
+    return false;
+}
+
+inline bool find_i32_sse2(const int* x, std::size_t n, int v) {
+    const __m128i l = _mm_set1_epi32(v);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i r = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i)), l);
+        if (_mm_movemask_epi8(r)) return true;
+    }
+    for (; i < n; ++i)
+        if (x[i] == v) return true;
+    return false;
+}
+
+inline bool has_avx2() {
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+}
+
+#endif // LEXEN_X86_SIMD
+
+// x[i] <op> lit
+inline void cmp_i32(const int* x, std::size_t n, CompOp op, int lit, std::uint64_t* out) {
+#ifdef LEXEN_X86_SIMD
+    if (has_avx2()) cmp_i32_avx2(x, n, op, lit, out);
+    else cmp_i32_sse2(x, n, op, lit, out);
+#else
+    cmp_scalar(x, 0, n, op, lit, out);
+#endif
+    trim(out, n);
+}
+
+inline void cmp_f64(const double* x, std::size_t n, CompOp op, double lit, std::uint64_t* out) {
+#ifdef LEXEN_X86_SIMD
+    if (has_avx2()) cmp_f64_avx2(x, n, op, lit, out);
+    else cmp_f64_sse2(x, n, op, lit, out);
+#else
+    cmp_scalar(x, 0, n, op, lit, out);
+#endif
+    trim(out, n);
+}
+
+// x[i] != false
+inline void bools(const bool* x, std::size_t n, std::uint64_t* out) {
+#ifdef LEXEN_X86_SIMD
+    if (has_avx2()) bools_avx2(x, n, out);
+    else bools_sse2(x, n, out);
+#else
+    cmp_scalar(x, 0, n, CompOp::Ne, false, out);
+#endif
+    trim(out, n);
+}
+
+// v is one of x[0..n), short arrays are scanned without dispatch
+inline bool find_i32(const int* x, std::size_t n, int v) {
+#ifdef LEXEN_X86_SIMD
+    if (n >= 16) return has_avx2() ? find_i32_avx2(x, n, v) : find_i32_sse2(x, n, v);
+#endif
+    for (std::size_t i = 0; i < n; ++i)
+        if (x[i] == v) return true;
+    return false;
+}
+
+// any bit of [lo, hi) is set
+inline bool any(const std::uint64_t* b, std::size_t lo, std::size_t hi) {
+    if (lo >= hi) return false;
+    auto first = lo / 64, last = (hi - 1) / 64;
+    auto head = ~std::uint64_t(0) << (lo % 64);
+    auto tail = ~std::uint64_t(0) >> (63 - (hi - 1) % 64);
+    if (first == last) return b[first] & head & tail;
+    if (b[first] & head) return true;
+    for (auto i = first + 1; i < last; ++i)
+        if (b[i]) return true;
+    return b[last] & tail;
+}
+
+inline void fill(std::uint64_t* out, std::size_t n, bool value) {
+    for (std::size_t i = 0; i < words(n); ++i) out[i] = value ? ~std::uint64_t(0) : 0;
+    trim(out, n);
+}
+
+// Integer values vs real literal: reduced to an integer comparison with an
+// adjusted literal, or to a constant when no integer can satisfy it.
+inline void cmp_i32(const int* x, std::size_t n, CompOp op, double lit, std::uint64_t* out) {
+    if (lit >= INT_MIN && lit <= INT_MAX && double(int(lit)) == lit)
+        return cmp_i32(x, n, op, int(lit), out);
+    switch (op) {
+    case CompOp::Gt:
+    case CompOp::Ge: {
+        // x >= 5.5 is x > 5
+        double fl = std::floor(lit);
+        if (std::isnan(lit) || fl >= INT_MAX) return fill(out, n, false);
+        if (fl < INT_MIN) return fill(out, n, true);
+        return cmp_i32(x, n, CompOp::Gt, int(fl), out);
+    }
+    case CompOp::Lt:
+    case CompOp::Le: {
+        // x <= 5.5 is x < 6
+        double cl = std::ceil(lit);
+        if (std::isnan(lit) || cl <= INT_MIN) return fill(out, n, false);
+        if (cl > INT_MAX) return fill(out, n, true);
+        return cmp_i32(x, n, CompOp::Lt, int(cl), out);
+    }
+    case CompOp::Eq: return fill(out, n, false);
+    case CompOp::Ne: return fill(out, n, true);
+    }
+}
+
+} } // lexen::simd
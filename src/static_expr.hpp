@@ -0,0 +1,519 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions engine - expressions fixed at compile time
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "be.hpp"
+#include "optimize.hpp"
+#include "schema.hpp"
+
+namespace lexen {
+
+/*
+ * Expression templates for filters known at build time. Variables are
+ * typed constants carrying their schema index, e.g.
+ *
+ *   constexpr fixed::IntVar<1> width;
+ *   constexpr fixed::StrVar<2> user;
+ *   auto f = width > 10 && (user == "root" || fixed::is_null(user));
+ *
+ * The type of f is the whole predicate tree, and f(rec) is plain inline
+ * code the compiler folds and vectorizes without any dispatch.
+ * Evaluation is three-valued in the same way as programs: a comparison
+ * of a null variable is unknown, and unknown results count as false at
+ * the top. Each node has its AST counterpart, expression(), and check()
+ * ties the tree to the text of the filter parsed by the runtime grammar,
+ * so the two can not silently diverge.
+ *
+ * String literals are not copied, the tree views them: use string
+ * literals or strings outliving the filter. Temporary std::string
+ * literals do not compile.
+ */
+namespace fixed {
+
+// three-valued result
+struct Tri {
+    bool known;
+    bool value;
+};
+
+constexpr Tri unknown{false, false};
+
+constexpr Tri tri(bool x) { return Tri{true, x}; }
+
+template<typename D>
+struct Expr {
+    const D& self() const { return static_cast<const D&>(*this); }
+
+    // unknown result counts as false
+    template<typename Record>
+    bool operator()(const Record& rec) const {
+        auto r = self().eval(rec);
+        return r.known && r.value;
+    }
+
+    // items of the and/or list the node is part of, see And and Or
+    void and_items(std::vector<ast::Expression>& v) const { v.push_back(self().expression()); }
+    void or_items(std::vector<ast::Expression>& v) const { v.push_back(self().expression()); }
+};
+
+// variable of the schema, I is its index
+template<int I, var_type T>
+struct Var {
+    static constexpr int index = I;
+    static constexpr var_type type = T;
+};
+
+// boolean variable is a predicate of its own
+template<int I>
+struct Var<I, var_type::boolean> : Expr<Var<I, var_type::boolean>> {
+    static constexpr int index = I;
+    static constexpr var_type type = var_type::boolean;
+
+    template<typename Record>
+    Tri eval(const Record& rec) const {
+        ast::VarIdx var(I);
+        return rec.is_null(var) ? unknown : tri(rec.get_bool(var));
+    }
+
+    ast::Expression expression() const { return ast::Expression(ast::VarIdx(I)); }
+};
+
+template<int I> using BoolVar = Var<I, var_type::boolean>;
+template<int I> using IntVar = Var<I, var_type::integer>;
+template<int I> using RealVar = Var<I, var_type::realnum>;
+template<int I> using StrVar = Var<I, var_type::string>;
+template<int I> using IntsVar = Var<I, var_type::integers>;
+template<int I> using StrsVar = Var<I, var_type::strings>;
+
+namespace detail {
+
+template<var_type T>
+constexpr bool is_num = T == var_type::integer || T == var_type::realnum;
+
+template<ast::CompOp Op>
+constexpr bool cmp(double a, double b) {
+    switch (Op) {
+    case ast::CompOp::Gt: return a >  b;
+    case ast::CompOp::Ge: return a >= b;
+    case ast::CompOp::Lt: return a <  b;
+    case ast::CompOp::Le: return a <= b;
+    case ast::CompOp::Eq: return a == b;
+    case ast::CompOp::Ne: return a != b;
+    }
+    return false;
+}
+
+// literal type of the grammar's int_ | strict_double: int stays int, floating
+// point becomes double, other types would be narrowed and do not compile
+template<typename L>
+using num_lit = std::enable_if_t<std::is_same_v<L, int> || std::is_floating_point_v<L>,
+    std::conditional_t<std::is_same_v<L, int>, int, double>>;
+
+template<typename T, std::size_t N>
+std::vector<T> to_vector(const std::array<T, N>& a) {
+    return std::vector<T>(a.begin(), a.end());
+}
+
+template<std::size_t N>
+std::vector<std::string> to_vector(const std::array<std::string_view, N>& a) {
+    return std::vector<std::string>(a.begin(), a.end());
+}
+
+template<typename List, typename T>
+bool contains(const List& list, const T& x) {
+    for (auto&& y : list)
+        if (y == x) return true;
+    return false;
+}
+
+} // detail
+
+// numeric variable vs literal of type L (int or double)
+template<int I, ast::CompOp Op, typename L>
+struct NumCmp : Expr<NumCmp<I, Op, L>> {
+    L val;
+
+    explicit constexpr NumCmp(L x) : val(x) {}
+
+    template<typename Record>
+    Tri eval(const Record& rec) const {
+        ast::VarIdx var(I);
+        return rec.is_null(var) ? unknown : tri(detail::cmp<Op>(rec.get_num(var), double(val)));
+    }
+
+    ast::Expression expression() const {
+        return ast::Expression(ast::NumComp{ast::VarIdx(I), ast::NumVal(val), Op});
+    }
+};
+
+// string variable vs literal, Op is Eq or Ne
+template<int I, ast::CompOp Op>
+struct StrCmp : Expr<StrCmp<I, Op>> {
+    std::string_view val;
+
+    explicit constexpr StrCmp(std::string_view x) : val(x) {}
+
+    template<typename Record>
+    Tri eval(const Record& rec) const {
+        ast::VarIdx var(I);
+        if (rec.is_null(var)) return unknown;
+        return tri((std::string_view(rec.get_str(var)) == val) == (Op == ast::CompOp::Eq));
+    }
+
+    ast::Expression expression() const {
+        return ast::Expression(ast::StrComp{ast::VarIdx(I), std::string(val), Op});
+    }
+};
+
+// is null, is not null, is empty; known even for null variable
+template<int I, ast::UnaryOp Op>
+struct Unary : Expr<Unary<I, Op>> {
+    template<typename Record>
+    Tri eval(const Record& rec) const {
+        ast::VarIdx var(I);
+        switch (Op) {
+        case ast::UnaryOp::IsNull: return tri(rec.is_null(var));
+        case ast::UnaryOp::IsNotNull: return tri(!rec.is_null(var));
+        case ast::UnaryOp::IsEmpty: return tri(rec.is_null(var) || rec.is_empty(var));
+        }
+        return unknown;
+    }
+
+    ast::Expression expression() const {
+        return ast::Expression(ast::UnaryExpr{Op, ast::VarIdx(I)});
+    }
+};
+
+// integer or string variable in literal set of N elements of type T
+template<int I, ast::SetOp Op, typename T, std::size_t N>
+struct VarInSet : Expr<VarInSet<I, Op, T, N>> {
+    std::array<T, N> set;
+
+    template<typename Record>
+    Tri eval(const Record& rec) const {
+        ast::VarIdx var(I);
+        if (rec.is_null(var)) return unknown;
+        bool in;
+        if constexpr (std::is_same_v<T, int>) {
+            in = detail::contains(set, rec.get_num(var));
+        } else {
+            in = detail::contains(set, std::string_view(rec.get_str(var)));
+        }
+        return tri(in == (Op == ast::SetOp::In));
+    }
+
+    ast::Expression expression() const {
+        return ast::Expression(ast::SetExpr(ast::VarInSet<ast_type>(ast::VarIdx(I), Op, detail::to_vector(set))));
+    }
+
+private:
+    using ast_type = std::conditional_t<std::is_same_v<T, int>, int, std::string>;
+};
+
+// literal in list variable
+template<int I, ast::SetOp Op, typename T>
+struct ValInList : Expr<ValInList<I, Op, T>> {
+    T val;
+
+    explicit constexpr ValInList(T x) : val(x) {}
+
+    template<typename Record>
+    Tri eval(const Record& rec) const {
+        ast::VarIdx var(I);
+        if (rec.is_null(var)) return unknown;
+        bool in;
+        if constexpr (std::is_same_v<T, int>)
+            in = detail::contains(rec.get_ints(var), val);
+        else
+            in = detail::contains(rec.get_strs(var), val);
+        return tri(in == (Op == ast::SetOp::In));
+    }
+
+    ast::Expression expression() const {
+        using ast_type = std::conditional_t<std::is_same_v<T, int>, int, std::string>;
+        return ast::Expression(ast::SetExpr(ast::ValInSet<ast_type>(ast_type(val), Op, ast::VarIdx(I))));
+    }
+};
+
+// list variable one of, all of or none of literal set
+template<int I, ast::ListOp Op, typename T, std::size_t N>
+struct ListVsSet : Expr<ListVsSet<I, Op, T, N>> {
+    std::array<T, N> set;
+
+    template<typename Record>
+    Tri eval(const Record& rec) const {
+        ast::VarIdx var(I);
+        if (rec.is_null(var)) return unknown;
+        if constexpr (std::is_same_v<T, int>)
+            return tri(test(rec.get_ints(var)));
+        else
+            return tri(test(rec.get_strs(var)));
+    }
+
+    ast::Expression expression() const {
+        using ast_type = std::conditional_t<std::is_same_v<T, int>, int, std::string>;
+        return ast::Expression(ast::ListExpr(ast::VarVsSet<ast_type>(ast::VarIdx(I), Op, detail::to_vector(set))));
+    }
+
+private:
+    template<typename List>
+    bool test(const List& list) const {
+        if (Op == ast::ListOp::AllOf) {
+            for (auto& x : set)
+                if (!detail::contains(list, x)) return false;
+            return true;
+        }
+        bool one = false;
+        for (auto&& x : list)
+            if (detail::contains(set, x)) {
+                one = true;
+                break;
+            }
+        return one == (Op == ast::ListOp::OneOf);
+    }
+};
+
+template<typename A, typename B>
+struct And : Expr<And<A, B>> {
+    A a;
+    B b;
+
+    constexpr And(const A& x, const B& y) : a(x), b(y) {}
+
+    template<typename Record>
+    Tri eval(const Record& rec) const {
+        auto x = a.eval(rec);
+        if (x.known && !x.value) return x;
+        auto y = b.eval(rec);
+        if (y.known && !y.value) return y;
+        return x.known ? y : x;
+    }
+
+    void and_items(std::vector<ast::Expression>& v) const {
+        a.and_items(v);
+        b.and_items(v);
+    }
+
+    // nested and of the tree is a single conjunction, as parsed from a and b and c
+    ast::Expression expression() const {
+        ast::Conjunction c;
+        and_items(c.items);
+        return ast::Expression(c);
+    }
+};
+
+template<typename A, typename B>
+struct Or : Expr<Or<A, B>> {
+    A a;
+    B b;
+
+    constexpr Or(const A& x, const B& y) : a(x), b(y) {}
+
+    template<typename Record>
+    Tri eval(const Record& rec) const {
+        auto x = a.eval(rec);
+        if (x.known && x.value) return x;
+        auto y = b.eval(rec);
+        if (y.known && y.value) return y;
+        return x.known ? y : x;
+    }
+
+    void or_items(std::vector<ast::Expression>& v) const {
+        a.or_items(v);
+        b.or_items(v);
+    }
+
+    ast::Expression expression() const {
+        ast::Disjunction d;
+        or_items(d.items);
+        return ast::Expression(d);
+    }
+};
+
+template<typename A>
+struct Not : Expr<Not<A>> {
+    A a;
+
+    explicit constexpr Not(const A& x) : a(x) {}
+
+    template<typename Record>
+    Tri eval(const Record& rec) const {
+        auto x = a.eval(rec);
+        return Tri{x.known, !x.value};
+    }
+
+    ast::Expression expression() const {
+        return ast::Expression(ast::Negation{a.expression()});
+    }
+};
+
+template<typename A, typename B>
+constexpr And<A, B> operator&&(const Expr<A>& a, const Expr<B>& b) { return And<A, B>(a.self(), b.self()); }
+
+template<typename A, typename B>
+constexpr Or<A, B> operator||(const Expr<A>& a, const Expr<B>& b) { return Or<A, B>(a.self(), b.self()); }
+
+template<typename A>
+constexpr Not<A> operator!(const Expr<A>& a) { return Not<A>(a.self()); }
+
+// var op literal and literal op var, same as the grammar's num_comp and
+// str_comp; only = and <> apply to strings
+#define LEXEN_FIXED_CMP(OP, CMP, PMC) \
+    template<int I, var_type T, typename L, typename = std::enable_if_t<detail::is_num<T>>> \
+    constexpr NumCmp<I, ast::CompOp::CMP, detail::num_lit<L>> operator OP(Var<I, T>, L x) { \
+        return NumCmp<I, ast::CompOp::CMP, detail::num_lit<L>>(detail::num_lit<L>(x)); \
+    } \
+    template<int I, var_type T, typename L, typename = std::enable_if_t<detail::is_num<T>>> \
+    constexpr NumCmp<I, ast::CompOp::PMC, detail::num_lit<L>> operator OP(L x, Var<I, T>) { \
+        return NumCmp<I, ast::CompOp::PMC, detail::num_lit<L>>(detail::num_lit<L>(x)); \
+    }
+
+LEXEN_FIXED_CMP(>,  Gt, Lt)
+LEXEN_FIXED_CMP(>=, Ge, Le)
+LEXEN_FIXED_CMP(<,  Lt, Gt)
+LEXEN_FIXED_CMP(<=, Le, Ge)
+LEXEN_FIXED_CMP(==, Eq, Eq)
+LEXEN_FIXED_CMP(!=, Ne, Ne)
+
+#undef LEXEN_FIXED_CMP
+
+template<int I>
+constexpr StrCmp<I, ast::CompOp::Eq> operator==(StrVar<I>, std::string_view x) { return StrCmp<I, ast::CompOp::Eq>(x); }
+template<int I>
+constexpr StrCmp<I, ast::CompOp::Eq> operator==(std::string_view x, StrVar<I>) { return StrCmp<I, ast::CompOp::Eq>(x); }
+template<int I>
+constexpr StrCmp<I, ast::CompOp::Ne> operator!=(StrVar<I>, std::string_view x) { return StrCmp<I, ast::CompOp::Ne>(x); }
+template<int I>
+constexpr StrCmp<I, ast::CompOp::Ne> operator!=(std::string_view x, StrVar<I>) { return StrCmp<I, ast::CompOp::Ne>(x); }
+
+namespace detail {
+// rvalue std::string, the tree would view a destroyed string
+template<typename S>
+using temp_str = std::enable_if_t<std::is_same_v<S, std::string>>;
+}
+
+template<int I, typename S, typename = detail::temp_str<S>> void operator==(StrVar<I>, S&&) = delete;
+template<int I, typename S, typename = detail::temp_str<S>> void operator==(S&&, StrVar<I>) = delete;
+template<int I, typename S, typename = detail::temp_str<S>> void operator!=(StrVar<I>, S&&) = delete;
+template<int I, typename S, typename = detail::temp_str<S>> void operator!=(S&&, StrVar<I>) = delete;
+
+template<int I, var_type T>
+constexpr Unary<I, ast::UnaryOp::IsNull> is_null(Var<I, T>) { return {}; }
+
+template<int I, var_type T>
+constexpr Unary<I, ast::UnaryOp::IsNotNull> is_not_null(Var<I, T>) { return {}; }
+
+template<int I, var_type T, typename = std::enable_if_t<T == var_type::integers || T == var_type::strings>>
+constexpr Unary<I, ast::UnaryOp::IsEmpty> is_empty(Var<I, T>) { return {}; }
+
+namespace detail {
+
+template<ast::SetOp Op, int I, std::size_t N>
+constexpr VarInSet<I, Op, int, N> var_in(const int (&set)[N]) {
+    VarInSet<I, Op, int, N> x{};
+    for (std::size_t i = 0; i < N; ++i) x.set[i] = set[i];
+    return x;
+}
+
+template<ast::SetOp Op, int I, std::size_t N>
+constexpr VarInSet<I, Op, std::string_view, N> var_in(const char* const (&set)[N]) {
+    VarInSet<I, Op, std::string_view, N> x{};
+    for (std::size_t i = 0; i < N; ++i) x.set[i] = set[i];
+    return x;
+}
+
+template<ast::ListOp Op, int I, std::size_t N>
+constexpr ListVsSet<I, Op, int, N> list_vs(const int (&set)[N]) {
+    ListVsSet<I, Op, int, N> x{};
+    for (std::size_t i = 0; i < N; ++i) x.set[i] = set[i];
+    return x;
+}
+
+template<ast::ListOp Op, int I, std::size_t N>
+constexpr ListVsSet<I, Op, std::string_view, N> list_vs(const char* const (&set)[N]) {
+    ListVsSet<I, Op, std::string_view, N> x{};
+    for (std::size_t i = 0; i < N; ++i) x.set[i] = set[i];
+    return x;
+}
+
+} // detail
+
+// x in (1, 2, 3), x not in ('a', 'b')
+template<int I, std::size_t N>
+constexpr auto in(IntVar<I>, const int (&set)[N]) { return detail::var_in<ast::SetOp::In, I>(set); }
+template<int I, std::size_t N>
+constexpr auto not_in(IntVar<I>, const int (&set)[N]) { return detail::var_in<ast::SetOp::NotIn, I>(set); }
+template<int I, std::size_t N>
+constexpr auto in(StrVar<I>, const char* const (&set)[N]) { return detail::var_in<ast::SetOp::In, I>(set); }
+template<int I, std::size_t N>
+constexpr auto not_in(StrVar<I>, const char* const (&set)[N]) { return detail::var_in<ast::SetOp::NotIn, I>(set); }
+
+// 3 in list, 'a' not in list
+template<int I>
+constexpr ValInList<I, ast::SetOp::In, int> in(int x, IntsVar<I>) { return ValInList<I, ast::SetOp::In, int>(x); }
+template<int I>
+constexpr ValInList<I, ast::SetOp::NotIn, int> not_in(int x, IntsVar<I>) { return ValInList<I, ast::SetOp::NotIn, int>(x); }
+template<int I>
+constexpr ValInList<I, ast::SetOp::In, std::string_view> in(std::string_view x, StrsVar<I>) {
+    return ValInList<I, ast::SetOp::In, std::string_view>(x);
+}
+template<int I>
+constexpr ValInList<I, ast::SetOp::NotIn, std::string_view> not_in(std::string_view x, StrsVar<I>) {
+    return ValInList<I, ast::SetOp::NotIn, std::string_view>(x);
+}
+template<int I, typename S, typename = detail::temp_str<S>> void in(S&&, StrsVar<I>) = delete;
+template<int I, typename S, typename = detail::temp_str<S>> void not_in(S&&, StrsVar<I>) = delete;
+
+// list one of (...), all of (...), none of (...)
+#define LEXEN_FIXED_LIST(NAME, OP) \
+    template<int I, std::size_t N> \
+    constexpr auto NAME(IntsVar<I>, const int (&set)[N]) { return detail::list_vs<ast::ListOp::OP, I>(set); } \
+    template<int I, std::size_t N> \
+    constexpr auto NAME(StrsVar<I>, const char* const (&set)[N]) { return detail::list_vs<ast::ListOp::OP, I>(set); }
+
+LEXEN_FIXED_LIST(one_of, OneOf)
+LEXEN_FIXED_LIST(all_of, AllOf)
+LEXEN_FIXED_LIST(none_of, NoneOf)
+
+#undef LEXEN_FIXED_LIST
+
+// evaluate against a record, same as e(rec); qualify the call, ADL on
+// the record finds lexen::eval() of programs as well
+template<typename E, typename Record>
+inline bool eval(const Expr<E>& e, const Record& rec) {
+    return e(rec);
+}
+
+/*
+ * True if the text parses with the schema into the same expression as the
+ * tree, after both are put through optimize() so that grouping of and/or
+ * does not matter. Meant for a unit test or start-up assertion next to the
+ * declaration of a fixed filter, with its text kept in a single place:
+ *
+ *   BOOST_ASSERT(fixed::check(f, "width > 10 and (user = 'root' or user is null)", schema));
+ *
+ * Since the parser only resolves a name to a variable of the matching type,
+ * equality also proves the declared types and indices agree with the schema.
+ */
+template<typename E>
+inline bool check(const Expr<E>& e, const std::string& src, const Schema& schema) {
+    ast::Expression parsed;
+    if (!parse_str(src, parsed, schema)) return false;
+    return optimize(parsed, schema) == optimize(e.self().expression(), schema);
+}
+
+} // fixed
+
+} // lexen
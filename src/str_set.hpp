@@ -0,0 +1,135 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions engine - string set lookup tables
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+namespace lexen {
+
+// Hash and first 8 bytes (zero padded) of a string. The hash does not
+// depend on the set, so a key computed once serves every set.
+struct StrKey {
+    std::uint64_t hash;
+    std::uint64_t prefix;
+};
+
+inline std::uint64_t str_mix(std::uint64_t h) {
+    h ^= h >> 31;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 29;
+    return h;
+}
+
+inline std::uint64_t str_word(const char* s, std::size_t n) {
+    std::uint64_t w = 0;
+    std::memcpy(&w, s, n < 8 ? n : 8);
+    return w;
+}
+
+inline StrKey str_key(std::string_view s) {
+    auto n = s.size();
+    std::uint64_t h = 0x9e3779b97f4a7c15ull ^ n;
+    for (std::size_t i = 0; i < n; i += 8)
+        h = str_mix(h ^ str_word(s.data() + i, n - i));
+    return StrKey{str_mix(h * 0x94d049bb133111ebull), str_word(s.data(), n)};
+}
+
+// Slot of a string set table; a string of the set is in the program arena
+// at offset. Empty slots have size of npos.
+struct StrSlot {
+    static constexpr std::uint32_t npos = 0xFFFFFFFFu;
+
+    std::uint64_t prefix;
+    std::uint32_t offset;
+    std::uint32_t size;
+};
+
+// Literal string set: sorted strings of the set, and open addressing
+// table of the strings with linear probing, loaded at most by half.
+struct StrSet {
+    std::uint32_t strs;     // offset of the sorted strings in the pool
+    std::uint32_t size;     // number of strings
+    std::uint32_t slots;    // offset of the table in the pool
+    std::uint32_t mask;     // table size - 1
+};
+
+// adds table of the strings of the arena to the slot pool
+inline StrSet make_str_set(std::vector<StrSlot>& pool, const std::string_view& arena,
+    std::uint32_t strs, const std::vector<std::pair<std::uint32_t, std::uint32_t>>& items)
+{
+    std::uint32_t cap = 2;
+    while (cap < 2 * items.size()) cap *= 2;
+    StrSet set{strs, std::uint32_t(items.size()), std::uint32_t(pool.size()), cap - 1};
+    pool.resize(pool.size() + cap, StrSlot{0, 0, StrSlot::npos});
+    auto table = pool.data() + set.slots;
+    for (auto& item : items) {
+        auto k = str_key(arena.substr(item.first, item.second));
+        auto i = k.hash & set.mask;
+        while (table[i].size != StrSlot::npos) i = (i + 1) & set.mask;
+        table[i] = StrSlot{k.prefix, item.first, item.second};
+    }
+    return set;
+}
+
+// Slot of a string with its key in the table, or npos. Only strings of
+// equal size and prefix are compared byte by byte.
+inline std::uint32_t find_slot(const StrSet& set, const StrSlot* pool, const char* arena, std::string_view s,
+    const StrKey& k)
+{
+    auto table = pool + set.slots;
+    for (auto i = std::uint32_t(k.hash & set.mask); table[i].size != StrSlot::npos; i = (i + 1) & set.mask) {
+        auto& x = table[i];
+        if (x.size == s.size() && x.prefix == k.prefix
+            && (s.size() <= 8 || std::memcmp(arena + x.offset + 8, s.data() + 8, s.size() - 8) == 0))
+            return i;
+    }
+    return StrSlot::npos;
+}
+
+inline bool find(const StrSet& set, const StrSlot* pool, const char* arena, std::string_view s, const StrKey& k) {
+    return find_slot(set, pool, arena, s, k) != StrSlot::npos;
+}
+
+// Keys of string variables computed during one evaluation, direct mapped
+// by variable index, and scratch bits for large set lookups. Reset before
+// evaluating each record; the scratch survives resets, so a cache reused
+// for many records allocates only when a larger set is met.
+class StrKeyCache {
+public:
+    StrKeyCache() { reset(); }
+
+    void reset() {
+        for (auto& x : vars_) x = -1;
+    }
+
+    const StrKey& get(int var, std::string_view s) {
+        auto i = std::size_t(var) % size;
+        if (vars_[i] != var) {
+            vars_[i] = var;
+            keys_[i] = str_key(s);
+        }
+        return keys_[i];
+    }
+
+    // zeroed bits, valid until the next call
+    std::uint64_t* bits(std::size_t words) {
+        bits_.assign(words, 0);     // keeps the capacity
+        return bits_.data();
+    }
+
+private:
+    static constexpr std::size_t size = 8;
+    int vars_[size];
+    StrKey keys_[size];
+    std::vector<std::uint64_t> bits_;
+};
+
+} // lexen
@@ -0,0 +1,174 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions engine - thread pool
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lexen {
+
+// Fixed number of workers running submitted tasks in order of submission.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threads = std::thread::hardware_concurrency()) {
+        if (threads == 0) threads = 1;
+        for (unsigned i = 0; i < threads; ++i)
+            workers_.emplace_back([this] { work(); });
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        ready_.notify_all();
+        for (auto& t : workers_) t.join();
+    }
+
+    unsigned size() const { return unsigned(workers_.size()); }
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.push_back(std::move(task));
+            ++pending_;
+        }
+        ready_.notify_one();
+    }
+
+    // waits until all submitted tasks are done
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return pending_ == 0; });
+    }
+
+private:
+    void work() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                ready_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+                if (tasks_.empty()) return;
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--pending_ == 0) done_.notify_all();
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> tasks_;
+    std::size_t pending_ = 0;   // submitted, not finished
+    bool stop_ = false;
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::condition_variable done_;
+};
+
+// Hands out items in order of requests, to whichever worker asks.
+class SharedSchedule {
+public:
+    SharedSchedule(std::size_t n, unsigned) : items_(n) {}
+
+    bool next(unsigned, std::size_t& item) { return (item = next_++) < items_; }
+
+private:
+    std::size_t items_;
+    std::atomic<std::size_t> next_{0};
+};
+
+namespace detail {
+
+// state of one parallel_run(), shared with its pool tasks, which may start
+// only after it returned; they touch f only once the schedule gave them an
+// item, and parallel_run() does not return before that item is done
+template<typename Schedule>
+struct ParallelRun {
+    ParallelRun(std::size_t n, unsigned workers) : items(n), schedule(n, workers) {}
+
+    std::size_t items;
+    Schedule schedule;
+    std::atomic<unsigned> next{1};          // worker of next task
+    std::atomic<std::size_t> finished{0};   // items done or skipped
+    std::atomic<bool> failed{false};        // items left are skipped
+    std::exception_ptr error;               // first one thrown by f
+    std::mutex mutex;
+    std::condition_variable done;
+};
+
+template<typename Schedule, typename F>
+inline void parallel_work(ParallelRun<Schedule>& s, unsigned worker, F* f) {
+    for (std::size_t i; s.schedule.next(worker, i);) {
+        if (!s.failed) {
+            try {
+                (*f)(worker, i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(s.mutex);
+                if (!s.error) s.error = std::current_exception();
+                s.failed = true;
+            }
+        }
+        if (++s.finished == s.items) {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            s.done.notify_one();
+        }
+    }
+}
+
+} // detail
+
+/*
+ * Calls f(worker, item) for items [0, n) on the calling thread, worker 0,
+ * and on up to workers - 1 tasks of the pool, workers from 1 on. Items are
+ * handed out by a Schedule(n, workers), whose next(worker, item) gives the
+ * next item for the worker, false once no item is left for it.
+ *
+ * The caller is a worker too, so a pool busy with other tasks slows the
+ * run down but never blocks it: the call waits only for items other
+ * workers have started, and tasks starting after all items are taken
+ * return at once. This also makes it safe to call from a task of the same
+ * pool. Once f throws, items not started are skipped, and the first
+ * exception is rethrown when the started ones are done.
+ */
+template<typename Schedule = SharedSchedule, typename F>
+inline void parallel_run(ThreadPool& pool, std::size_t n, unsigned workers, F&& f) {
+    if (!n) return;
+    workers = unsigned(std::max<std::size_t>(1, std::min<std::size_t>(workers, n)));
+    auto shared = std::make_shared<detail::ParallelRun<Schedule>>(n, workers);
+    auto fn = &f;
+    for (unsigned w = 1; w < workers; ++w)
+        pool.submit([shared, fn] { detail::parallel_work(*shared, shared->next++, fn); });
+    detail::parallel_work(*shared, 0, fn);
+
+    // items left are being run by tasks already running
+    std::unique_lock<std::mutex> lock(shared->mutex);
+    shared->done.wait(lock, [&] { return shared->finished == n; });
+    if (shared->error) std::rethrow_exception(shared->error);
+}
+
+// calls f(item) for items [0, n) on the caller and all workers of the pool
+template<typename F>
+inline void parallel_for(ThreadPool& pool, std::size_t n, F&& f) {
+    parallel_run(pool, n, pool.size() + 1, [&f] (unsigned, std::size_t i) { f(i); });
+}
+
+} // lexen
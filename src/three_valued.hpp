@@ -0,0 +1,177 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions engine - null semantics, three-valued results
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+#pragma once
+
+#include "batch.hpp"
+#include "optimize.hpp"
+
+namespace lexen {
+
+/*
+ * What a predicate reading a null variable means. Predicates "is null",
+ * "is not null" and "is empty" are known for any value.
+ *
+ * Unknown: the predicate is unknown, and/or/not follow Kleene logic
+ * (false and unknown is false, true or unknown is true, not unknown is
+ * unknown). Programs accept where the expression is true, so unknown
+ * counts as false at the top only; see compile_tri() to tell the two
+ * apart. This is the default of compile().
+ *
+ * False: the predicate is false, and/or/not are plain boolean, so
+ * "not x > 3" is true when x is null.
+ */
+enum class Nulls { Unknown, False };
+
+namespace detail {
+
+// variable a predicate reads, null for leaves known regardless of nulls
+struct leaf_var : boost::static_visitor<const ast::VarIdx*> {
+    const ast::VarIdx* operator()(const ast::VarIdx& x) const { return &x; }
+    const ast::VarIdx* operator()(const ast::NumComp& x) const { return &x.var; }
+    const ast::VarIdx* operator()(const ast::StrComp& x) const { return &x.var; }
+    const ast::VarIdx* operator()(const ast::SetExpr& x) const { return boost::apply_visitor(*this, x); }
+    const ast::VarIdx* operator()(const ast::ListExpr& x) const { return boost::apply_visitor(*this, x); }
+    template<typename T>
+    const ast::VarIdx* operator()(const ast::ValInSet<T>& x) const { return &x.set; }
+    template<typename T>
+    const ast::VarIdx* operator()(const ast::VarInSet<T>& x) const { return &x.var; }
+    template<typename T>
+    const ast::VarIdx* operator()(const ast::VarVsSet<T>& x) const { return &x.var; }
+    template<typename T>
+    const ast::VarIdx* operator()(const T&) const { return nullptr; }
+};
+
+// Rewrites expression (negated if neg is set) so that its Kleene value
+// is its null-is-false value: negation is pushed down to leaves, and a
+// negated predicate over variable x becomes "x is null or not <pred>",
+// negation kept above the predicate, so a NaN value is not null there.
+// The result has negation above those guarded leaves only, so it is
+// monotone in everything unknown, and unknown there is false.
+class NullsFalse : public boost::static_visitor<ast::Expression> {
+public:
+    explicit NullsFalse(bool neg) : neg_(neg) {}
+
+    ast::Expression operator()(const x3::forward_ast<ast::Conjunction>& x) const {
+        return join(!neg_, x.get().items);
+    }
+
+    ast::Expression operator()(const x3::forward_ast<ast::Disjunction>& x) const {
+        return join(neg_, x.get().items);
+    }
+
+    ast::Expression operator()(const x3::forward_ast<ast::Negation>& x) const {
+        return boost::apply_visitor(NullsFalse(!neg_), x.get().expr);
+    }
+
+    template<typename T>
+    ast::Expression operator()(const T& x) const {
+        ast::Expression leaf(x);
+        if (!neg_) return leaf;
+        auto var = boost::apply_visitor(leaf_var(), leaf);
+        if (!var) return boost::apply_visitor(Optimizer(true, default_schema()), leaf);
+        ast::Disjunction d;
+        d.items.push_back(ast::Expression(ast::UnaryExpr{ast::UnaryOp::IsNull, *var}));
+        d.items.push_back(ast::Expression(ast::Negation{std::move(leaf)}));
+        return ast::Expression(d);
+    }
+
+private:
+    // and of the items when all is set, or of the items otherwise
+    ast::Expression join(bool all, const std::vector<ast::Expression>& src) const {
+        std::vector<ast::Expression> items;
+        for (auto& x : src) items.push_back(boost::apply_visitor(*this, x));
+        if (all) return ast::Expression(ast::Conjunction{std::move(items)});
+        return ast::Expression(ast::Disjunction{std::move(items)});
+    }
+
+    bool neg_;
+};
+
+} // detail
+
+// expression with the same value under Nulls::Unknown as the source has
+// under Nulls::False
+inline ast::Expression nulls_false(const ast::Expression& e) {
+    return boost::apply_visitor(detail::NullsFalse(false), e);
+}
+
+inline Program compile(const ast::Expression& e, Nulls nulls) {
+    return nulls == Nulls::False ? compile(nulls_false(e)) : compile(e);
+}
+
+enum class Truth : std::uint8_t { False, True, Unknown };
+
+// Programs accepting where the expression is true (pos) and where it is
+// false (neg) under Nulls::Unknown; it is unknown where neither does.
+struct TriProgram {
+    Program pos;
+    Program neg;
+};
+
+inline TriProgram compile_tri(const ast::Expression& e) {
+    return TriProgram{compile(e), compile(ast::Expression(ast::Negation{e}))};
+}
+
+template<typename Record>
+inline Truth eval_tri(const TriProgram& p, const Record& rec) {
+    if (eval(p.pos, rec)) return Truth::True;
+    if (eval(p.neg, rec)) return Truth::False;
+    return Truth::Unknown;
+}
+
+// Three-valued result per row: unknown where known is clear, truth is
+// set only where known is.
+struct TriBitmap {
+    Bitmap truth;
+    Bitmap known;
+};
+
+inline TriBitmap eval_tri(const TriProgram& p, const Batch& b, BatchContext& ctx) {
+    TriBitmap r{eval(p.pos, b, ctx), eval(p.neg, b, ctx)};
+    for (std::size_t i = 0; i < r.known.size(); ++i) r.known[i] |= r.truth[i];
+    return r;
+}
+
+inline TriBitmap eval_tri(const TriProgram& p, const Batch& b) {
+    BatchContext ctx;
+    return eval_tri(p, b, ctx);
+}
+
+/*
+ * Kleene and/or/not of three-valued results of equal size, e.g. of
+ * filters evaluated separately: a row is known false where either side
+ * of and is, known true where either side of or is.
+ */
+inline TriBitmap tri_and(const TriBitmap& a, const TriBitmap& b) {
+    auto w = a.truth.size();
+    TriBitmap r{Bitmap(w), Bitmap(w)};
+    for (std::size_t i = 0; i < w; ++i) {
+        r.truth[i] = a.truth[i] & b.truth[i];
+        r.known[i] = r.truth[i] | (a.known[i] & ~a.truth[i]) | (b.known[i] & ~b.truth[i]);
+    }
+    return r;
+}
+
+inline TriBitmap tri_or(const TriBitmap& a, const TriBitmap& b) {
+    auto w = a.truth.size();
+    TriBitmap r{Bitmap(w), Bitmap(w)};
+    for (std::size_t i = 0; i < w; ++i) {
+        r.truth[i] = a.truth[i] | b.truth[i];
+        r.known[i] = r.truth[i] | (a.known[i] & b.known[i]);
+    }
+    return r;
+}
+
+inline TriBitmap tri_not(const TriBitmap& a) {
+    auto w = a.truth.size();
+    TriBitmap r{Bitmap(w), a.known};
+    for (std::size_t i = 0; i < w; ++i) r.truth[i] = a.known[i] & ~a.truth[i];
+    return r;
+}
+
+} // lexen
@@ -0,0 +1,124 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions engine - extension evaluation
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <boost/container_hash/hash.hpp>
+
+#include "extension_ast.hpp"
+#include "ast_hash.hpp"
+
+namespace ext {
+
+// "? var fits 'pattern'", where * in the pattern matches any substring;
+// compiled into the pieces between the stars
+struct FitMatcher {
+    lexen::ast::VarIdx var;
+    std::vector<std::string> parts;     // at least one, first and last are anchored
+
+    bool match(std::string_view s) const {
+        if (parts.size() == 1) return s == parts[0];
+        auto& first = parts.front();
+        auto& last = parts.back();
+        if (s.size() < first.size() + last.size() || s.substr(0, first.size()) != first
+            || s.substr(s.size() - last.size()) != last)
+            return false;
+        s = s.substr(first.size(), s.size() - first.size() - last.size());
+        for (std::size_t i = 1; i + 1 < parts.size(); ++i) {
+            auto at = s.find(parts[i]);
+            if (at == std::string_view::npos) return false;
+            s.remove_prefix(at + parts[i].size());
+        }
+        return true;
+    }
+};
+
+} // ext
+
+namespace ext { namespace ast {
+
+// found by ADL on the AST node
+inline FitMatcher compile_extension(const PredicateExtension& x) {
+    auto& f = boost::get<FitExpr>(x);
+    FitMatcher m{f.var, {}};
+    std::string_view s = f.val;
+    for (auto star = s.find('*'); star != std::string_view::npos; star = s.find('*')) {
+        m.parts.emplace_back(s.substr(0, star));
+        s.remove_prefix(star + 1);
+    }
+    m.parts.emplace_back(s);
+    return m;
+}
+
+inline std::size_t hash_value(const FitExpr& x) {
+    std::size_t seed = 0;
+    boost::hash_combine(seed, x.var);
+    boost::hash_combine(seed, x.val);
+    return seed;
+}
+
+inline std::size_t hash_value(const PredicateExtension& x) {
+    return hash_value(boost::get<FitExpr>(x));
+}
+
+} } // ext::ast
+
+namespace lexen { class Batch; }
+
+namespace ext {
+
+// calls of the record hook, for tests
+inline int record_calls = 0;
+
+// null string does not fit
+template<typename Record>
+bool eval_extension(const FitMatcher& m, const Record& rec) {
+    ++record_calls;
+    return !rec.is_null(m.var) && m.match(rec.get_str(m.var));
+}
+
+inline void eval_extension(const FitMatcher& m, const lexen::Batch& b, const std::vector<std::uint32_t>& rows,
+    std::uint64_t* truth);
+
+inline double extension_cost(const FitMatcher& m) {
+    return 4.0 * double(m.parts.size());
+}
+
+inline lexen::ast::VarIdx extension_var(const FitMatcher& m) {
+    return m.var;
+}
+
+} // ext
+
+#define PREDICATE_EXTENSION_EVAL_TYPE ::ext::FitMatcher
+#include "batch.hpp"
+
+namespace ext {
+
+// calls of the batch hook, for tests
+inline int batch_calls = 0;
+
+inline void eval_extension(const FitMatcher& m, const lexen::Batch& b, const std::vector<std::uint32_t>& rows,
+    std::uint64_t* truth)
+{
+    ++batch_calls;
+    auto& c = b.column(m.var);
+    if (!c.data) return;
+    auto strs = static_cast<const std::string_view*>(c.data);
+    auto codes = static_cast<const std::uint32_t*>(c.data);
+    for (auto row : rows) {
+        if (c.valid && !lexen::test_bit(c.valid, row)) continue;
+        bool r = m.match(c.dict ? c.dict->str(codes[row]) : strs[row]);
+        truth[row / 64] |= std::uint64_t(r) << (row % 64);
+    }
+}
+
+} // ext
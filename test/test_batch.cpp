@@ -0,0 +1,447 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions engine - batch evaluation unit tests
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+
+#include "ast_io.hpp"
+#include "be.hpp"
+#include "batch.hpp"
+#include "parallel.hpp"
+#include "test_utils.hpp"
+#include "three_valued.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+// null-is-false reference: leaves as programs, plain and/or/not above
+struct TwoValued : boost::static_visitor<bool> {
+    const lexen::BatchRow& row;
+    explicit TwoValued(const lexen::BatchRow& r) : row(r) {}
+
+    bool operator()(const boost::spirit::x3::forward_ast<Con>& x) const {
+        for (auto& y : x.get().items)
+            if (!boost::apply_visitor(*this, y)) return false;
+        return true;
+    }
+    bool operator()(const boost::spirit::x3::forward_ast<Dis>& x) const {
+        for (auto& y : x.get().items)
+            if (boost::apply_visitor(*this, y)) return true;
+        return false;
+    }
+    bool operator()(const boost::spirit::x3::forward_ast<lexen::ast::Negation>& x) const {
+        return !boost::apply_visitor(*this, x.get().expr);
+    }
+    template<typename T>
+    bool operator()(const T& x) const { return lexen::eval(lexen::compile(Exp(x)), row); }
+};
+
+struct TestBatch {
+    static constexpr std::size_t rows = 300;
+
+    VarIdx flag = test_var("b_flag", var_type::boolean);
+    VarIdx size = test_var("b_size", var_type::integer);
+    VarIdx ratio = test_var("b_ratio", var_type::realnum);
+    VarIdx name = test_var("b_name", var_type::string);
+    VarIdx tags = test_var("b_tags", var_type::integers);
+    VarIdx hosts = test_var("b_hosts", var_type::strings);
+    VarIdx user = test_var("b_user", var_type::string);
+
+    bool flags[rows];
+    int sizes[rows];
+    double ratios[rows];
+    std::string_view names[rows];
+    std::uint32_t tag_offsets[rows + 1];
+    std::vector<int> tag_values;
+    std::uint32_t host_offsets[rows + 1];
+    std::vector<std::string_view> host_values;
+    lexen::Bitmap host_valid = lexen::Bitmap(simd_words(), 0);
+    lexen::Bitmap size_valid = lexen::Bitmap(simd_words(), 0);
+    lexen::Dictionary dict;
+    std::uint32_t users[rows];
+    lexen::Bitmap user_valid = lexen::Bitmap(simd_words(), 0);
+
+    lexen::Batch batch{lexen::default_schema(), rows};
+
+    static std::size_t simd_words() { return lexen::simd::words(rows); }
+
+    TestBatch() {
+        static const std::string_view pool[] = {"ann", "bob", "cid"};
+        for (std::size_t i = 0; i < rows; ++i) {
+            flags[i] = i % 3 == 0;
+            sizes[i] = int(i % 17) - 8;
+            ratios[i] = i % 23 ? double(i % 11) / 4 : std::numeric_limits<double>::quiet_NaN();
+            names[i] = pool[i % 3];
+            tag_offsets[i] = std::uint32_t(tag_values.size());
+            for (std::size_t j = 0; j < i % 4; ++j) tag_values.push_back(int(i + j) % 7);
+            host_offsets[i] = std::uint32_t(host_values.size());
+            for (std::size_t j = 0; j < i % 13; ++j) host_values.push_back(pool[(i + j) % 3]);
+            if (i % 5) size_valid[i / 64] |= std::uint64_t(1) << (i % 64);
+            if (i % 7) host_valid[i / 64] |= std::uint64_t(1) << (i % 64);
+            users[i] = dict.intern("user" + std::to_string(i % 10));
+            if (i % 9) user_valid[i / 64] |= std::uint64_t(1) << (i % 64);
+        }
+        tag_offsets[rows] = std::uint32_t(tag_values.size());
+        host_offsets[rows] = std::uint32_t(host_values.size());
+        batch.set_bools(flag, flags);
+        batch.set_ints(size, sizes, size_valid.data());
+        batch.set_reals(ratio, ratios);
+        batch.set_strs(name, names);
+        batch.set_int_lists(tags, tag_offsets, tag_values.data());
+        batch.set_str_lists(hosts, host_offsets, host_values.data(), host_valid.data());
+        batch.set_str_codes(user, users, dict, user_valid.data());
+    }
+
+    // batch result must match row at a time evaluation, with string
+    // literals interned into the dictionary if interned is set
+    void check(const std::string& src, bool interned = false) {
+        Exp e;
+        BOOST_REQUIRE(lexen::parse_str(src, e));
+        auto p = interned ? lexen::compile(e, dict) : lexen::compile(e);
+        auto result = lexen::eval(p, batch);
+        BOOST_REQUIRE_EQUAL(result.size(), simd_words());
+        // all dense and all sparse steps must agree
+        for (double fraction : {0.0, 2.0}) {
+            lexen::BatchContext ctx;
+            ctx.sparse_fraction = fraction;
+            BOOST_CHECK(lexen::eval(p, batch, ctx) == result);
+        }
+        for (std::size_t i = 0; i < rows; ++i) {
+            BOOST_TEST_CONTEXT(src << " @ " << i) {
+                BOOST_CHECK_EQUAL(lexen::test_bit(result.data(), i), lexen::eval(p, lexen::BatchRow(batch, i)));
+            }
+        }
+        BOOST_CHECK_EQUAL(result.back() >> (rows % 64), 0u);
+    }
+};
+
+}
+
+BOOST_AUTO_TEST_SUITE( batch_tests )
+
+BOOST_AUTO_TEST_CASE( kernel_test )
+{
+    int x[130];
+    double y[130];
+    for (int i = 0; i < 130; ++i) { x[i] = i - 65; y[i] = (i - 65) / 2.0; }
+    std::uint64_t out[3];
+    for (auto op : {CompOp::Gt, CompOp::Ge, CompOp::Lt, CompOp::Le, CompOp::Eq, CompOp::Ne}) {
+        for (double lit : {-100.0, -3.5, 0.0, 7.0, 64.25, 1e12}) {
+            lexen::simd::cmp_i32(x, 130, op, lit, out);
+            for (int i = 0; i < 130; ++i)
+                BOOST_CHECK_EQUAL(lexen::test_bit(out, i), lexen::simd::cmp(op, double(x[i]), lit));
+            lexen::simd::cmp_f64(y, 130, op, lit, out);
+            for (int i = 0; i < 130; ++i)
+                BOOST_CHECK_EQUAL(lexen::test_bit(out, i), lexen::simd::cmp(op, y[i], lit));
+            BOOST_CHECK_EQUAL(out[2] >> 2, 0u);
+#ifdef LEXEN_X86_SIMD
+            if (lit > 1e9 || double(int(lit)) != lit) continue;
+            lexen::simd::cmp_i32_sse2(x, 130, op, int(lit), out);
+            for (int i = 0; i < 128; ++i)
+                BOOST_CHECK_EQUAL(lexen::test_bit(out, i), lexen::simd::cmp(op, x[i], int(lit)));
+            lexen::simd::cmp_f64_sse2(y, 130, op, lit, out);
+            for (int i = 0; i < 128; ++i)
+                BOOST_CHECK_EQUAL(lexen::test_bit(out, i), lexen::simd::cmp(op, y[i], lit));
+#endif
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( list_kernel_test )
+{
+    int x[37];
+    for (int i = 0; i < 37; ++i) x[i] = i * 3;
+    for (int v = -1; v < 120; ++v) {
+        for (std::size_t n : {0, 5, 16, 37}) {
+            bool found = v % 3 == 0 && v / 3 < int(n);
+            BOOST_CHECK_EQUAL(lexen::simd::find_i32(x, n, v), found);
+#ifdef LEXEN_X86_SIMD
+            BOOST_CHECK_EQUAL(lexen::simd::find_i32_sse2(x, n, v), found);
+#endif
+        }
+    }
+
+    std::uint64_t b[3] = {0, std::uint64_t(1) << 10, 0};
+    BOOST_CHECK(lexen::simd::any(b, 74, 75));
+    BOOST_CHECK(lexen::simd::any(b, 0, 192));
+    BOOST_CHECK(lexen::simd::any(b, 60, 140));
+    BOOST_CHECK(!lexen::simd::any(b, 75, 192));
+    BOOST_CHECK(!lexen::simd::any(b, 0, 74));
+    BOOST_CHECK(!lexen::simd::any(b, 74, 74));
+}
+
+BOOST_AUTO_TEST_CASE( batch_eval_test )
+{
+    TestBatch t;
+    t.check("b_flag");
+    t.check("not b_flag or b_size > 2");
+    t.check("b_size is null or b_ratio >= 1.25");
+    t.check("b_size <= 2.5 and b_size <> -3 and not b_ratio = 0");
+    t.check("not (b_size > 0 and b_flag) and b_name <> 'bob'");
+    t.check("b_name in ('ann', 'cid') or 3 in b_tags");
+    t.check("b_tags one of (1, 2) and not b_tags is empty");
+    t.check("4 in b_tags or b_tags all of (0, 6) or b_tags none of (2, 3, 5)");
+    t.check("'bob' in b_hosts and b_hosts one of ('cid', 'dan') or b_hosts is empty");
+    t.check("b_hosts all of ('ann', 'bob', 'cid') and 'dan' not in b_hosts");
+    t.check("b_flag or (b_size < 0 and b_ratio < 1)");
+    t.check("b_size > -2 and b_size <= 4.5");
+    t.check("not (b_ratio >= 0.5 and b_ratio < 1.5) or b_flag");
+    t.check("b_size = 7 and b_flag and b_ratio > 0.5 and b_name = 'ann'");
+    t.check("b_size <> 7 or b_flag is not null and b_ratio < 2 or b_size is null");
+    t.check("true or b_flag");
+    t.check("false and b_flag");
+
+    // variables added to the schema after the batch was made
+    lexen::Schema grown;
+    grown.add("a", var_type::boolean);
+    lexen::Batch b(grown, 100);
+    auto late = grown.add("v", var_type::integer);
+    Exp e;
+    BOOST_REQUIRE(lexen::parse_str("v is null", e, grown));
+    auto all = lexen::eval(lexen::compile(e), b);
+    BOOST_CHECK(lexen::test_bit(all.data(), 0) && lexen::test_bit(all.data(), 99));
+    BOOST_REQUIRE(lexen::parse_str("v > 1 or v <= 1", e, grown));
+    auto none = lexen::eval(lexen::compile(e), b);
+    BOOST_CHECK(std::all_of(none.begin(), none.end(), [] (std::uint64_t x) { return x == 0; }));
+    std::vector<int> values(100, 2);
+    b.set_ints(late, values.data());
+    BOOST_REQUIRE(lexen::parse_str("v > 1", e, grown));
+    auto set = lexen::eval(lexen::compile(e), b);
+    BOOST_CHECK(lexen::test_bit(set.data(), 0) && lexen::test_bit(set.data(), 99));
+    BOOST_CHECK(lexen::eval(lexen::compile(e), lexen::BatchRow(b.slice(64, 36), 35)));
+}
+
+BOOST_AUTO_TEST_CASE( dictionary_test )
+{
+    TestBatch t;
+    auto n = t.dict.size();
+    for (bool interned : {false, true}) {
+        t.check("b_user = 'user3'", interned);
+        t.check("b_user <> 'user4' and b_flag", interned);
+        t.check("b_user in ('user1', 'user7', 'user9') or b_size > 5", interned);
+        t.check("b_user not in ('user2', 'user5') or b_user is null", interned);
+        t.check("b_user = 'guest' or b_user in ('root', 'user0')", interned);
+    }
+    // unknown literals get codes at compile time only
+    BOOST_CHECK_EQUAL(t.dict.size(), n + 2);
+    BOOST_CHECK_EQUAL(t.dict.find("root"), n + 1);
+    BOOST_CHECK_EQUAL(t.dict.str(t.dict.intern("user3")), "user3");
+    BOOST_CHECK_EQUAL(lexen::BatchRow(t.batch, 13).get_str(t.user), "user3");
+}
+
+BOOST_AUTO_TEST_CASE( nulls_test )
+{
+    TestBatch t;
+    auto row = [&t] (std::size_t i) { return lexen::BatchRow(t.batch, i); };
+    auto tri = [&t] (const std::string& src) {
+        Exp e;
+        BOOST_REQUIRE(lexen::parse_str(src, e));
+        return lexen::compile_tri(e);
+    };
+    auto truth = [] (const lexen::TriBitmap& b, std::size_t i) {
+        if (!lexen::test_bit(b.known.data(), i)) return lexen::Truth::Unknown;
+        return lexen::test_bit(b.truth.data(), i) ? lexen::Truth::True : lexen::Truth::False;
+    };
+
+    // b_size is null in rows 0, 5, ...; b_flag is true in rows 0, 3, ...
+    BOOST_CHECK(lexen::eval_tri(tri("b_size > 3"), row(5)) == lexen::Truth::Unknown);
+    BOOST_CHECK(lexen::eval_tri(tri("not b_size > 3"), row(5)) == lexen::Truth::Unknown);
+    BOOST_CHECK(lexen::eval_tri(tri("b_size > 3 or b_flag"), row(0)) == lexen::Truth::True);
+    BOOST_CHECK(lexen::eval_tri(tri("b_size > 3 and b_flag"), row(5)) == lexen::Truth::False);
+    BOOST_CHECK(lexen::eval_tri(tri("b_size is null"), row(5)) == lexen::Truth::True);
+
+    const char* exprs[] = {
+        "b_size > 3",
+        "not (b_size > 0 and b_flag) or b_user = 'user3'",
+        "not (b_user in ('user1', 'user2') or 'bob' in b_hosts)",
+        "b_hosts one of ('cid') and not b_hosts all of ('ann', 'bob') or b_size is null",
+        "not b_tags is empty and not b_flag",
+        "not b_ratio > 1 and not (b_ratio <= 0.5 or b_size < 0)",
+    };
+    for (auto src : exprs) {
+        BOOST_TEST_CONTEXT(src) {
+            auto p = tri(src);
+            auto r = lexen::eval_tri(p, t.batch);
+            lexen::BatchContext ctx;
+            ctx.sparse_fraction = 2.0;
+            auto sparse = lexen::eval_tri(p, t.batch, ctx);
+            BOOST_CHECK(sparse.truth == r.truth && sparse.known == r.known);
+
+            Exp e;
+            BOOST_REQUIRE(lexen::parse_str(src, e));
+            auto two = lexen::compile(e, lexen::Nulls::False);
+            auto two_rows = lexen::eval(two, t.batch);
+            for (std::size_t i = 0; i < t.rows; ++i) {
+                BOOST_CHECK(truth(r, i) == lexen::eval_tri(p, row(i)));
+                BOOST_CHECK_EQUAL(lexen::test_bit(two_rows.data(), i), boost::apply_visitor(TwoValued(row(i)), e));
+            }
+        }
+    }
+
+    // Kleene operations on results match results of combined expressions
+    auto a = lexen::eval_tri(tri(exprs[1]), t.batch);
+    auto b = lexen::eval_tri(tri(exprs[3]), t.batch);
+    auto both = lexen::eval_tri(tri(std::string("(") + exprs[1] + ") and (" + exprs[3] + ")"), t.batch);
+    auto either = lexen::eval_tri(tri(std::string("(") + exprs[1] + ") or (" + exprs[3] + ")"), t.batch);
+    auto neither = lexen::eval_tri(tri(std::string("not (") + exprs[1] + ")"), t.batch);
+    auto x = lexen::tri_and(a, b);
+    BOOST_CHECK(x.truth == both.truth && x.known == both.known);
+    x = lexen::tri_or(a, b);
+    BOOST_CHECK(x.truth == either.truth && x.known == either.known);
+    x = lexen::tri_not(a);
+    BOOST_CHECK(x.truth == neither.truth && x.known == neither.known);
+}
+
+BOOST_AUTO_TEST_CASE( parallel_test )
+{
+    TestBatch t;
+    lexen::ThreadPool pool(3);
+    lexen::ParallelEval par(pool, 60);
+    BOOST_CHECK_EQUAL(par.morsel_rows(), 64u);
+
+    for (auto src : {"b_flag or b_size > 2", "b_size is null or b_ratio >= 1.25 and b_name <> 'bob'",
+        "3 in b_tags or b_hosts is empty", "b_user in ('user1', 'user7') or not b_flag", "false and b_flag"})
+    {
+        BOOST_TEST_CONTEXT(src) {
+            Exp e;
+            BOOST_REQUIRE(lexen::parse_str(src, e));
+            auto p = lexen::compile(e, t.dict);
+            auto expected = lexen::eval(p, t.batch);
+            BOOST_CHECK(par.eval(p, t.batch) == expected);
+
+            std::vector<std::uint32_t> rows, all;
+            par.select(p, t.batch, rows);
+            for (std::uint32_t i = 0; i < t.rows; ++i)
+                if (lexen::test_bit(expected.data(), i)) all.push_back(i);
+            BOOST_CHECK(rows == all);
+
+            // morsels must agree with row at a time evaluation
+            auto part = t.batch.slice(128, 100);
+            auto bits = lexen::eval(p, part);
+            for (std::size_t i = 0; i < part.rows(); ++i)
+                BOOST_CHECK_EQUAL(lexen::test_bit(bits.data(), i), lexen::test_bit(expected.data(), 128 + i));
+        }
+    }
+
+    // many morsels stolen between workers, in a stream of batches
+    const std::size_t rows = 100000;
+    auto size = test_var("b_size", var_type::integer);
+    std::vector<int> sizes(rows);
+    for (std::size_t i = 0; i < rows; ++i) sizes[i] = int(i * 7919 % 1000);
+    lexen::Batch big(lexen::default_schema(), rows);
+    big.set_ints(size, sizes.data());
+    Exp e;
+    BOOST_REQUIRE(lexen::parse_str("b_size < 100 or b_size >= 950", e));
+    auto p = lexen::compile(e);
+    auto expected = lexen::eval(p, big);
+
+    std::vector<lexen::Batch> parts{big.slice(0, 40000), big.slice(40000, 60000)};
+    std::size_t next = 0, seen = 0;
+    par.eval_stream(p, [&] { return next < parts.size() ? &parts[next++] : nullptr; },
+        [&] (const lexen::Batch& b, const lexen::Bitmap& r) {
+            BOOST_CHECK_EQUAL(&b, &parts[seen]);
+            BOOST_CHECK_EQUAL(next, seen + 1);
+            auto first = seen ? 40000 : 0;
+            for (std::size_t i = 0; i < b.rows(); ++i)
+                if (lexen::test_bit(r.data(), i) != lexen::test_bit(expected.data(), first + i)) {
+                    BOOST_ERROR("row " << first + i);
+                    break;
+                }
+            ++seen;
+        });
+    BOOST_CHECK_EQUAL(seen, 2u);
+
+    std::vector<std::uint32_t> out;
+    par.select(p, big, out);
+    BOOST_CHECK_EQUAL(out.size(), 15000u);
+    BOOST_CHECK(std::is_sorted(out.begin(), out.end()));
+    for (auto row : out) BOOST_CHECK(sizes[row] < 100 || sizes[row] >= 950);
+}
+
+BOOST_AUTO_TEST_CASE( parallel_busy_pool_test )
+{
+    const std::size_t rows = 20000;
+    auto size = test_var("b_size", var_type::integer);
+    std::vector<int> sizes(rows);
+    for (std::size_t i = 0; i < rows; ++i) sizes[i] = int(i * 7919 % 1000);
+    lexen::Batch big(lexen::default_schema(), rows);
+    big.set_ints(size, sizes.data());
+    Exp e;
+    BOOST_REQUIRE(lexen::parse_str("b_size < 100 or b_size >= 950", e));
+    auto p = lexen::compile(e);
+    auto expected = lexen::eval(p, big);
+
+    // all workers blocked until evaluation is done: the caller does it all
+    {
+        lexen::ThreadPool pool(2);
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool release = false;
+        for (int i = 0; i < 2; ++i)
+            pool.submit([&] {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&] { return release; });
+            });
+        lexen::ParallelEval par(pool, 64);
+        BOOST_CHECK(par.eval(p, big) == expected);
+        std::vector<std::uint32_t> out;
+        par.select(p, big, out);
+        BOOST_CHECK_EQUAL(out.size(), 3000u);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            release = true;
+        }
+        cv.notify_all();
+        pool.wait();
+    }
+
+    // from a task of the pool itself, with no other worker to help
+    {
+        lexen::ThreadPool pool(1);
+        lexen::ParallelEval par(pool, 64);
+        lexen::Bitmap result;
+        pool.submit([&] { result = par.eval(p, big); });
+        pool.wait();
+        BOOST_CHECK(result == expected);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( parallel_for_test )
+{
+    lexen::ThreadPool pool(3);
+    std::vector<std::atomic<int>> seen(1000);
+    lexen::parallel_for(pool, seen.size(), [&] (std::size_t i) { ++seen[i]; });
+    BOOST_CHECK(std::all_of(seen.begin(), seen.end(), [] (const std::atomic<int>& n) { return n == 1; }));
+    lexen::parallel_for(pool, 0, [] (std::size_t) { BOOST_ERROR("no items"); });
+
+    // the first exception comes out once items started are done; how many
+    // are started before it is caught depends on timing
+    std::atomic<int> started{0}, done{0};
+    auto f = [&] (std::size_t i) {
+        ++started;
+        if (i == 10) throw std::runtime_error("item");
+        ++done;
+    };
+    BOOST_CHECK_THROW(lexen::parallel_for(pool, 1000, f), std::runtime_error);
+    BOOST_CHECK_EQUAL(started.load(), done.load() + 1);
+    pool.wait();
+
+    // with the caller as the only worker items after it are skipped
+    started = done = 0;
+    BOOST_CHECK_THROW(lexen::parallel_run(pool, 1000, 1, [&f] (unsigned, std::size_t i) { f(i); }),
+        std::runtime_error);
+    BOOST_CHECK_EQUAL(started.load(), 11);
+    BOOST_CHECK_EQUAL(done.load(), 10);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
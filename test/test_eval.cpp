@@ -0,0 +1,533 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions engine - evaluation unit tests
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+
+#include "adaptive.hpp"
+#include "ast_io.hpp"
+#include "be.hpp"
+#include "eval.hpp"
+#include "record.hpp"
+#include "result_cache.hpp"
+#include "static_expr.hpp"
+#include "test_utils.hpp"
+
+#include <functional>
+#include <limits>
+#include <map>
+#include <string_view>
+#include <thread>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+// map based record
+struct TestRecord {
+    std::map<int, bool> bools;
+    std::map<int, double> nums;
+    std::map<int, std::string> strs;
+    std::map<int, std::vector<int>> int_lists;
+    std::map<int, std::vector<std::string_view>> str_lists;
+
+    bool is_null(VarIdx v) const {
+        int i = v.index;
+        return !bools.count(i) && !nums.count(i) && !strs.count(i)
+            && !int_lists.count(i) && !str_lists.count(i);
+    }
+    bool is_empty(VarIdx v) const {
+        int i = v.index;
+        return int_lists.count(i) ? int_lists.at(i).empty() : str_lists.at(i).empty();
+    }
+    bool get_bool(VarIdx v) const { return bools.at(v.index); }
+    double get_num(VarIdx v) const { return nums.at(v.index); }
+    std::string_view get_str(VarIdx v) const { return strs.at(v.index); }
+    const std::vector<int>& get_ints(VarIdx v) const { return int_lists.at(v.index); }
+    const std::vector<std::string_view>& get_strs(VarIdx v) const { return str_lists.at(v.index); }
+};
+
+bool run(const std::string& src, const TestRecord& rec) {
+    Exp e;
+    BOOST_REQUIRE(lexen::parse_str(src, e));
+    return lexen::eval(lexen::compile(e), rec);
+}
+
+// fixed filter of a string variable compared to literal of type L
+template<typename L, typename = void>
+struct has_str_eq : std::false_type {};
+
+template<typename L>
+struct has_str_eq<L, std::void_t<decltype(lexen::fixed::StrVar<4>() == std::declval<L>())>> : std::true_type {};
+
+// fixed filter of an integer variable compared to literal of type L
+template<typename L, typename = void>
+struct has_num_gt : std::false_type {};
+
+template<typename L>
+struct has_num_gt<L, std::void_t<decltype(lexen::fixed::IntVar<1>() > std::declval<L>())>> : std::true_type {};
+
+}
+
+BOOST_AUTO_TEST_SUITE( eval_tests )
+
+BOOST_AUTO_TEST_CASE( compile_test )
+{
+    auto flag = add_var("c_flag", var_type::boolean);
+    add_var("c_size", var_type::integer);
+
+    Exp e;
+    BOOST_REQUIRE(lexen::parse_str("c_flag and (c_size > 3 or not c_size < 0) and true", e));
+    auto p = lexen::compile(e);
+    BOOST_REQUIRE_EQUAL(p.code.size(), 3u);
+    BOOST_CHECK_EQUAL(p.entry, 0u);
+    BOOST_CHECK(p.code[0].op == lexen::OpCode::BoolVar);
+    BOOST_CHECK_EQUAL(p.code[0].var, flag.index);
+    BOOST_CHECK_EQUAL(p.code[0].on_true, 1u);
+    BOOST_CHECK_EQUAL(p.code[0].on_false, lexen::Program::reject);
+    BOOST_CHECK_EQUAL(p.code[1].on_true, lexen::Program::accept);
+    BOOST_CHECK_EQUAL(p.code[1].on_false, 2u);
+    BOOST_CHECK(p.code[2].neg);
+
+    BOOST_REQUIRE(lexen::parse_str("false or not true", e));
+    BOOST_CHECK(lexen::compile(e).code.empty());
+    BOOST_CHECK_EQUAL(lexen::compile(e).entry, lexen::Program::reject);
+}
+
+BOOST_AUTO_TEST_CASE( eval_test )
+{
+    auto flag = add_var("e_flag", var_type::boolean);
+    auto size = add_var("e_size", var_type::integer);
+    auto ratio = add_var("e_ratio", var_type::realnum);
+    auto name = add_var("e_name", var_type::string);
+    auto tags = add_var("e_tags", var_type::integers);
+    auto hosts = add_var("e_hosts", var_type::strings);
+
+    TestRecord r;
+    r.bools[flag.index] = true;
+    r.nums[size.index] = 10;
+    r.nums[ratio.index] = 0.5;
+    r.strs[name.index] = "bob";
+    r.int_lists[tags.index] = {1, 5, 7};
+    r.str_lists[hosts.index] = {"a", "b"};
+
+    BOOST_CHECK(run("e_flag", r));
+    BOOST_CHECK(!run("not e_flag", r));
+    BOOST_CHECK(run("e_size > 5 and e_size <= 10.0", r));
+    BOOST_CHECK(run("e_size < 5 or e_ratio = 0.5", r));
+    BOOST_CHECK(run("not (e_size < 5 or e_ratio <> 0.5)", r));
+    BOOST_CHECK(run("e_name = 'bob' and 'bob' <> e_name or true", r));
+    BOOST_CHECK(!run("e_name = 'bob' and 'bob' <> e_name", r));
+    BOOST_CHECK(run("e_size in (1, 10, 100)", r));
+    BOOST_CHECK(run("e_name not in ('alice', 'carol')", r));
+    BOOST_CHECK(run("5 in e_tags and 6 not in e_tags", r));
+    BOOST_CHECK(run("'b' in e_hosts", r));
+    BOOST_CHECK(run("e_tags one of (2, 7) and e_tags all of (1, 7)", r));
+    BOOST_CHECK(!run("e_tags all of (1, 2)", r));
+    BOOST_CHECK(run("e_tags none of (2, 3)", r));
+    BOOST_CHECK(run("e_hosts all of ('b', 'a') and e_hosts none of ('c')", r));
+    BOOST_CHECK(!run("e_hosts is empty", r));
+    BOOST_CHECK(run("e_size is not null and not e_name is null", r));
+
+    // predicates over null variables are unknown, not negatable
+    TestRecord n;
+    BOOST_CHECK(run("e_size is null and e_tags is empty", n));
+    BOOST_CHECK(!run("e_size > 5", n));
+    BOOST_CHECK(!run("not e_size > 5", n));
+    BOOST_CHECK(!run("not (e_flag or e_name = 'x')", n));
+    BOOST_CHECK(run("e_flag or not e_size is not null", n));
+    BOOST_CHECK(!run("e_name not in ('x')", n));
+}
+
+BOOST_AUTO_TEST_CASE( record_test )
+{
+    auto flag = add_var("r_flag", var_type::boolean);
+    auto size = add_var("r_size", var_type::integer);
+    auto ratio = add_var("r_ratio", var_type::realnum);
+    auto name = add_var("r_name", var_type::string);
+    auto tags = add_var("r_tags", var_type::integers);
+    auto hosts = add_var("r_hosts", var_type::strings);
+
+    auto& schema = lexen::default_schema();
+    BOOST_CHECK(schema.type(ratio) == var_type::realnum);
+    BOOST_CHECK_EQUAL(schema.offset(ratio) % sizeof(double), 0u);
+
+    lexen::Record r(schema);
+    std::vector<int> tag_list{3, 4};
+    std::vector<std::string_view> host_list;
+
+    auto check = [&r] (const std::string& src) {
+        Exp e;
+        BOOST_REQUIRE(lexen::parse_str(src, e));
+        return lexen::eval(lexen::compile(e), r);
+    };
+
+    BOOST_CHECK(check("r_flag is null and r_tags is empty"));
+    BOOST_CHECK(!check("r_size <> 1"));
+
+    r.set_bool(flag, false);
+    r.set_int(size, 7);
+    r.set_real(ratio, 1.5);
+    r.set_str(name, "joe");
+    r.set_ints(tags, tag_list);
+    r.set_strs(hosts, host_list);
+
+    BOOST_CHECK_EQUAL(r.get_int(size), 7);
+    BOOST_CHECK(check("not r_flag and r_size = 7 and r_ratio > 1"));
+    BOOST_CHECK(check("r_size in (5, 7) and r_name = 'joe'"));
+    BOOST_CHECK(check("4 in r_tags and r_tags all of (3, 4)"));
+    BOOST_CHECK(check("r_hosts is not null and r_hosts is empty"));
+
+    r.set_null(size);
+    BOOST_CHECK(check("r_size is null and r_ratio is not null"));
+
+    r.clear();
+    BOOST_CHECK(check("r_flag is null and r_name is null and r_hosts is empty"));
+
+    // variables added to the schema after the record was made
+    lexen::Schema grown;
+    grown.add("a", var_type::boolean);
+    lexen::Record g(grown);
+    std::vector<VarIdx> late;
+    for (int i = 0; i < 100; ++i) late.push_back(grown.add("v" + std::to_string(i), var_type::realnum));
+    Exp e;
+    BOOST_REQUIRE(lexen::parse_str("v99 is null and not v99 is not null", e, grown));
+    BOOST_CHECK(lexen::eval(lexen::compile(e), g));
+    BOOST_REQUIRE(lexen::parse_str("v99 > 1 or v99 <= 1", e, grown));
+    BOOST_CHECK(!lexen::eval(lexen::compile(e), g));
+    g.set_null(late.back());
+    g.set_real(late.back(), 2.5);
+    BOOST_CHECK(!g.is_null(late.back()));
+    BOOST_CHECK_EQUAL(g.get_num(late.back()), 2.5);
+    BOOST_REQUIRE(lexen::parse_str("v99 > 1 and v0 is null", e, grown));
+    BOOST_CHECK(lexen::eval(lexen::compile(e), g));
+}
+
+BOOST_AUTO_TEST_CASE( str_set_test )
+{
+    auto host = add_var("s_host", var_type::string);
+    auto hosts = add_var("s_hosts", var_type::strings);
+
+    // strings sharing 8 byte prefix, short ones and empty one
+    std::vector<std::string> set{""};
+    for (int i = 0; i < 3000; ++i)
+        set.push_back(i % 2 ? "host.example." + std::to_string(i) : std::to_string(i));
+
+    std::string src = "s_host in (";
+    for (auto& x : set) src += (&x == &set[0] ? "'" : ", '") + x + "'";
+    src += ") and s_host not in ('4', 'host.example.5') or s_hosts one of ('a', 'host.example.7')";
+    Exp e;
+    BOOST_REQUIRE(lexen::parse_str(src, e));
+    auto p = lexen::compile(e);
+    BOOST_CHECK_EQUAL(p.str_sets.size(), 3u);
+    auto& big = p.str_sets[p.code[0].arg.slice.offset];
+    BOOST_CHECK_EQUAL(big.size, set.size());
+    BOOST_CHECK_GE(big.mask + 1, 2 * set.size());
+
+    TestRecord r;
+    r.str_lists[hosts.index] = {"b", "host.example.8"};
+    for (auto& x : {"", "0", "4", "7", "host.example.1", "host.example.2", "host.example.5",
+        "host.example.2999", "host.example.3001", "host.exa", "3000"})
+    {
+        r.strs[host.index] = x;
+        bool in = std::find(set.begin(), set.end(), x) != set.end();
+        BOOST_CHECK_EQUAL(lexen::eval(p, r), in && x != std::string("4") && x != std::string("host.example.5"));
+    }
+    r.str_lists[hosts.index] = {"b", "host.example.7"};
+    BOOST_CHECK(lexen::eval(p, r));
+
+    // all of: tables of bits on the stack and in the key cache scratch,
+    // kept by the cache across records
+    lexen::StrKeyCache keys;
+    for (std::size_t n : {20, 3000}) {
+        std::string all = "s_hosts all of (";
+        std::vector<std::string_view> list;
+        for (std::size_t i = 0; i < n; ++i) {
+            all += (i ? ", '" : "'") + set[i] + "'";
+            list.push_back(set[n - 1 - i]);
+        }
+        BOOST_REQUIRE(lexen::parse_str(all + ")", e));
+        auto q = lexen::compile(e);
+        list.push_back("x");
+        r.str_lists[hosts.index].assign(list.begin(), list.end());
+        BOOST_CHECK(lexen::eval(q, r));
+        BOOST_CHECK(lexen::eval(q, r, keys));
+        list[3] = list[4];
+        r.str_lists[hosts.index].assign(list.begin(), list.end());
+        BOOST_CHECK(!lexen::eval(q, r));
+        BOOST_CHECK(!lexen::eval(q, r, keys));
+    }
+}
+
+BOOST_AUTO_TEST_CASE( int_set_test )
+{
+    std::vector<int> dense, sparse{-70000, 1, 1000, 100000}, large;
+    for (int i = -500; i < 500; i += 3) dense.push_back(i);
+    // sparse chunks of a few values and one nearly full chunk
+    for (int i = 0; i < 3000; ++i) large.push_back(-1000000 + i * 677);
+    for (int i = 0; i < 30000; ++i) large.push_back(5 * 65536 + 2 * i);
+    std::sort(large.begin(), large.end());
+    large.erase(std::unique(large.begin(), large.end()), large.end());
+
+    lexen::IntPool pool;
+    auto check = [&pool] (const std::vector<int>& set, lexen::IntSetKind kind) {
+        auto s = pool.add(set);
+        BOOST_CHECK(s.kind == kind);
+        BOOST_CHECK_EQUAL(s.size, set.size());
+        for (int x = set.front() - 100; x <= set.back() + 100; x += 7)
+            BOOST_CHECK_EQUAL(pool.has(s, x), std::binary_search(set.begin(), set.end(), x));
+        for (auto x : set) BOOST_CHECK(pool.has(s, x));
+        std::vector<int> all;
+        pool.every(s, [&all] (int x) { all.push_back(x); return true; });
+        BOOST_CHECK(all == set);
+    };
+    check(dense, lexen::IntSetKind::Bitset);
+    check(sparse, lexen::IntSetKind::Array);
+    check(large, lexen::IntSetKind::Chunks);
+    BOOST_CHECK_LT(pool.bits.size() * 8 + pool.lows.size() * 2, large.size() * sizeof(int));
+
+    auto tags = add_var("i_tags", var_type::integers);
+    std::string src = "i_tags all of (";
+    for (auto x : dense) src += (x == dense[0] ? "" : ", ") + std::to_string(x);
+    src += ")";
+    Exp e;
+    BOOST_REQUIRE(lexen::parse_str(src, e));
+    auto p = lexen::compile(e);
+    TestRecord r;
+    r.int_lists[tags.index] = dense;
+    BOOST_CHECK(lexen::eval(p, r));
+    r.int_lists[tags.index].pop_back();
+    BOOST_CHECK(!lexen::eval(p, r));
+}
+
+BOOST_AUTO_TEST_CASE( adaptive_test )
+{
+    auto flag = add_var("a_flag", var_type::boolean);
+    auto size = add_var("a_size", var_type::integer);
+    auto name = add_var("a_name", var_type::string);
+
+    Exp e;
+    BOOST_REQUIRE(lexen::parse_str("a_name in ('x', 'y') and (a_flag or a_name = 'y') and a_size < 5", e));
+    auto plain = lexen::compile(e);
+    lexen::AdaptiveProgram ap(e, lexen::default_schema(), 1, 100);
+
+    std::vector<TestRecord> recs(200);
+    for (int i = 0; i < int(recs.size()); ++i) {
+        auto& r = recs[i];
+        r.bools[flag.index] = i % 2;
+        if (i % 7) r.nums[size.index] = i % 100;
+        r.strs[name.index] = i % 3 ? "x" : "z";
+    }
+
+    for (int round = 0; round < 3; ++round)
+        for (auto& r : recs)
+            BOOST_CHECK_EQUAL(ap.eval(r), lexen::eval(plain, r));
+
+    // rare and cheap a_size < 5 goes first, the costly set test goes last
+    Exp expected;
+    BOOST_REQUIRE(lexen::parse_str("a_size < 5 and (a_flag or a_name = 'y') and a_name in ('x', 'y')", expected));
+    BOOST_CHECK_EQUAL(ap.expression(), expected);
+    BOOST_CHECK_EQUAL(ap.program().code.size(), plain.code.size());
+
+    // bounds in either order are a single range, rare a_size > 3 going
+    // first would change the number of instructions
+    BOOST_REQUIRE(lexen::parse_str("a_size < 10 and a_size > 3", e));
+    plain = lexen::compile(e);
+    lexen::AdaptiveProgram bounds(e, lexen::default_schema(), 1, 100);
+    for (auto& r : recs)
+        if (auto it = r.nums.find(size.index); it != r.nums.end()) it->second = int(it->second) % 5 ? 1 : 20;
+    for (int round = 0; round < 3; ++round)
+        for (auto& r : recs)
+            BOOST_CHECK_EQUAL(bounds.eval(r), lexen::eval(plain, r));
+    BOOST_REQUIRE(lexen::parse_str("a_size > 3 and a_size < 10", expected));
+    BOOST_CHECK_EQUAL(bounds.expression(), expected);
+    BOOST_CHECK_EQUAL(bounds.program().code.size(), 1u);
+
+    // types come from the schema of the expression: for a real variable at
+    // the index of an integer one of the default schema, "not x > 3" is
+    // not rewritten into "x <= 3", which is false for NaN
+    lexen::Schema schema;
+    for (int i = 1; i < size.index; ++i) schema.add(VarIdx(i), var_type::boolean);
+    auto x = schema.add("x", var_type::realnum);
+    BOOST_REQUIRE_EQUAL(x.index, size.index);
+    BOOST_REQUIRE(lexen::parse_str("not x > 3", e, schema));
+    TestRecord nan;
+    nan.nums[x.index] = std::numeric_limits<double>::quiet_NaN();
+    BOOST_CHECK(lexen::eval(lexen::compile(e), nan));
+    BOOST_CHECK(lexen::AdaptiveProgram(e, schema).eval(nan));
+}
+
+BOOST_AUTO_TEST_CASE( static_expr_test )
+{
+    using namespace lexen::fixed;
+
+    lexen::Schema schema;
+    schema.add("flag", var_type::boolean);
+    schema.add("size", var_type::integer);
+    schema.add("ratio", var_type::realnum);
+    schema.add("name", var_type::string);
+    schema.add("tags", var_type::integers);
+    schema.add("hosts", var_type::strings);
+
+    constexpr BoolVar<1> flag;
+    constexpr IntVar<2> size;
+    constexpr RealVar<3> ratio;
+    constexpr StrVar<4> name;
+    constexpr IntsVar<5> tags;
+    constexpr StrsVar<6> hosts;
+
+    auto f = flag && (size > 5 || 0.5 >= ratio) && !(name == "bob")
+        && in(size, {1, 7, 10}) && not_in(name, {"x", "y"});
+    auto g = (in(5, tags) && not_in("c", hosts) && one_of(tags, {2, 7}) && all_of(hosts, {"b", "a"})
+        && none_of(tags, {3})) || is_null(name) || is_empty(tags);
+    const std::string f_src = "flag and (size > 5 or 0.5 >= ratio) and not name = 'bob'"
+        " and size in (1, 7, 10) and name not in ('x', 'y')";
+    const std::string g_src = "(5 in tags and 'c' not in hosts) and tags one of (2, 7)"
+        " and hosts all of ('b', 'a') and tags none of (3) or name is null or tags is empty";
+
+    // literals are viewed, temporaries of std::string are rejected
+    static_assert(has_str_eq<const char*>::value && has_str_eq<const std::string&>::value);
+    static_assert(!has_str_eq<std::string>::value && !has_str_eq<std::string&&>::value);
+    static_assert(has_str_eq<const char (&)[4]>::value && has_str_eq<std::string&>::value);
+    static_assert(has_num_gt<int>::value && has_num_gt<double>::value && has_num_gt<float>::value);
+    static_assert(!has_num_gt<long long>::value && !has_num_gt<unsigned>::value && !has_num_gt<bool>::value);
+
+    // same expression as parsed from the text, regardless of grouping
+    BOOST_CHECK(check(f, f_src, schema));
+    BOOST_CHECK(check(g, g_src, schema));
+    BOOST_CHECK(!check(f, "flag and size > 5", schema));
+    BOOST_CHECK(!check(size > 5, "size > 5.0", schema));
+    BOOST_CHECK(!check(f, "flag and", schema));
+
+    Exp fe, ge;
+    BOOST_REQUIRE(lexen::parse_str(f_src, fe, schema));
+    BOOST_REQUIRE(lexen::parse_str(g_src, ge, schema));
+    auto fp = lexen::compile(fe);
+    auto gp = lexen::compile(ge);
+
+    // matches the program on records with values and nulls
+    lexen::Record r(schema);
+    std::vector<int> tag_list{1, 5, 7};
+    std::vector<std::string_view> host_list{"a", "b"};
+    auto same = [&] {
+        BOOST_CHECK_EQUAL(lexen::fixed::eval(f, r), lexen::eval(fp, r));
+        BOOST_CHECK_EQUAL(lexen::fixed::eval(g, r), lexen::eval(gp, r));
+    };
+    same();
+    r.set_bool(flag.index, true);
+    r.set_int(size.index, 7);
+    r.set_real(ratio.index, 1.5);
+    r.set_str(name.index, "joe");
+    r.set_ints(tags.index, tag_list);
+    r.set_strs(hosts.index, host_list);
+    BOOST_CHECK(f(r) && g(r));
+    same();
+    r.set_int(size.index, 3);
+    BOOST_CHECK(!lexen::fixed::eval(f, r));
+    same();
+    r.set_real(ratio.index, 0.5);
+    r.set_int(size.index, 1);
+    BOOST_CHECK(lexen::fixed::eval(f, r));
+    same();
+    r.set_null(size.index);
+    BOOST_CHECK(!lexen::fixed::eval(f, r));
+    auto small = !(size > 5);
+    BOOST_CHECK(!small(r));
+    same();
+    host_list.push_back("c");
+    r.set_strs(hosts.index, host_list);
+    BOOST_CHECK(!lexen::fixed::eval(g, r));
+    same();
+    r.set_null(name.index);
+    BOOST_CHECK(lexen::fixed::eval(g, r));
+    same();
+}
+
+BOOST_AUTO_TEST_CASE( result_cache_test )
+{
+    lexen::ResultCache cache(1000, 4);
+    BOOST_CHECK_EQUAL(cache.capacity(), 1008u);
+
+    bool r;
+    BOOST_CHECK(!cache.find(1, 42, r));
+    cache.put(1, 42, true);
+    cache.put(2, 42, false);
+    BOOST_CHECK(cache.find(1, 42, r) && r);
+    BOOST_CHECK(cache.find(2, 42, r) && !r);
+    BOOST_CHECK_EQUAL(cache.hits(), 2u);
+    BOOST_CHECK_EQUAL(cache.misses(), 1u);
+
+    // bounded, and an entry hit between misses is never evicted
+    int computed = 0;
+    for (std::uint64_t v = 0; v < 20000; ++v) {
+        cache.get(3, v, [&] { ++computed; return v % 2 == 0; });
+        BOOST_CHECK(cache.find(1, 42, r));
+    }
+    BOOST_CHECK_EQUAL(computed, 20000);
+    std::size_t cached = 0;
+    for (std::uint64_t v = 0; v < 20000; ++v) {
+        if (!cache.find(3, v, r)) continue;
+        ++cached;
+        BOOST_CHECK_EQUAL(r, v % 2 == 0);
+    }
+    BOOST_CHECK_LE(cached + 1, cache.capacity());
+    BOOST_CHECK_GT(cached, 0u);
+
+    // strings are keys of their own, apart from codes of the same hash
+    BOOST_CHECK(!cache.find(4, "x", r));
+    cache.put(4, "x", true);
+    cache.put(4, std::hash<std::string_view>()("x"), false);
+    BOOST_CHECK(cache.find(4, "x", r) && r);
+    BOOST_CHECK(!cache.find(4, "xx", r) && !cache.find(5, "x", r));
+    BOOST_CHECK(cache.find(4, std::uint64_t(std::hash<std::string_view>()("x")), r) && !r);
+    BOOST_CHECK(!cache.get(4, std::string("y"), [] { return false; }));
+    BOOST_CHECK(cache.find(4, "y", r) && !r);
+
+    // predicates and dictionaries get ids of their own
+    auto a = lexen::ResultCache::predicate(), b = lexen::ResultCache::predicate();
+    BOOST_CHECK(a != b);
+    lexen::Dictionary d1, d2;
+    BOOST_CHECK(lexen::ResultCache::key(d1, d1.intern("x")) != lexen::ResultCache::key(d2, d2.intern("y")));
+    cache.put(a, lexen::ResultCache::key(d1, 0), true);
+    BOOST_CHECK(!cache.find(a, lexen::ResultCache::key(d2, 0), r));
+    BOOST_CHECK(!cache.find(b, lexen::ResultCache::key(d1, 0), r));
+
+    // a moved dictionary keeps its id, the moved from one is empty under a
+    // new one, so a reused dictionary does not hit results of the other
+    auto id1 = d1.id(), id2 = d2.id();
+    d2 = std::move(d1);
+    BOOST_CHECK_EQUAL(d2.id(), id1);
+    BOOST_CHECK_EQUAL(d2.str(0), "x");
+    BOOST_CHECK(d1.id() != id1 && d1.id() != id2);
+    BOOST_CHECK_EQUAL(d1.size(), 0u);
+    BOOST_CHECK_EQUAL(d1.intern("z"), 0u);
+    BOOST_CHECK(!cache.find(a, lexen::ResultCache::key(d1, 0), r));
+    lexen::Dictionary d3(std::move(d2));
+    BOOST_CHECK_EQUAL(d3.id(), id1);
+    BOOST_CHECK_EQUAL(d3.find("x"), 0u);
+    BOOST_CHECK(d2.id() != id1 && d2.find("x") == lexen::Dictionary::npos);
+
+    cache.clear();
+    BOOST_CHECK(!cache.find(1, 42, r));
+    BOOST_CHECK_EQUAL(cache.hits() + cache.misses(), 1u);
+
+    // concurrent lookups of a working set fitting in the cache
+    std::vector<std::thread> threads;
+    std::atomic<int> wrong{0};
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&cache, &wrong, t] {
+            for (std::uint64_t i = 0; i < 20000; ++i) {
+                auto v = (i * 7 + std::uint64_t(t)) % 300;
+                if (cache.get(5, v, [v] { return v % 3 == 0; }) != (v % 3 == 0)) ++wrong;
+            }
+        });
+    }
+    for (auto& x : threads) x.join();
+    BOOST_CHECK_EQUAL(wrong.load(), 0);
+    BOOST_CHECK_EQUAL(cache.hits() + cache.misses(), 80001u);
+    BOOST_CHECK_GT(cache.hits(), 70000u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
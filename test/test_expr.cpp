@@ -0,0 +1,168 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions engine - expression store and passes tests
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+
+#include "ast_io.hpp"
+#include "be.hpp"
+#include "expr_store.hpp"
+#include "eval.hpp"
+#include "optimize.hpp"
+#include "record.hpp"
+#include "test_utils.hpp"
+
+#include <limits>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+Exp parse(const std::string& src) {
+    Exp e;
+    BOOST_REQUIRE(lexen::parse_str(src, e));
+    return e;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE( expr_tests )
+
+BOOST_AUTO_TEST_CASE( expr_store_test )
+{
+    add_var("h_flag", var_type::boolean);
+    add_var("h_size", var_type::integer);
+    add_var("h_name", var_type::string);
+
+    auto a = parse("h_flag and (h_size > 3 or h_name = 'x')");
+    auto b = parse("h_size > 3 or h_name = 'x'");
+    auto c = parse("not (h_size > 3 or h_name = 'x') and h_flag");
+
+    lexen::ExprStore store;
+    auto ia = store.intern(a);
+    BOOST_CHECK_EQUAL(store.size(), 5u);
+    BOOST_CHECK_EQUAL(store.intern(parse("h_flag and (h_size > 3 or h_name = 'x')")), ia);
+    auto ib = store.intern(b);
+    BOOST_CHECK_EQUAL(store.size(), 5u);
+    BOOST_CHECK(store.kind(ib) == lexen::ExprStore::Kind::Or);
+    BOOST_CHECK(store.children(ia)[1] == ib);
+
+    auto ic = store.intern(c);
+    BOOST_CHECK_NE(ic, ia);
+    BOOST_CHECK_EQUAL(store.size(), 7u);
+    BOOST_CHECK(store.children(store.children(ic)[0])[0] == ib);
+
+    BOOST_CHECK_EQUAL(store.intern(parse("h_size > 3.0")), store.intern(parse("h_size > 3.0")));
+    BOOST_CHECK_NE(store.intern(parse("h_size > 3.0")), store.intern(parse("h_size > 3")));
+
+    for (auto& e : {a, b, c}) {
+        auto id = store.intern(e);
+        BOOST_CHECK_EQUAL(store.get(id), e);
+        BOOST_CHECK_EQUAL(store.hash(id), boost::hash<Exp>()(e));
+    }
+    BOOST_CHECK_NE(store.hash(ia), store.hash(ic));
+}
+
+BOOST_AUTO_TEST_CASE( optimize_test )
+{
+    add_var("h_flag", var_type::boolean);
+    add_var("h_size", var_type::integer);
+    add_var("h_name", var_type::string);
+    add_var("h_tags", var_type::integers);
+    auto ratio = add_var("h_ratio", var_type::realnum);
+
+    auto check = [] (const std::string& src, const std::string& expected) {
+        BOOST_TEST_CONTEXT(src) {
+            BOOST_CHECK_EQUAL(lexen::optimize(parse(src), lexen::default_schema()), parse(expected));
+        }
+    };
+
+    // constants
+    check("true and h_flag", "h_flag");
+    check("h_flag or false", "h_flag");
+    check("false or h_flag and false", "false");
+    check("h_size > 3 or (true and not false)", "true");
+    check("not (h_flag and true)", "not h_flag");
+
+    // flattening and duplicates
+    check("h_flag and (h_size > 3 and (h_name = 'x' and h_flag))", "h_flag and h_size > 3 and h_name = 'x'");
+    check("(h_flag or h_size > 3) or (h_flag or h_size > 3)", "h_flag or h_size > 3");
+
+    // negation normal form
+    check("not (not h_flag)", "h_flag");
+    check("not (h_size > 3 or h_name = 'x')", "h_size <= 3 and h_name <> 'x'");
+    check("not (h_size is null and h_name is not null)", "h_size is not null or h_name is null");
+    check("not (h_size in (1, 2))", "h_size not in (1, 2)");
+    check("not (2 not in h_tags)", "2 in h_tags");
+    check("not (h_tags one of (1, 2) or h_tags all of (3))", "h_tags none of (1, 2) and not h_tags all of (3)");
+    check("not (h_tags is empty)", "not h_tags is empty");
+
+    // "not x > 3" is true for NaN, "x <= 3" is not
+    check("not (h_ratio > 3 or h_ratio = 1)", "not h_ratio > 3 and h_ratio <> 1");
+    lexen::Record r(lexen::default_schema());
+    r.set_real(ratio, std::numeric_limits<double>::quiet_NaN());
+    for (auto src : {"not h_ratio > 3", "not (h_ratio <= 3 or h_ratio = 1)", "not h_ratio < 3 and h_ratio <> 3"}) {
+        BOOST_TEST_CONTEXT(src) {
+            auto e = parse(src);
+            BOOST_CHECK(lexen::eval(lexen::compile(e), r));
+            BOOST_CHECK(lexen::eval(lexen::compile(lexen::optimize(e, lexen::default_schema())), r));
+        }
+    }
+
+    // types come from the schema given, not the default one
+    lexen::Schema as_int;
+    as_int.add(ratio, var_type::integer);
+    BOOST_CHECK_EQUAL(lexen::optimize(parse("not h_ratio > 3"), as_int), parse("h_ratio <= 3"));
+
+    // absorption
+    check("h_flag and (h_flag or h_size > 3)", "h_flag");
+    check("h_flag or h_size > 3 and not (not h_flag)", "h_flag");
+    check("(h_flag or h_size > 3) and (h_size > 3 or h_flag or h_name = 'x')", "h_flag or h_size > 3");
+    check("(h_flag or h_size > 3) and (h_size > 3 or h_flag)", "h_flag or h_size > 3");
+}
+
+BOOST_AUTO_TEST_CASE( fuse_test )
+{
+    add_var("h_flag", var_type::boolean);
+    add_var("h_size", var_type::integer);
+    add_var("h_name", var_type::string);
+    add_var("h_ratio", var_type::realnum);
+
+    auto check = [] (const std::string& src, const std::string& expected) {
+        BOOST_TEST_CONTEXT(src) {
+            BOOST_CHECK_EQUAL(lexen::fuse(parse(src), lexen::default_schema()), parse(expected));
+        }
+    };
+
+    // ranges
+    check("h_size > 3 and h_size <= 100 and h_size <> 50", "(h_size > 3 and h_size <= 100) and h_size <> 50");
+    check("h_flag and h_size > 3 and h_size <= 100 and h_size > 5", "h_flag and (h_size > 5 and h_size <= 100)");
+    check("h_size < 10 and h_ratio > 1 and h_size >= 2.5 and h_size <> 20", "(h_size >= 2.5 and h_size < 10) and h_ratio > 1");
+    check("h_size > 3 and h_size < 3", "false");
+    check("h_size >= 3 and h_size <= 3", "h_size = 3");
+    check("h_size >= 3 and h_size <= 3 and h_size <> 3", "false");
+    check("h_ratio > 1 and h_ratio < 0.5 or h_flag", "h_flag");
+    check("h_size > 3 or h_size >= 5 or h_size = 7 or h_size = 1", "h_size > 3 or h_size = 1");
+
+    // sets
+    check("h_name = 'a' or h_name = 'b' or h_flag or h_name = 'c'", "h_name in ('a', 'b', 'c') or h_flag");
+    check("h_name in ('a', 'b') and h_name <> 'a'", "h_name = 'b'");
+    check("h_name = 'a' and h_name = 'b'", "false");
+    check("h_name <> 'a' and h_name not in ('b', 'c')", "h_name not in ('a', 'b', 'c')");
+    check("h_size in (1, 2, 3) and h_size in (2, 3, 4)", "h_size in (2, 3)");
+    check("h_size in (1, 5, 9) and h_size > 1 and h_size < 9", "h_size = 5");
+    check("h_size = 1 or h_size in (3, 2) or h_size = 2.5", "h_size in (1, 2, 3)");
+    check("h_ratio = 1 or h_ratio = 2", "h_ratio = 1 or h_ratio = 2");
+    // integer variable is still required not to be null
+    check("h_size <> 5.5 and h_size <> 6.5", "h_size <> 5.5");
+    check("h_size <> 5.5 and h_size <> 6.5 and h_name = 'a'", "h_size <> 5.5 and h_name = 'a'");
+
+    // single predicate per range in compiled form
+    auto p = lexen::compile(lexen::fuse(parse("h_flag and h_size > 3 and h_size <= 100"), lexen::default_schema()));
+    BOOST_CHECK_EQUAL(p.code.size(), 2u);
+    BOOST_CHECK(p.code[1].op == lexen::OpCode::NumRange);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
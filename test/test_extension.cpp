@@ -6,8 +6,16 @@
  * \since 27 December 2023
  */
 
+#include "extension_eval.hpp"
 #include "extension_ast_io.hpp"
+#include "adaptive.hpp"
 #include "be.hpp"
+#include "compact_ast.hpp"
+#include "image.hpp"
+#include "incremental.hpp"
+#include "parallel.hpp"
+#include "record.hpp"
+#include "rule_index.hpp"
 #include "test_utils.hpp"
 
 #include <boost/test/unit_test.hpp>
@@ -30,6 +38,274 @@ BOOST_AUTO_TEST_CASE( extension_parser_test )
     CHECK_PARSE("\"lalala\" <> user", StrCmp(user, CompOp::Ne, "lalala"))
     CHECK_PARSE("user = 'pepepe'", StrCmp(user, CompOp::Eq, "pepepe"))
     CHECK_PARSE("? user fits 'pepepe'", Fits(user, "pepepe"))
+
+    lexen::CompactAst t;
+    BOOST_REQUIRE(lexen::parse_compact("on and ? user fits 'pepepe'", t, lexen::default_schema()));
+    BOOST_CHECK_EQUAL(t.expression(), Exp(Con{{On, Fits(user, "pepepe")}}));
+}
+
+BOOST_AUTO_TEST_CASE( extension_eval_test )
+{
+    auto on = add_var("e_on", var_type::boolean);
+    auto user = add_var("e_user", var_type::string);
+
+    Exp e;
+    BOOST_REQUIRE(lexen::parse_str("e_on and ? e_user fits 'a*d*n' or ? e_user fits 'bob'", e));
+    auto p = lexen::compile(e);
+    BOOST_REQUIRE_EQUAL(p.ext.size(), 2u);
+    // leaves are emitted backwards
+    BOOST_CHECK_EQUAL(p.ext[0].parts[0], "bob");
+    BOOST_CHECK_EQUAL(p.ext[1].parts.size(), 3u);
+
+    // cost hint of the compiled form
+    for (auto& in : p.code)
+        if (in.op == lexen::OpCode::Ext)
+            BOOST_CHECK_EQUAL(lexen::detail::op_cost(p, in), 4.0 * double(p.ext[in.arg.slice.offset].parts.size()));
+
+    lexen::Record r(lexen::default_schema());
+    BOOST_CHECK(!lexen::eval(p, r));
+    r.set_str(user, "bob");
+    BOOST_CHECK(lexen::eval(p, r));
+    r.set_str(user, "admin");
+    BOOST_CHECK(!lexen::eval(p, r));
+    r.set_bool(on, true);
+    BOOST_CHECK(lexen::eval(p, r));
+    r.set_str(user, "adn");
+    BOOST_CHECK(lexen::eval(p, r));
+    r.set_str(user, "amin");
+    BOOST_CHECK(!lexen::eval(p, r));
+
+    // batch hook sees reached rows only, results match row at a time
+    static const std::string_view pool[] = {"admin", "bob", "alan", "ada", "aiden", "root"};
+    const std::size_t rows = 200;
+    bool ons[rows];
+    std::string_view users[rows];
+    lexen::Bitmap valid(lexen::simd::words(rows), 0);
+    for (std::size_t i = 0; i < rows; ++i) {
+        ons[i] = i % 4 != 0;
+        users[i] = pool[i % 6];
+        if (i % 7) valid[i / 64] |= std::uint64_t(1) << (i % 64);
+    }
+    lexen::Batch b(lexen::default_schema(), rows);
+    b.set_bools(on, ons);
+    b.set_strs(user, users, valid.data());
+    ext::batch_calls = 0;
+    auto result = lexen::eval(p, b);
+    BOOST_CHECK_EQUAL(ext::batch_calls, 2);
+    for (std::size_t i = 0; i < rows; ++i)
+        BOOST_CHECK_EQUAL(lexen::test_bit(result.data(), i), lexen::eval(p, lexen::BatchRow(b, i)));
+}
+
+BOOST_AUTO_TEST_CASE( extension_cache_test )
+{
+    auto user = add_var("c_user", var_type::string);
+
+    Exp e;
+    BOOST_REQUIRE(lexen::parse_str("? c_user fits 'a*n' or ? c_user fits '*o*'", e));
+    auto p = lexen::compile(e);
+    // every distinct extension is a predicate of its own, the same one in
+    // every program
+    auto q = lexen::compile(e);
+    Exp f;
+    BOOST_REQUIRE(lexen::parse_str("c_user = 'x' or ? c_user fits '*o*'", f));
+    auto s = lexen::compile(f);
+    BOOST_REQUIRE_EQUAL(p.ext_ids.size(), 2u);
+    BOOST_CHECK(p.ext_ids[0] != p.ext_ids[1]);
+    BOOST_CHECK(p.ext_ids == q.ext_ids);
+    BOOST_REQUIRE_EQUAL(s.ext_ids.size(), 1u);
+    BOOST_CHECK(s.ext_ids[0] == p.ext_ids[0] || s.ext_ids[0] == p.ext_ids[1]);
+
+    // dictionary-encoded columns of few distinct values, same codes of
+    // different strings in the two dictionaries
+    lexen::Dictionary dict, other;
+    const std::size_t rows = 500;
+    std::uint32_t codes[rows], other_codes[rows];
+    for (std::size_t i = 0; i < rows; ++i) {
+        codes[i] = dict.intern(i % 5 ? "user" + std::to_string(i % 9) : "admin");
+        other_codes[i] = i % 10;
+    }
+    for (auto x : {"root", "bob", "alan", "x", "y", "z", "ann", "sam", "fin", "oz"}) other.intern(x);
+    lexen::Bitmap valid(lexen::simd::words(rows), 0);
+    for (std::size_t i = 0; i < rows; ++i)
+        if (i % 11) valid[i / 64] |= std::uint64_t(1) << (i % 64);
+    lexen::Batch b(lexen::default_schema(), rows), c(lexen::default_schema(), rows);
+    b.set_str_codes(user, codes, dict, valid.data());
+    c.set_str_codes(user, other_codes, other);
+
+    auto plain_b = lexen::eval(p, b);
+    auto plain_c = lexen::eval(p, c);
+    lexen::ResultCache cache(1024);
+    lexen::BatchContext ctx;
+    ctx.ext_cache = &cache;
+    ext::batch_calls = 0;
+    BOOST_CHECK(lexen::eval(p, b, ctx) == plain_b);
+    auto misses = cache.misses();
+    BOOST_CHECK(lexen::eval(p, b, ctx) == plain_b);
+    BOOST_CHECK(lexen::eval(p, c, ctx) == plain_c);
+    BOOST_CHECK(lexen::eval(q, c, ctx) == plain_c);
+    BOOST_CHECK_EQUAL(ext::batch_calls, 0);
+
+    // one miss per distinct value of each predicate and dictionary
+    BOOST_CHECK_LE(misses, 2 * dict.size());
+    BOOST_CHECK_LE(cache.misses(), misses + 4 * other.size());
+    BOOST_CHECK_GT(cache.hits(), 0u);
+
+    // workers of the parallel driver share the cache of the context given
+    lexen::ThreadPool pool(3);
+    lexen::ParallelEval par(pool, 64, ctx);
+    misses = cache.misses();
+    auto hits = cache.hits();
+    BOOST_CHECK(par.eval(p, b) == plain_b);
+    BOOST_CHECK_EQUAL(cache.misses(), misses);
+    BOOST_CHECK_GT(cache.hits(), hits);
+    BOOST_CHECK_EQUAL(ext::batch_calls, 0);
+}
+
+BOOST_AUTO_TEST_CASE( extension_record_cache_test )
+{
+    auto on = add_var("k_on", var_type::boolean);
+    auto user = add_var("k_user", var_type::string);
+
+    std::vector<Exp> exprs;
+    for (auto src : {"k_on and ? k_user fits 'a*n'", "? k_user fits 'a*n' or ? k_user fits 'bob'",
+        "not ? k_user fits 'bob'"})
+    {
+        exprs.emplace_back();
+        BOOST_REQUIRE(lexen::parse_str(src, exprs.back()));
+    }
+    lexen::RuleSet set;
+    for (auto& e : exprs) set.add(e);
+    set.build();
+    auto p = lexen::compile(exprs[1]);
+    lexen::AdaptiveProgram adaptive(exprs[1], lexen::default_schema(), 2, 4);
+    lexen::RuleSetDeps deps(set.view());
+    lexen::RuleIndex index;
+    for (auto& e : exprs) index.add(e);
+    index.build();
+
+    lexen::ResultCache cache(1024);
+    lexen::RuleSetContext plain_ctx, ctx;
+    ctx.ext_cache = &cache;
+    lexen::RuleSetState state;
+    state.preds.ext_cache = &cache;
+    lexen::MatchContext match_ctx;
+    match_ctx.preds.ext_cache = &cache;
+    adaptive.set_ext_cache(&cache);
+    lexen::StrKeyCache keys;
+
+    static const char* names[] = {"admin", "bob", "alan", "root", "ann"};
+    std::vector<std::uint32_t> plain, out, indexed, matched;
+    lexen::Record r(lexen::default_schema());
+    auto run = [&] (std::size_t i, bool first) {
+        r.set_str(user, names[i % 5]);
+        r.set_bool(on, i % 3 != 0);
+        if (i % 7 == 0) r.set_null(user);
+        set.eval(r, plain_ctx, plain);
+        BOOST_CHECK_EQUAL(lexen::eval(p, r, keys, &cache), lexen::eval(p, r));
+        BOOST_CHECK_EQUAL(adaptive.eval(r), lexen::eval(p, r));
+        set.eval(r, ctx, out);
+        BOOST_CHECK(out == plain);
+        set.view().eval(r, ctx, out);
+        BOOST_CHECK(out == plain);
+        index.match(r, match_ctx, indexed);
+        std::sort(indexed.begin(), indexed.end());
+        BOOST_CHECK(indexed == plain);
+        if (first) deps.eval(r, state);
+        else {
+            VarIdx vars[] = {on, user};
+            std::vector<std::uint32_t> flipped;
+            deps.update(r, lexen::ListView<VarIdx>(vars, 2), state, flipped);
+        }
+        deps.matches(state, matched);
+        BOOST_CHECK(matched == plain);
+    };
+    run(0, true);
+    for (std::size_t i = 1; i < 40; ++i) run(i, false);
+
+    // cached runs call the hook on misses only: once per distinct value of
+    // each of the two extensions, the same in every program and path
+    BOOST_CHECK_EQUAL(cache.misses(), 2 * 5u);
+    ext::record_calls = 0;
+    for (std::size_t i = 1; i < 40; ++i) {
+        if (i % 7 == 0) continue;
+        r.set_str(user, names[i % 5]);
+        set.eval(r, ctx, out);
+        lexen::eval(p, r, keys, &cache);
+        lexen::eval(lexen::compile(exprs[1]), r, keys, &cache);
+    }
+    BOOST_CHECK_EQUAL(ext::record_calls, 0);
+    BOOST_CHECK_EQUAL(cache.misses(), 2 * 5u);
+
+    // string keys are compared in full
+    Exp e;
+    BOOST_REQUIRE(lexen::parse_str("? k_user fits 'ab*'", e));
+    auto q = lexen::compile(e);
+    for (auto name : {"abc", "xbc", "ab", "b"}) {
+        r.set_str(user, name);
+        BOOST_CHECK_EQUAL(lexen::eval(q, r, keys, &cache), name[0] == 'a');
+        BOOST_CHECK_EQUAL(lexen::eval(q, r, keys, &cache), name[0] == 'a');
+    }
+}
+
+BOOST_AUTO_TEST_CASE( extension_rules_test )
+{
+    auto on = add_var("r_on", var_type::boolean);
+    auto user = add_var("r_user", var_type::string);
+
+    std::vector<Exp> exprs;
+    for (auto src : {"r_on and ? r_user fits 'a*n'", "? r_user fits 'a*n' or ? r_user fits 'bob'",
+        "not ? r_user fits 'bob' and r_on", "r_user = 'root'"})
+    {
+        exprs.emplace_back();
+        BOOST_REQUIRE(lexen::parse_str(src, exprs.back()));
+    }
+    lexen::RuleSet set;
+    lexen::RuleIndex index;
+    for (auto& e : exprs) {
+        set.add(e);
+        index.add(e);
+    }
+    set.build();
+    index.build();
+    // shared predicates are stored once
+    BOOST_CHECK_EQUAL(set.predicates(), 4u);
+    // compiled extensions are not plain data
+    BOOST_CHECK(lexen::save_image(set.view(), lexen::default_schema()).empty());
+    BOOST_CHECK(lexen::save_image(index.view(), lexen::default_schema()).empty());
+
+    lexen::RuleSetDeps deps(set.view());
+    lexen::RuleSetState state;
+    lexen::RuleSetContext ctx;
+    lexen::MatchContext match_ctx;
+    std::vector<std::uint32_t> out, viewed, indexed, flipped, matched;
+    lexen::Record r(lexen::default_schema());
+    bool first = true;
+    for (auto name : {"admin", "bob", "root", "alan", "ada"}) {
+        BOOST_TEST_CONTEXT(name) {
+            r.set_str(user, name);
+            r.set_bool(on, name[1] != 'o');
+            std::vector<std::uint32_t> expected;
+            for (std::uint32_t i = 0; i < exprs.size(); ++i)
+                if (lexen::eval(lexen::compile(exprs[i]), r)) expected.push_back(i);
+
+            set.eval(r, ctx, out);
+            BOOST_CHECK(out == expected);
+            set.view().eval(r, ctx, viewed);
+            BOOST_CHECK(viewed == expected);
+            index.match(r, match_ctx, indexed);
+            std::sort(indexed.begin(), indexed.end());
+            BOOST_CHECK(indexed == expected);
+
+            if (first) deps.eval(r, state);
+            else {
+                VarIdx vars[] = {on, user};
+                deps.update(r, lexen::ListView<VarIdx>(vars, 2), state, flipped);
+            }
+            first = false;
+            deps.matches(state, matched);
+            BOOST_CHECK(matched == expected);
+        }
+    }
 }
 
 BOOST_AUTO_TEST_SUITE_END()
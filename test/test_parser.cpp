@@ -8,9 +8,12 @@
 
 #include "ast_io.hpp"
 #include "be.hpp"
+#include "compact_ast.hpp"
+#include "schema.hpp"
 #include "test_utils.hpp"
 
 #include <boost/test/unit_test.hpp>
+#include <thread>
 
 BOOST_AUTO_TEST_SUITE( parser_tests )
 
@@ -75,4 +78,106 @@ BOOST_AUTO_TEST_CASE( simple_test )
     CHECK_PARSE("nodes none of ('abc', 'xyz', '123')", NoneOf(nodes, {s("abc"), s("xyz"), s("123")}))
 }
 
+BOOST_AUTO_TEST_CASE( schema_test )
+{
+    // same name of different type in independent schemas
+    lexen::Schema a, b;
+    auto a_x = a.add("x", var_type::integer);
+    auto b_y = b.add("y", var_type::boolean);
+    auto b_x = b.add("x", var_type::string);
+    BOOST_CHECK_EQUAL(a_x.index, 1);
+    BOOST_CHECK_EQUAL(b_x.index, 2);
+    BOOST_CHECK(b.type(b_x) == var_type::string);
+
+    Exp e;
+    BOOST_CHECK(lexen::parse_str("x > 5", e, a));
+    BOOST_CHECK_EQUAL(e, NumCmp(a_x, CompOp::Gt, 5));
+    BOOST_CHECK(!lexen::parse_str("x > 5", e, b));
+    BOOST_CHECK(lexen::parse_str("y and x = 'z'", e, b));
+    BOOST_CHECK_EQUAL(e, AND(Exp(b_y), StrCmp(b_x, CompOp::Eq, "z")));
+    BOOST_CHECK(!lexen::parse_str("y", e, a));
+    BOOST_CHECK(!lexen::parse_str("y", e));
+
+    // moved from schema does not share names with the moved to one
+    lexen::Schema c(std::move(b));
+    BOOST_CHECK(lexen::parse_str("y and x = 'z'", e, c));
+    BOOST_CHECK_EQUAL(c.vars(), 3);
+    BOOST_CHECK_EQUAL(b.vars(), 0);
+    BOOST_CHECK(!lexen::parse_str("y", e, b));
+    BOOST_CHECK_EQUAL(b.add("z", var_type::boolean).index, 1);
+    BOOST_CHECK(lexen::parse_str("z", e, b));
+    BOOST_CHECK(!lexen::parse_str("z", e, c));
+    b = std::move(c);
+    c.add("w", var_type::boolean);
+    BOOST_CHECK(lexen::parse_str("y and x = 'z'", e, b));
+    BOOST_CHECK(!lexen::parse_str("z", e, b));
+    BOOST_CHECK(!lexen::parse_str("w", e, b));
+
+    // concurrent parsing
+    std::vector<std::thread> threads;
+    std::vector<int> ok(4, 0);
+    for (std::size_t i = 0; i < ok.size(); ++i) {
+        threads.emplace_back([&, i] {
+            for (int n = 0; n < 200; ++n) {
+                Exp x;
+                auto src = "x >= " + std::to_string(n) + " or x in (1, 2, " + std::to_string(i) + ")";
+                ok[i] += lexen::parse_str(src, x, a);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    for (auto n : ok) BOOST_CHECK_EQUAL(n, 200);
+}
+
+BOOST_AUTO_TEST_CASE( compact_test )
+{
+    lexen::Schema schema;
+    schema.add("on", var_type::boolean);
+    schema.add("width", var_type::integer);
+    schema.add("ratio", var_type::realnum);
+    schema.add("user", var_type::string);
+    schema.add("segments", var_type::integers);
+    schema.add("nodes", var_type::strings);
+
+    lexen::CompactAst t;
+    for (auto src : {
+        "on", "true", "not (on or false)", "segments is empty and width is not null",
+        "width > 5 and 1.5 >= ratio or not width <> 3",
+        "'lalala' <> user or user = \"pepepe\" || on && ratio < -0.25",
+        "123 in segments and width not in (1, 2, 3)",
+        "'xoxoxo' not in nodes or user in ('you', 'me')",
+        "segments all of (1, 2) and nodes none of ('abc', 'xyz') or segments one of (4)",
+        "on and (width > 1 or (ratio < 2 and not (user = 'x'))) and (on)",
+    }) {
+        BOOST_TEST_CONTEXT(src) {
+            Exp e;
+            BOOST_REQUIRE(lexen::parse_str(src, e, schema));
+            BOOST_REQUIRE(lexen::parse_compact(src, t, schema));
+            BOOST_CHECK_EQUAL(t.expression(), e);
+            // tree copy
+            auto id = t.add(e);
+            BOOST_CHECK_EQUAL(t.expression(id), e);
+        }
+    }
+
+    // failed parse leaves the arena as it was
+    auto m = t.mark();
+    Exp e;
+    for (auto src : {"width > 1 and (user = 'x' or", "width in (1, 2", "on and", "user = 'x' segments"}) {
+        BOOST_CHECK(!lexen::parse_compact(src, t, schema));
+        BOOST_CHECK_EQUAL(t.nodes.size(), m.nodes);
+        BOOST_CHECK_EQUAL(t.chars.size(), m.chars);
+        BOOST_CHECK_EQUAL(t.ints.size(), m.ints);
+        BOOST_CHECK(t.stack.empty());
+    }
+
+    // backtracking over alternatives leaves no garbage
+    t.clear();
+    BOOST_REQUIRE(lexen::parse_compact("(user = 'x') or user in ('y', 'z')", t, schema));
+    BOOST_CHECK_EQUAL(t.nodes.size(), 3u);
+    BOOST_CHECK_EQUAL(t.strs.size(), 3u);
+    BOOST_CHECK_EQUAL(t.chars, "xyz");
+    BOOST_CHECK_EQUAL(sizeof(lexen::Node), 16u);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
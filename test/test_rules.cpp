@@ -0,0 +1,433 @@
+// ex: ts=4 sw=4 ft=cpp et indentexpr=
+/**
+ * \file
+ * \brief Boolean Expressions engine - rule sets unit tests
+ * \author Dmitriy Kargapolov
+ * \since 17 October 2026
+ */
+
+#include "ast_io.hpp"
+#include "be.hpp"
+#include "image.hpp"
+#include "incremental.hpp"
+#include "loader.hpp"
+#include "record.hpp"
+#include "rule_index.hpp"
+#include "rule_set.hpp"
+#include "test_utils.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <iterator>
+#include <fstream>
+#include <set>
+
+namespace {
+
+struct TestRules {
+    VarIdx flag = test_var("x_flag", var_type::boolean);
+    VarIdx size = test_var("x_size", var_type::integer);
+    VarIdx ratio = test_var("x_ratio", var_type::realnum);
+    VarIdx name = test_var("x_name", var_type::string);
+    VarIdx tags = test_var("x_tags", var_type::integers);
+    VarIdx hosts = test_var("x_hosts", var_type::strings);
+
+    std::vector<Exp> rules;
+    std::vector<lexen::Program> programs;
+
+    TestRules() {
+        for (auto src : {
+            "x_flag",
+            "not x_flag and x_size > 3",
+            "x_size = 5 or x_size in (7, 9)",
+            "x_size >= 2 and x_size <= 6 and x_name = 'a'",
+            "x_ratio < 0.5 or x_ratio >= 2.5",
+            "x_name in ('a', 'c') and x_size <> 4",
+            "3 in x_tags or 'h1' in x_hosts",
+            "x_tags one of (1, 2) and (x_flag or x_ratio > 1)",
+            "x_hosts one of ('h0', 'h2') and not x_size < 3",
+            "x_tags all of (1, 2) or x_name is null",
+            "x_size is not null",
+            "true",
+            "false and x_flag",
+            "(x_size > 1 or x_size < -1) and (x_name = 'a' or x_name = 'b')",
+        }) {
+            rules.emplace_back();
+            BOOST_REQUIRE(lexen::parse_str(src, rules.back()));
+            programs.push_back(lexen::compile(rules.back()));
+        }
+    }
+
+    // matches of all the rules must be the same as of one by one evaluation;
+    // returns the number of distinct match sets seen
+    template<typename Match>
+    std::size_t run(Match match) const {
+        static const std::string_view names[] = {"a", "b", "c"};
+        static const std::string_view host_pool[] = {"h0", "h1", "h2", "h3"};
+        lexen::Record r(lexen::default_schema());
+        std::set<std::vector<std::uint32_t>> seen;
+        for (int i = 0; i < 500; ++i) {
+            std::vector<int> tag_list;
+            for (int j = 0; j < i % 4; ++j) tag_list.push_back((i + j * 3) % 5);
+            r.clear();
+            if (i % 7) r.set_bool(flag, i % 3 == 0);
+            if (i % 11) r.set_int(size, i % 13 - 3);
+            r.set_real(ratio, (i % 9) * 0.4);
+            if (i % 4) r.set_str(name, names[i % 3]);
+            r.set_ints(tags, tag_list);
+            r.set_strs(hosts, lexen::ListView<std::string_view>(host_pool + i % 3, i % 2 + 1));
+
+            std::vector<std::uint32_t> expected;
+            for (std::uint32_t k = 0; k < programs.size(); ++k)
+                if (lexen::eval(programs[k], r)) expected.push_back(k);
+            auto matched = match(r);
+            BOOST_CHECK_EQUAL_COLLECTIONS(matched.begin(), matched.end(), expected.begin(), expected.end());
+            seen.insert(expected);
+        }
+        return seen.size();
+    }
+};
+
+}
+
+BOOST_AUTO_TEST_SUITE( rules_tests )
+
+BOOST_AUTO_TEST_CASE( rule_index_test )
+{
+    TestRules t;
+    lexen::RuleIndex index;
+    for (std::uint32_t i = 0; i < t.rules.size(); ++i)
+        BOOST_CHECK_EQUAL(index.add(t.rules[i]), i);
+    index.build();
+
+    lexen::MatchContext ctx;
+    std::vector<std::uint32_t> matched;
+    BOOST_CHECK_GT(t.run([&] (const lexen::Record& r) {
+        index.match(r, ctx, matched);
+        return matched;
+    }), 100u);
+}
+
+BOOST_AUTO_TEST_CASE( rule_set_test )
+{
+    TestRules t;
+    lexen::RuleSet set;
+    for (std::uint32_t i = 0; i < t.rules.size(); ++i)
+        BOOST_CHECK_EQUAL(set.add(t.rules[i]), i);
+    set.build();
+    BOOST_CHECK_EQUAL(set.size(), t.rules.size());
+    // 27 leaves, x_flag and x_name = 'a' are shared
+    BOOST_CHECK_EQUAL(set.predicates(), 23u);
+
+    lexen::RuleSetContext ctx;
+    std::vector<std::uint32_t> matched;
+    BOOST_CHECK_GT(t.run([&] (const lexen::Record& r) {
+        set.eval(r, ctx, matched);
+        return matched;
+    }), 100u);
+
+    // a lower then an upper bound of a variable stay two predicates
+    auto width = add_var("rs_width", var_type::integer);
+    lexen::RuleSet bounds;
+    for (auto src : {"rs_width > 3", "rs_width < 10"}) {
+        Exp e;
+        BOOST_REQUIRE(lexen::parse_str(src, e));
+        bounds.add(e);
+    }
+    bounds.build();
+    BOOST_CHECK_EQUAL(bounds.predicates(), 2u);
+    lexen::Record r(lexen::default_schema());
+    for (int x : {0, 5, 20}) {
+        r.set_int(width, x);
+        bounds.eval(r, ctx, matched);
+        std::vector<std::uint32_t> expected;
+        if (x > 3) expected.push_back(0);
+        if (x < 10) expected.push_back(1);
+        BOOST_CHECK_EQUAL_COLLECTIONS(matched.begin(), matched.end(), expected.begin(), expected.end());
+    }
+}
+
+BOOST_AUTO_TEST_CASE( incremental_test )
+{
+    TestRules t;
+    lexen::RuleSet set;
+    for (auto& e : t.rules) set.add(e);
+    set.build();
+    lexen::RuleSetDeps deps(set.view());
+
+    static const std::string_view names[] = {"a", "b", "c"};
+    static const std::string_view host_pool[] = {"h0", "h1", "h2", "h3"};
+    static const std::vector<int> tag_lists[] = {{}, {1}, {3, 1, 2}, {2, 4}};
+    lexen::Record r(lexen::default_schema());
+    lexen::RuleSetState state;
+    deps.eval(r, state);
+
+    std::vector<std::uint32_t> before, after, flipped, expected;
+    std::size_t flips = 0;
+    deps.matches(state, before);
+    const VarIdx all[] = {t.flag, t.size, t.ratio, t.name, t.tags, t.hosts};
+    for (int i = 0; i < 500; ++i) {
+        // one or two variables change, sometimes to null
+        std::vector<VarIdx> changed{all[i % 6]};
+        if (i % 3 == 0) changed.push_back(all[(i * 7 + 2) % 6]);
+        for (auto var : changed) {
+            if (i % 5 == 0) r.set_null(var);
+            else if (var == t.flag) r.set_bool(var, i % 2);
+            else if (var == t.size) r.set_int(var, i % 13 - 3);
+            else if (var == t.ratio) r.set_real(var, (i % 9) * 0.4);
+            else if (var == t.name) r.set_str(var, names[i % 3]);
+            else if (var == t.tags) r.set_ints(var, tag_lists[i % 4]);
+            else r.set_strs(var, lexen::ListView<std::string_view>(host_pool + i % 3, i % 2 + 1));
+        }
+        deps.update(r, changed, state, flipped);
+
+        expected.clear();
+        for (std::uint32_t k = 0; k < t.programs.size(); ++k)
+            if (lexen::eval(t.programs[k], r)) expected.push_back(k);
+        deps.matches(state, after);
+        BOOST_CHECK_EQUAL_COLLECTIONS(after.begin(), after.end(), expected.begin(), expected.end());
+
+        std::vector<std::uint32_t> diff;
+        std::set_symmetric_difference(before.begin(), before.end(), after.begin(), after.end(),
+            std::back_inserter(diff));
+        BOOST_CHECK_EQUAL_COLLECTIONS(flipped.begin(), flipped.end(), diff.begin(), diff.end());
+        flips += flipped.size();
+        before = after;
+    }
+    // most updates flip some rule
+    BOOST_CHECK_GT(flips, 500u);
+
+    // variables no rule reads change nothing
+    deps.update(r, std::vector<VarIdx>{VarIdx(10000)}, state, flipped);
+    BOOST_CHECK(flipped.empty());
+}
+
+BOOST_AUTO_TEST_CASE( image_test )
+{
+    TestRules t;
+    auto& schema = lexen::default_schema();
+    std::string data;
+    {
+        lexen::RuleSet set;
+        for (auto& e : t.rules) set.add(e);
+        set.build();
+        data = lexen::save_image(set.view(), schema);
+    }
+
+    lexen::RuleSetView view;
+    BOOST_REQUIRE(lexen::view_image(data, schema, view));
+    BOOST_CHECK_EQUAL(view.size(), t.rules.size());
+    lexen::RuleSetContext ctx;
+    std::vector<std::uint32_t> matched;
+    BOOST_CHECK_GT(t.run([&] (const lexen::Record& r) {
+        view.eval(r, ctx, matched);
+        return matched;
+    }), 100u);
+
+    auto path = "/tmp/lexen_image_test.bin";
+    std::ofstream(path, std::ios::binary).write(data.data(), std::streamsize(data.size()));
+    lexen::RuleSetImage image(path, schema);
+    BOOST_REQUIRE(image.is_open());
+    BOOST_CHECK_GT(t.run([&] (const lexen::Record& r) {
+        image.rules().eval(r, ctx, matched);
+        return matched;
+    }), 100u);
+    std::remove(path);
+
+    // saved bytes do not depend on padding left in memory
+    {
+        lexen::RuleSet set;
+        for (auto& e : t.rules) set.add(e);
+        set.build();
+        BOOST_CHECK(lexen::save_image(set.view(), schema) == data);
+    }
+
+    // schema giving variables read other types, or lacking them
+    lexen::Schema other;
+    for (int i = 1; i < schema.vars(); ++i) {
+        if (!schema.has(VarIdx(i))) continue;
+        auto type = schema.type(VarIdx(i));
+        other.add(VarIdx(i), type == var_type::integer ? var_type::realnum : type);
+    }
+    BOOST_CHECK(!lexen::view_image(data, other, view));
+    BOOST_CHECK(!lexen::view_image(data, lexen::Schema(), view));
+    BOOST_CHECK(!lexen::RuleSetImage(path, schema).is_open());
+
+    // and no image is saved against a schema lacking them, not even a file
+    {
+        lexen::RuleSet set;
+        for (auto& e : t.rules) set.add(e);
+        set.build();
+        BOOST_CHECK(lexen::save_image(set.view(), lexen::Schema()).empty());
+        BOOST_CHECK(!lexen::save_image(set.view(), lexen::Schema(), path));
+        BOOST_CHECK(!std::ifstream(path).is_open());
+    }
+
+    // corrupt contents within section bounds
+    auto corrupt = [&] (lexen::image::Section s, std::size_t at, auto f) {
+        lexen::image::Header h;
+        std::memcpy(&h, data.data(), sizeof(h));
+        std::string bad = data;
+        auto in = reinterpret_cast<lexen::Instr*>(&bad[h.extents[s].offset]) + at;
+        f(*in);
+        return !lexen::view_image(bad, schema, view);
+    };
+    BOOST_CHECK(corrupt(lexen::image::RuleCode, 0, [] (lexen::Instr& in) { in.on_true = 0; }));
+    BOOST_CHECK(corrupt(lexen::image::RuleCode, 1, [] (lexen::Instr& in) { in.arg.ival = 1 << 20; }));
+    BOOST_CHECK(corrupt(lexen::image::Code, 0, [] (lexen::Instr& in) { in.op = lexen::OpCode::Pred; }));
+    BOOST_CHECK(corrupt(lexen::image::Code, 0, [] (lexen::Instr& in) {
+        in.op = lexen::OpCode::StrEq;
+        in.arg.slice = lexen::Slice{0, 1u << 30};
+    }));
+    BOOST_CHECK(corrupt(lexen::image::Code, 0, [] (lexen::Instr& in) { in.on_false = 100000; }));
+    // bool bytes other than 0 and 1
+    auto bad_neg = [] (lexen::Instr& in) { reinterpret_cast<unsigned char*>(&in)[offsetof(lexen::Instr, neg)] = 255; };
+    BOOST_CHECK(corrupt(lexen::image::Code, 0, bad_neg));
+    BOOST_CHECK(corrupt(lexen::image::RuleCode, 0, bad_neg));
+    // op code not applicable to the type of the variable
+    std::size_t str_eq = 0;
+    while (view.preds.code[str_eq].op != lexen::OpCode::StrEq) ++str_eq;
+    BOOST_CHECK(corrupt(lexen::image::Code, str_eq, [] (lexen::Instr& in) { in.op = lexen::OpCode::HasInt; }));
+    BOOST_CHECK(corrupt(lexen::image::Code, str_eq, [] (lexen::Instr& in) { in.op = lexen::OpCode::BoolVar; }));
+
+    // truncated and foreign images
+    BOOST_CHECK(lexen::view_image(data, schema, view));
+    BOOST_CHECK(!lexen::view_image(std::string_view(data).substr(0, data.size() - 8), schema, view));
+    data[8] = char(data[8] + 1);
+    BOOST_CHECK(!lexen::view_image(data, schema, view));
+    BOOST_CHECK(!lexen::RuleSetImage("/nonexistent/rules.bin", schema).is_open());
+}
+
+BOOST_AUTO_TEST_CASE( index_image_test )
+{
+    TestRules t;
+    auto& schema = lexen::default_schema();
+    std::string data;
+    {
+        lexen::RuleIndex index;
+        for (auto& e : t.rules) index.add(e);
+        index.build();
+        data = lexen::save_image(index.view(), schema);
+        // same bytes from the same rules
+        lexen::RuleIndex again;
+        for (auto& e : t.rules) again.add(e);
+        again.build();
+        BOOST_CHECK(lexen::save_image(again.view(), schema) == data);
+    }
+
+    lexen::RuleIndexView view;
+    BOOST_REQUIRE(lexen::view_image(data, schema, view));
+    BOOST_CHECK_EQUAL(view.size(), t.rules.size());
+    lexen::MatchContext ctx;
+    std::vector<std::uint32_t> matched;
+    BOOST_CHECK_GT(t.run([&] (const lexen::Record& r) {
+        view.match(r, ctx, matched);
+        return matched;
+    }), 100u);
+
+    auto path = "/tmp/lexen_index_image_test.bin";
+    BOOST_REQUIRE(lexen::save_image(view, schema, path));
+    lexen::RuleIndexImage image(path, schema);
+    BOOST_REQUIRE(image.is_open());
+    BOOST_CHECK_GT(t.run([&] (const lexen::Record& r) {
+        image.rules().match(r, ctx, matched);
+        return matched;
+    }), 100u);
+    // an index image is not a rule set image
+    BOOST_CHECK(!lexen::RuleSetImage(path, schema).is_open());
+    std::remove(path);
+
+    // corrupt contents within section bounds
+    auto corrupt = [&] (auto f) {
+        lexen::image::Header h;
+        std::memcpy(&h, data.data(), sizeof(h));
+        std::string bad = data;
+        f([&] (lexen::image::Section s) { return &bad[h.extents[s].offset]; });
+        return !lexen::view_image(bad, schema, view);
+    };
+    std::size_t str_var = 0;
+    while (view.vars[str_var].kind != lexen::IndexKind::Str) ++str_var;
+    auto strs = view.vars[str_var].strs;
+    BOOST_REQUIRE_GE(strs.size, 2u);
+    // kind not applicable to the type of the variable
+    BOOST_CHECK(corrupt([&] (auto at) {
+        reinterpret_cast<lexen::IndexVar*>(at(lexen::image::IndexVars))[str_var].kind = lexen::IndexKind::Num;
+    }));
+    // entries out of order, or with values out of bounds
+    BOOST_CHECK(corrupt([&] (auto at) {
+        auto e = reinterpret_cast<lexen::StrEntry*>(at(lexen::image::IndexStrs)) + strs.offset;
+        std::swap(e[0], e[1]);
+    }));
+    BOOST_CHECK(corrupt([&] (auto at) {
+        reinterpret_cast<lexen::StrEntry*>(at(lexen::image::IndexStrs))[strs.offset].value.size = 1u << 30;
+    }));
+    // postings to conjuncts that are not there, or more than they need
+    BOOST_CHECK(corrupt([&] (auto at) {
+        reinterpret_cast<std::uint32_t*>(at(lexen::image::IndexPostings))[0] = 1u << 20;
+    }));
+    BOOST_CHECK(corrupt([&] (auto at) {
+        ++reinterpret_cast<lexen::IndexConjunct*>(at(lexen::image::IndexConjuncts))[0].need;
+    }));
+}
+
+BOOST_AUTO_TEST_CASE( loader_test )
+{
+    lexen::Schema schema;
+    auto flag = schema.add("flag", var_type::boolean);
+    auto size = schema.add("size", var_type::integer);
+
+    std::string text;
+    for (int i = 0; i < 2000; ++i) {
+        if (i % 100 == 7) text += "size > and flag\n";
+        else if (i % 10 == 3) text += "r" + std::to_string(i) + "\tsize\t< " + std::to_string(i) + "\r\n";
+        else if (i % 10 == 5) text += "  \n";
+        else if (i % 10 == 9) text += "flag or\tsize =\t" + std::to_string(i) + "\n";
+        else text += "flag or size = " + std::to_string(i) + "\n";
+    }
+    text += "size >= 1 flag";
+
+    lexen::ThreadPool pool(4);
+    auto check = [&] (const lexen::RuleFile& f) {
+        BOOST_REQUIRE_EQUAL(f.errors.size(), 21u);
+        BOOST_REQUIRE_EQUAL(f.rules.size(), 2000u - 20 - 200);
+        BOOST_CHECK_EQUAL(f.errors[0].line, 8u);
+        BOOST_CHECK_EQUAL(f.errors[0].column, 1u);
+        BOOST_CHECK_EQUAL(f.errors.back().line, 2001u);
+        BOOST_CHECK_EQUAL(f.errors.back().column, 11u);
+        for (auto& r : f.rules) {
+            auto i = int(r.line) - 1;
+            BOOST_TEST_CONTEXT("line " << r.line) {
+                if (i % 10 == 3) {
+                    BOOST_CHECK_EQUAL(r.id, "r" + std::to_string(i));
+                    BOOST_CHECK_EQUAL(r.expr, NumCmp(size, CompOp::Lt, i));
+                } else {
+                    BOOST_CHECK(r.id.empty());
+                    BOOST_CHECK_EQUAL(r.expr, OR(Exp(flag), NumCmp(size, CompOp::Eq, i)));
+                }
+                BOOST_CHECK_EQUAL(r.prog.code.size(), lexen::detail::leaves(r.expr));
+            }
+        }
+    };
+    check(lexen::load_rules(text, schema, pool));
+
+    // from a task of the pool itself, with no other worker to help
+    {
+        lexen::ThreadPool one(1);
+        lexen::RuleFile f;
+        one.submit([&] { f = lexen::load_rules(text, schema, one); });
+        one.wait();
+        check(f);
+    }
+
+    auto path = "/tmp/lexen_loader_test.txt";
+    std::ofstream(path) << text;
+    lexen::RuleFile f;
+    BOOST_CHECK(lexen::load_rules(path, schema, pool, f));
+    check(f);
+    std::remove(path);
+    BOOST_CHECK(!lexen::load_rules("/nonexistent/rules.txt", schema, pool, f));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -34,6 +34,13 @@ using lexen::ast::ListOp;
 using lexen::ast::VarVsSet;
 using lexen::ast::ListExpr;
 
+// variable of the default schema added on first use only, so names keep
+// resolving to the variables of fixtures constructed by later tests
+inline VarIdx test_var(const std::string& name, var_type type) {
+    if (auto var = lexen::default_schema().symbols().var.find(name)) return *var;
+    return add_var(name, type);
+}
+
 inline Exp Bool(bool x) { return Exp(BoolVal(x)); }
 static Exp True = Bool(true);
 static Exp False = Bool(false);